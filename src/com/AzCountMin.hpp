@@ -0,0 +1,90 @@
+/* * * * *
+ *  AzCountMin.hpp
+ *  Copyright (C) 2017 Rie Johnson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * * * * */
+
+#ifndef _AZ_COUNT_MIN_HPP_
+#define _AZ_COUNT_MIN_HPP_
+
+#include "AzUtil.hpp"
+#include "AzStrPool.hpp"
+
+/*---  count-min sketch of string counts in fixed memory  ---*/
+/* Conservative update.  estimate() never underestimates; it overestimates by */
+/* at most eps()*total() with probability >= 1-exp(-depth) for each string.   */
+/* Sketches of the same shape can be added up (e.g., one per thread).        */
+class AzCountMin {
+protected:
+  int depth, width;
+  AzBaseArr<unsigned int,AZint8> a_cnt; /* [depth][width] */
+  AZint8 total;
+  static const unsigned int cnt_max = 0xffffffff;
+
+  void gen_cols(const AzByte *bytes, int len, AZint8 *cols) const {
+    unsigned long long h = AzStrPoolh::hash(bytes, len);
+    unsigned long long h1 = h & 0xffffffffULL, h2 = (h >> 32) | 1;
+    for (int dx = 0; dx < depth; ++dx) cols[dx] = (AZint8)dx*width + (AZint8)((h1 + dx*h2) % width);
+  }
+public:
+  AzCountMin() : depth(0), width(0), total(0) {}
+  void reset(double mb, int _depth=4) {
+    const char *eyec = "AzCountMin::reset";
+    AzX::throw_if(mb <= 0 || _depth <= 0 || _depth > 32, eyec, "invalid size");
+    depth = _depth;
+    double w = mb*1024*1024/sizeof(unsigned int)/depth;
+    width = (int)MAX(1, MIN(w, (double)0x7fffffff));
+    a_cnt.free_alloc((AZint8)depth*width, eyec, "cnt");
+    memset(a_cnt.point_u(), 0, sizeof(unsigned int)*a_cnt.size());
+    total = 0;
+  }
+  void reset_shape(const AzCountMin &inp) { /* same shape, zero counts */
+    depth = inp.depth; width = inp.width;
+    a_cnt.free_alloc((AZint8)depth*width, "AzCountMin::reset_shape", "cnt");
+    memset(a_cnt.point_u(), 0, sizeof(unsigned int)*a_cnt.size());
+    total = 0;
+  }
+  void add(const char *str, unsigned int count=1) { add((AzByte *)str, Az64::cstrlen(str), count); }
+  void add(const AzByte *bytes, int len, unsigned int count=1) {
+    AZint8 cols[32]; gen_cols(bytes, len, cols);
+    unsigned int *cnt = a_cnt.point_u();
+    unsigned int est = cnt_max;
+    for (int dx = 0; dx < depth; ++dx) est = MIN(est, cnt[cols[dx]]);
+    unsigned int val = (est > cnt_max - count) ? cnt_max : est + count; /* saturate */
+    for (int dx = 0; dx < depth; ++dx) if (cnt[cols[dx]] < val) cnt[cols[dx]] = val;
+    total += count;
+  }
+  void add(const AzCountMin &inp) {
+    const char *eyec = "AzCountMin::add(sketch)";
+    AzX::throw_if(inp.depth != depth || inp.width != width, eyec, "shape mismatch");
+    unsigned int *cnt = a_cnt.point_u();
+    const unsigned int *inp_cnt = inp.a_cnt.point();
+    for (AZint8 ix = 0; ix < a_cnt.size(); ++ix) cnt[ix] = (cnt[ix] > cnt_max - inp_cnt[ix]) ? cnt_max : cnt[ix] + inp_cnt[ix];
+    total += inp.total;
+  }
+  unsigned int estimate(const char *str) const { return estimate((AzByte *)str, Az64::cstrlen(str)); }
+  unsigned int estimate(const AzByte *bytes, int len) const {
+    AZint8 cols[32]; gen_cols(bytes, len, cols);
+    const unsigned int *cnt = a_cnt.point();
+    unsigned int est = cnt_max;
+    for (int dx = 0; dx < depth; ++dx) est = MIN(est, cnt[cols[dx]]);
+    return est;
+  }
+  AZint8 total_count() const { return total; }
+  double eps() const { return (width > 0) ? exp(1.0)/width : 1; }
+  int get_depth() const { return depth; }
+  int get_width() const { return width; }
+};
+#endif
@@ -27,6 +27,8 @@ class AzDic {
 protected:
   AzStrPool sp_words; /* in the original order; not searchable */
   AzStrPool sp_sorted;  /* sorted and pointing to sp_words; searchable */
+  AzIntArr ia_htbl;     /* hash table of word ids; empty unless build_hash() is called */
+  AzBaseArr<unsigned long long> a_hash; /* [word id] hash of the n-gram for ia_htbl */
   
   static const int reserved_len=64; 
   static const int version=0;   
@@ -41,16 +43,23 @@ public:
   AzDic(const AzStrPool *sp, bool do_ignore_dup=false) {
     reset(sp, do_ignore_dup); 
   }
+  AzDic(const AzDic &inp) { reset(&inp); } /* the hash table is not copied */
+  AzDic & operator =(const AzDic &inp) {
+    if (this != &inp) reset(&inp); 
+    return *this; 
+  }
   int size() const { return sp_sorted.size(); }
   void reset() {
     sp_words.reset(); 
     sp_sorted.reset(); 
+    clear_hash(); 
   }
   void reset(const AzDic *dic2) {
     if (dic2 == NULL) reset(); 
     else {
       sp_words.reset(&dic2->sp_words); 
       sp_sorted.reset(&dic2->sp_sorted); 
+      clear_hash(); 
     }
   }
   void readText(const char *fn, bool do_ignore_dup=false, bool do_allow_blank=false) { reset(fn, do_ignore_dup, do_allow_blank); }
@@ -94,6 +103,84 @@ public:
     sp_words->compose_ngram(s, wx, nn); 
     return find(s.c_str()); 
   } 
+
+  /*---  n-gram lookup from token hashes without composing n-gram strings  ---*/
+  /* The hash of an n-gram is hash_next() applied to the word hashes from left */
+  /* to right starting with 0, so that a caller can compute it incrementally.  */
+  static const unsigned long long hash_mul = 0x9E3779B97F4A7C15ULL; 
+  static unsigned long long hash_word(const AzByte *bytes, int len) { return AzStrPoolh::hash(bytes, len); }
+  static unsigned long long hash_next(unsigned long long hash, unsigned long long word_hash) {
+    return hash*hash_mul + word_hash; 
+  }
+  void build_hash() { /* call after the vocabulary is final; cleared when it changes */
+    clear_hash(); 
+    int num = sp_words.size(); 
+    if (num <= 0) return; 
+    int tbl_size = 1024; while (tbl_size < num*2) tbl_size *= 2; /* load factor <= 0.5 */
+    ia_htbl.reset(tbl_size, -1); 
+    int *tbl = ia_htbl.point_u(); 
+    a_hash.alloc(num, "AzDic::build_hash", "a_hash"); 
+    unsigned long long *hash = a_hash.point_u(); 
+    for (int id = 0; id < num; ++id) {
+      int len; const AzByte *bytes = sp_words.point(id, &len); 
+      hash[id] = 0; 
+      for (int pos = 0; ; ) { /* words are delimited by ' ' as in compose_ngram */
+        const AzByte *sp = (const AzByte *)memchr(bytes+pos, ' ', len-pos); 
+        int wlen = (sp == NULL) ? len-pos : Az64::ptr_diff(sp-bytes)-pos; 
+        hash[id] = hash_next(hash[id], hash_word(bytes+pos, wlen)); 
+        if (sp == NULL) break; 
+        pos += wlen+1; 
+      }
+      if (find(sp_words.c_str(id)) != id) continue; /* a duplicate; find() returns another */
+      int slot = hash_slot(hash[id]); 
+      while (tbl[slot] >= 0) slot = (slot+1) & (tbl_size-1); 
+      tbl[slot] = id; 
+    }
+  }
+  bool has_hash() const { return (ia_htbl.size() > 0); }
+  /*---  same as find_ngram(sp_words, wx, nn) but the nn words are given as  ---*/
+  /*---  spans [offset, length, offset, length, ...] in buff with the hash  ---*/
+  int find_ngram(const AzByte *buff, const int *span, int nn, unsigned long long hash) const {
+    if (!has_hash()) return -1; 
+    const int *tbl = ia_htbl.point(); 
+    const unsigned long long *hash_arr = a_hash.point(); 
+    int mask = ia_htbl.size()-1; 
+    for (int slot = hash_slot(hash); tbl[slot] >= 0; slot = (slot+1) & mask) {
+      int id = tbl[slot]; 
+      if (hash_arr[id] == hash && is_ngram(id, buff, span, nn)) return id; 
+    }
+    return -1; 
+  }
+
+  /*---  feature hashing (prepText gen_regions hash_bits=k): the word-mapping is  ---*/
+  /*---  one line "#hash<k>n<n-list>[p<patch size>]" instead of one per dimension ---*/
+  bool is_hash_signature() const {
+    return (size() == 1 && strncmp(c_str(0), "#hash", 5) == 0); 
+  }
+  int hash_signature_dim(int *pch_sz=NULL) const { /* 2^k * patch size */
+    const char *eyec = "AzDic::hash_signature_dim"; 
+    AzX::throw_if(!is_hash_signature(), eyec, "Not a feature-hashing signature"); 
+    const char *str = c_str(0), *pp = strchr(str, 'p'); 
+    int hash_bits = atol(str+5), psz = (pp == NULL) ? 1 : atol(pp+1); 
+    AzX::throw_if(hash_bits <= 0 || hash_bits > 30 || psz <= 0, AzInputError, eyec, "Broken feature-hashing signature: ", str); 
+    if (pch_sz != NULL) *pch_sz = psz; 
+    return (1 << hash_bits)*psz; 
+  }
+  /*---  names of the dimensions for display: "[<position>:]#hash<k>n<n-list>#<id>"  ---*/
+  void expand_hash_signature(AzDic &out) const {
+    int pch_sz = 1, dim = hash_signature_dim(&pch_sz), num = dim/pch_sz; 
+    const char *str = c_str(0), *pp = strchr(str, 'p'); 
+    AzBytArr s_sig((const AzByte *)str, (pp == NULL) ? (int)strlen(str) : Az64::ptr_diff(pp-str)); 
+    AzStrPool sp(dim, s_sig.length()+16); 
+    for (int px = 0; px < pch_sz; ++px) {
+      for (int id = 0; id < num; ++id) {
+        AzBytArr s; if (pch_sz > 1) s << px << ":"; 
+        s << s_sig.c_str() << "#" << id; 
+        sp.put(&s); 
+      }
+    }
+    out.reset(&sp); 
+  }
   const char *get(int id) const {
     if (id < 0) return ""; 
     return sp_words.c_str(id); 
@@ -177,6 +264,7 @@ public:
     int my_version = AzTools::read_header(file, reserved_len);     
     sp_words.read(file); 
     sp_sorted.read(file); 
+    clear_hash(); 
   }
   void append(const AzDic *dic2) {
     sp_words.append(&dic2->sp_words); 
@@ -190,6 +278,7 @@ public:
     sp_words.add_prefix(pref); 
     sp_sorted.reset(&sp_words); 
     sp_sorted.commit(); 
+    clear_hash(); 
   }
   void copy_to(AzStrPool *sp) const {
     sp->reset(&sp_words); 
@@ -243,7 +332,27 @@ protected:
       sp_sorted.setValue(ix, ix); 
     }
     sp_sorted.commit(do_ignore_dup); 
+    clear_hash(); 
   }   
+  void clear_hash() { ia_htbl.reset(); a_hash.free(); }
+  int hash_slot(unsigned long long hash) const {
+    hash ^= (hash >> 29); hash *= 0xBF58476D1CE4E5B9ULL; hash ^= (hash >> 32); 
+    return (int)(hash & (unsigned long long)(ia_htbl.size()-1)); 
+  }
+  bool is_ngram(int id, const AzByte *buff, const int *span, int nn) const {
+    int len; const AzByte *bytes = sp_words.point(id, &len); 
+    int pos = 0; 
+    for (int ix = 0; ix < nn; ++ix) {
+      if (ix > 0) {
+        if (pos >= len || bytes[pos] != ' ') return false; 
+        ++pos; 
+      }
+      int wlen = span[ix*2+1]; 
+      if (pos+wlen > len || memcmp(bytes+pos, buff+span[ix*2], wlen) != 0) return false; 
+      pos += wlen; 
+    }
+    return (pos == len); 
+  }
 };  
 
 #define AzDicc AzStrPoolc
@@ -112,6 +112,12 @@ public:
   }
 
   void write(const char *fn) const { AzFile::write(fn, this); }
+  void write(const char *fn, bool do_compress) const { /* M: AzSmatbc */
+    AzFile file(fn); file.open("wb"); 
+    write_hdr(&file, data_num, ia_dcolind); 
+    m.write(&file, do_compress); 
+    file.close(true); 
+  }
   void read(const char *fn) { AzFile::read(fn, this); }
   static void write_hdr(AzFile *file, int d_num, const AzIntArr &ia_ind, 
                     bool do_chk=false, int cnum=-1) {
@@ -20,6 +20,7 @@
 #include "AzUtil.hpp"
 #include "AzSmat.hpp"
 #include "AzPrint.hpp"
+#include "AzVarint.hpp"
 
 #define AzVectSmall 32
 
@@ -1796,8 +1797,13 @@ void AzSmatc::check_consistency() {
 
 /*-------------------------------------------------------------*/
 /*-------------------------------------------------------------*/
-void AzSmatbc::write(AzFile *file, const AzIntArr &ia_no, int row_num, int col_num, const AzIntArr &ia_be) /* static */{
+void AzSmatbc::write(AzFile *file, const AzIntArr &ia_no, int row_num, int col_num, const AzIntArr &ia_be, 
+                     bool do_compress) /* static */{
   check_consistency(ia_no, row_num, col_num,  ia_be);
+  if (do_compress) {
+    write_compressed(file, ia_no, row_num, col_num, ia_be); 
+    return; 
+  }
   int version = 1; 
   file->writeInt(version); 
   file->writeInt(row_num); 
@@ -1811,6 +1817,10 @@ void AzSmatbc::read(AzFile *file) {
   int version = file->readInt(); 
   row_num = file->readInt(); 
   col_num = file->readInt(); 
+  if (version == 2) {
+    read_compressed(file); 
+    return; 
+  }
   if (version == 0) {
     AzIntArr ia_begin, ia_end; 
     ia_begin.read(file); 
@@ -1824,6 +1834,85 @@ void AzSmatbc::read(AzFile *file) {
   ia_no.read(file);   
 }
 
+/*-------------------------------------------------------------*/
+/* Version 2: after #row and #col, a flag (1: row#'s are ascending in every */
+/* column), #non-zero, and the byte length of the following varints: for   */
+/* each column, its size and its row#'s; the first row# is as is, and the  */
+/* rest are the gaps minus one if ascending or zigzag-encoded differences. */
+static inline unsigned int az_bc_gap(const int *no, int bx, int ix, bool is_ascending) {
+  if (ix == bx) return (unsigned int)no[ix]; 
+  if (is_ascending) return (unsigned int)(no[ix]-no[ix-1]-1); 
+  return AzVarint::zigzag(no[ix]-no[ix-1]); 
+}
+
+/*-------------------------------------------------------------*/
+void AzSmatbc::write_compressed(AzFile *file, const AzIntArr &ia_no, int row_num, int col_num, const AzIntArr &ia_be) /* static */{
+  const char *eyec = "AzSmatbc::write_compressed"; 
+  const int *be = ia_be.point(), *no = ia_no.point(); 
+  bool is_ascending = true; 
+  for (int col = 0; col < col_num && is_ascending; ++col) {
+    for (int ix = be[col]+1; ix < be[col+1]; ++ix) if (no[ix] <= no[ix-1]) { is_ascending = false; break; }
+  }
+  AZint8 len = 0; 
+  for (int col = 0; col < col_num; ++col) {
+    len += AzVarint::size(be[col+1]-be[col]); 
+    for (int ix = be[col]; ix < be[col+1]; ++ix) len += AzVarint::size(az_bc_gap(no, be[col], ix, is_ascending)); 
+  }
+  int version = 2; 
+  file->writeInt(version); 
+  file->writeInt(row_num); 
+  file->writeInt(col_num); 
+  file->writeInt((is_ascending) ? 1 : 0); 
+  file->writeInt(ia_no.size()); 
+  file->writeInt8(len); 
+
+  /*---  encode and write through a fixed-size buffer  ---*/
+  int buff_size = 1024*1024*4, margin = 8; /* a varint takes at most 5 bytes */
+  AzBaseArr<AzByte> buff; buff.alloc(buff_size, eyec, "buff"); 
+  AzByte *beg = buff.point_u(), *out = beg; 
+  AZint8 written = 0; 
+  for (int col = 0; col < col_num; ++col) {
+    for (int ix = be[col]-1; ix < be[col+1]; ++ix) {
+      if (out-beg > buff_size-margin) { written += file->writeBytes(beg, out-beg); out = beg; }
+      if (ix < be[col]) out = AzVarint::put(be[col+1]-be[col], out); /* column size */
+      else              out = AzVarint::put(az_bc_gap(no, be[col], ix, is_ascending), out); 
+    }
+  }
+  if (out > beg) written += file->writeBytes(beg, out-beg); 
+  AzX::throw_if(written != len, eyec, "length mismatch"); 
+}
+
+/*-------------------------------------------------------------*/
+void AzSmatbc::read_compressed(AzFile *file) { /* after reading version, #row, #col */
+  const char *eyec = "AzSmatbc::read_compressed"; 
+  bool is_ascending = (file->readInt() != 0); 
+  int elm_num = file->readInt(); 
+  AZint8 len = file->readInt8(); 
+  AzX::throw_if(row_num < 0 || col_num < 0 || elm_num < 0 || len < 0, AzInputError, eyec, "Corrupted header"); 
+  AzBaseArr<AzByte,AZint8> buff; buff.alloc(len, eyec, "buff"); 
+  if (len > 0) file->readBytes(buff.point_u(), len); 
+  const AzByte *inp = buff.point(), *end = inp + len; 
+  
+  ia_be.reset(col_num+1, 0); ia_no.reset(elm_num, 0); 
+  int *be = ia_be.point_u(), *no = ia_no.point_u(); 
+  int ex = 0; 
+  for (int col = 0; col < col_num; ++col) {
+    unsigned int sz; inp = AzVarint::get(inp, end, sz); 
+    AzX::throw_if((AZint8)ex + sz > elm_num, AzInputError, eyec, "Corrupted data (#non-zero)"); 
+    be[col] = ex; 
+    int row = -1; 
+    for (int ex1 = ex + (int)sz; ex < ex1; ++ex) {
+      unsigned int val; inp = AzVarint::get(inp, end, val); 
+      if (ex == be[col])     row = (int)val; 
+      else if (is_ascending) row += (int)val + 1; 
+      else                   row += AzVarint::unzigzag(val); 
+      no[ex] = row; 
+    }
+  }
+  be[col_num] = ex; 
+  AzX::throw_if(ex != elm_num || inp != end, AzInputError, eyec, "Corrupted data (length)"); 
+}
+
 /*-------------------------------------------------------------*/
 template <class M>  /* M: AzSmat | AzSmatc | AzSmatbc */
 void AzSmatbc::set(const M *m, const int *cxs, int cxs_num) {
@@ -498,6 +498,13 @@ public:
     ia_be.put(arr.size()); 
     arr.concat(_arr);     
   }
+  void concat(const Az_bc_c &inp) { /* append the columns of inp; e.g., to join the output of threads */
+    const char *eyec = "Az_bc_c::concat"; 
+    AzX::throw_if(is_committed || inp.is_committed, eyec, "Already committed"); 
+    check_overflow(eyec, inp.elmNum()); 
+    ia_be.concat(&inp.ia_be, arr.size()); 
+    arr.concat(inp.arr); 
+  }
   int colNum() const { return ((is_committed) ? ia_be.size()-1 : ia_be.size()); }
   int elmNum() const { return arr.size(); }
   void commit() {
@@ -512,7 +519,7 @@ public:
   }
   template <class Arr>
   static int prepmem(Arr &arr, AZint8 now, AZint8 all) {
-    int est = (int)MIN((AZint8)arr.size() / now * all + 1024*1024, AzSigned32Max);     
+    int est = (int)MIN((double)arr.size()*(double)all/(double)now + 1024*1024, (double)AzSigned32Max); /* now and all may be in bytes */
     arr.prepare(est); 
     return est; 
   }  
@@ -680,13 +687,17 @@ public:
   static void check_consistency(const AzIntArr &ia_no, int rnum, int cnum, const AzIntArr &ia_be); 
   void reset() { reform(0,0); }
   void destroy() { reform(0,0); }
-  void write(AzFile *file) const { write(file, ia_no, row_num, col_num, ia_be); }
-  static void write(AzFile *file, const AzIntArr &ia_no, int row_num, int col_num, AzIntArr const &ia_be); 
-  static void write(AzFile *file, int row_num, const Az_bc &bc) {
-    write(file, bc.valarr(), row_num, bc.colNum(), bc.be()); 
+  /*---  do_compress: row#'s are delta-encoded as varints (version 2); read() handles both  ---*/
+  void write(AzFile *file, bool do_compress=false) const { write(file, ia_no, row_num, col_num, ia_be, do_compress); }
+  static void write(AzFile *file, const AzIntArr &ia_no, int row_num, int col_num, AzIntArr const &ia_be, 
+                    bool do_compress=false); 
+  static void write(AzFile *file, int row_num, const Az_bc &bc, bool do_compress=false) {
+    write(file, bc.valarr(), row_num, bc.colNum(), bc.be(), do_compress); 
   }
   void read(AzFile *file); 
-  void write(const char *fn) const { AzFile::write<AzSmatbc>(fn, this); }
+  void write(const char *fn, bool do_compress=false) const { 
+    AzFile file(fn); file.open("wb"); write(&file, do_compress); file.close(true); 
+  }
   void read(const char *fn) { AzFile::read<AzSmatbc>(fn, this); }
   int rowNum() const { return row_num; }
   int colNum() const { return col_num; }
@@ -717,6 +728,8 @@ protected:
   void check_col(int col, const char *eyec) const {
     AzX::throw_if(col<0 || col>=col_num, eyec, "col# is out of range"); 
   }  
+  static void write_compressed(AzFile *file, const AzIntArr &ia_no, int row_num, int col_num, AzIntArr const &ia_be); 
+  void read_compressed(AzFile *file); 
 }; 
 typedef AzMatVar<AzSmatbc> AzSmatbcVar; 
 #endif 
\ No newline at end of file
@@ -0,0 +1,193 @@
+/* * * * *
+ *  AzSmatbcVarz.hpp
+ *  Copyright (C) 2017 Rie Johnson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * * * * */
+
+#ifndef _AZ_SMATBC_VARZ_HPP_
+#define _AZ_SMATBC_VARZ_HPP_
+
+#include "AzUtil.hpp"
+#include "AzSmat.hpp"
+#include "AzVarint.hpp"
+
+/*---  variable-sized binary sparse data compressed in memory  ---*/
+/* Same content as AzSmatbcVar, but the columns of each data point are kept */
+/* as varints (the size of each column and the gaps between its row#'s as   */
+/* in AzSmatbc file version 2) so that any data points, e.g., those of a    */
+/* mini-batch, can be decoded when needed.                                  */
+class AzSmatbcVarz {
+protected:
+  int row_num, col_num, data_num; 
+  AZint8 elm_num; 
+  bool is_ascending; /* row#'s are ascending in every column */
+  AzIntArr ia_dcolind; /* column range of data points: begin1, end1, begin2, end2, ... */
+  AzBaseArr<AZint8> a_offs; /* [data_num+1]: where the bytes of each data point begin */
+  AzBaseArr<AzByte,AZint8> a_bytes; 
+
+  unsigned int gap(const int *rows, int ix) const {
+    if (ix == 0) return (unsigned int)rows[0]; 
+    if (is_ascending) return (unsigned int)(rows[ix]-rows[ix-1]-1); 
+    return AzVarint::zigzag(rows[ix]-rows[ix-1]); 
+  }
+  template <class M> /* M: AzSmatbc */
+  AZint8 encode(const M *m, int col0, int col1, AzByte *out) const { /* just count if out is NULL */
+    AZint8 len = 0; 
+    for (int col = col0; col < col1; ++col) {
+      int num; const int *rows = m->rawcol_int(col, &num); 
+      if (out == NULL) {
+        len += AzVarint::size(num); 
+        for (int ix = 0; ix < num; ++ix) len += AzVarint::size(gap(rows, ix)); 
+      }
+      else {
+        AzByte *beg = out; 
+        out = AzVarint::put(num, out); 
+        for (int ix = 0; ix < num; ++ix) out = AzVarint::put(gap(rows, ix), out); 
+        len += out - beg; 
+      }
+    }
+    return len; 
+  }
+  void check_datano(int dx, const char *eyec) const {
+    AzX::throw_if((dx < 0 || dx >= data_num), eyec, "invalid index"); 
+  }
+  static const AzByte *skip_column(const AzByte *inp, const AzByte *end) {
+    unsigned int sz; inp = AzVarint::get(inp, end, sz); 
+    for (unsigned int ix = 0; ix < sz; ++inp) {
+      AzX::throw_if(inp >= end, AzInputError, "AzSmatbcVarz::skip_column", "Truncated data"); 
+      if (*inp < 0x80) ++ix; /* the last byte of a varint */
+    }
+    return inp; 
+  }
+  bool is_sequential() const { /* the columns of data point dx+1 follow those of dx */
+    for (int dx = 0; dx < data_num; ++dx) {
+      if (get_begin(dx) != ((dx == 0) ? 0 : get_end(dx-1)) || get_end(dx) < get_begin(dx)) return false; 
+    }
+    return (data_num == 0 || get_end(data_num-1) == col_num); 
+  }
+
+public:
+  AzSmatbcVarz() : row_num(0), col_num(0), data_num(0), elm_num(0), is_ascending(true) {}
+  void reset() {
+    row_num = col_num = data_num = 0; elm_num = 0; is_ascending = true; 
+    ia_dcolind.reset(); a_offs.free(); a_bytes.free(); 
+  }
+  void destroy() { reset(); }
+  template <class M> /* M: AzSmatbc */
+  void reset(const AzMatVar<M> &mv) {
+    const char *eyec = "AzSmatbcVarz::reset(mv)"; 
+    reset(); 
+    const M *m = mv.data(); 
+    row_num = mv.rowNum(); col_num = mv.colNum(); data_num = mv.dataNum(); 
+    elm_num = m->elmNum(); 
+    ia_dcolind.reset(mv.index()); 
+    for (int col = 0; col < col_num && is_ascending; ++col) {
+      int num; const int *rows = m->rawcol_int(col, &num); 
+      for (int ix = 1; ix < num; ++ix) if (rows[ix] <= rows[ix-1]) { is_ascending = false; break; }
+    }
+    a_offs.alloc(data_num+1, eyec, "offs"); 
+    AZint8 *offs = a_offs.point_u(); 
+    offs[0] = 0; 
+    for (int dx = 0; dx < data_num; ++dx) offs[dx+1] = offs[dx] + encode(m, mv.get_begin(dx), mv.get_end(dx), NULL); 
+    a_bytes.alloc(offs[data_num], eyec, "bytes"); 
+    for (int dx = 0; dx < data_num; ++dx) encode(m, mv.get_begin(dx), mv.get_end(dx), a_bytes.point_u()+offs[dx]); 
+  }
+  
+  /*---  read *.xsmatbcvar  ---*/
+  /* AzSmatbc file version 2 (prepText with Compress) has the same encoding, and */
+  /* its varints are the streams of the data points one after another, so they */
+  /* are kept as they are; the file is never expanded in memory.  Other files  */
+  /* are read uncompressed and then compressed.                                */
+  void read(const char *fn) {
+    const char *eyec = "AzSmatbcVarz::read"; 
+    reset(); 
+    AzFile file(fn); file.open("rb"); 
+    AzMatVar<AzSmatbc>::read_hdr(&file, data_num, ia_dcolind); 
+    int version = file.readInt(); 
+    if (version == 2) {
+      row_num = file.readInt(); col_num = file.readInt(); 
+      is_ascending = (file.readInt() != 0); 
+      elm_num = file.readInt(); 
+      AZint8 len = file.readInt8(); 
+      AzX::throw_if(row_num < 0 || col_num < 0 || elm_num < 0 || len < 0 || ia_dcolind.size() != data_num*2, 
+                    AzInputError, eyec, "Corrupted header: ", fn); 
+      if (is_sequential()) {
+        a_bytes.alloc(len, eyec, "bytes"); 
+        if (len > 0) file.readBytes(a_bytes.point_u(), len); 
+        file.close(); 
+        const AzByte *beg = a_bytes.point(), *inp = beg, *end = beg + len; 
+        a_offs.alloc(data_num+1, eyec, "offs"); 
+        AZint8 *offs = a_offs.point_u(); 
+        for (int dx = 0; dx < data_num; ++dx) {
+          offs[dx] = inp - beg; 
+          for (int col = get_begin(dx); col < get_end(dx); ++col) inp = skip_column(inp, end); 
+        }
+        offs[data_num] = inp - beg; 
+        AzX::throw_if(inp != end, AzInputError, eyec, "Corrupted data: ", fn); 
+        return; 
+      }
+    }
+    /*---  not compressed, or data points share or skip columns  ---*/
+    file.seek(0); 
+    AzMatVar<AzSmatbc> mv; mv.read(&file); 
+    file.close(); 
+    reset(mv); 
+  }
+  
+  int rowNum() const { return row_num; }
+  int colNum() const { return col_num; }
+  int dataNum() const { return data_num; }
+  AZint8 elmNum() const { return elm_num; }
+  AZint8 byteNum() const { return a_bytes.size() + a_offs.size()*sizeof(AZint8) + ia_dcolind.size()*sizeof(int); }
+  const AzIntArr *index() const { return &ia_dcolind; }
+  int get_begin(int dx) const { check_datano(dx, "AzSmatbcVarz::get_begin"); return ia_dcolind[dx*2]; }
+  int get_end(int dx) const { check_datano(dx, "AzSmatbcVarz::get_end"); return ia_dcolind[dx*2+1]; }
+
+  /*---  decode data points dxs[0::num] into bc and their column ranges in bc  ---*/
+  void decode(const int *dxs, int num, Az_bc &bc, AzIntArr &ia_dcol) const {
+    const char *eyec = "AzSmatbcVarz::decode"; 
+    const AZint8 *offs = a_offs.point(); 
+    AZint8 c_num = 0, b_num = 0; 
+    for (int ix = 0; ix < num; ++ix) {
+      int dx = dxs[ix]; check_datano(dx, eyec); 
+      c_num += get_end(dx) - get_begin(dx); 
+      b_num += offs[dx+1] - offs[dx]; /* no fewer than #non-zero */
+    }
+    bc.reset((int)MIN(c_num, AzSigned32Max), (int)MIN(b_num, AzSigned32Max)); 
+    ia_dcol.reset(); ia_dcol.prepare(num*2); 
+    AzIntArr ia_rows; 
+    for (int ix = 0; ix < num; ++ix) {
+      int dx = dxs[ix]; 
+      const AzByte *inp = a_bytes.point() + offs[dx], *end = a_bytes.point() + offs[dx+1]; 
+      ia_dcol.put(bc.colNum()); 
+      for (int col = get_begin(dx); col < get_end(dx); ++col) {
+        unsigned int sz; inp = AzVarint::get(inp, end, sz); 
+        ia_rows.cut(0); 
+        int row = -1; 
+        for (int rx = 0; rx < (int)sz; ++rx) {
+          unsigned int val; inp = AzVarint::get(inp, end, val); 
+          if (rx == 0)           row = (int)val; 
+          else if (is_ascending) row += (int)val + 1; 
+          else                   row += AzVarint::unzigzag(val); 
+          ia_rows.put(row); 
+        }
+        bc.put(ia_rows); 
+      }
+      ia_dcol.put(bc.colNum()); 
+      AzX::throw_if(inp != end, eyec, "Corrupted data"); 
+    }
+  }
+}; 
+#endif
@@ -525,6 +525,97 @@ int AzStrPool::get_min_n() const {
   return min_n; 
 }
 
+/*------------------------------------------------------------------*/
+/*------------------------------------------------------------------*/
+int AzStrPoolh::find(const AzByte *bytes, int bytes_len, unsigned long long h, int *out_slot) const {
+  const AzSphEnt *ent = a_ent.point(); 
+  const int *tbl = a_tbl.point(); 
+  int slot = (int)(h & (unsigned long long)tbl_mask); 
+  for ( ; tbl[slot] >= 0; slot = (slot + 1) & tbl_mask) {
+    const AzSphEnt *ep = ent + tbl[slot]; 
+    if (ep->hash == h && ep->len == bytes_len && 
+        memcmp(a_data.point() + ep->offs, bytes, bytes_len) == 0) break; 
+  }
+  if (out_slot != NULL) *out_slot = slot; 
+  return tbl[slot]; 
+}
+
+/*------------------------------------------------------------------*/
+int AzStrPoolh::find(const AzByte *bytes, int bytes_len) const {
+  if (ent_num <= 0) return AzNone; 
+  return find(bytes, bytes_len, hash(bytes, bytes_len), NULL); 
+}
+
+/*------------------------------------------------------------------*/
+int AzStrPoolh::put(const AzByte *bytes, int bytes_len, AZint8 count) {
+  const char *eyec = "AzStrPoolh::put"; 
+  AzX::throw_if(bytes_len < 0, eyec, "negative length"); 
+  if ((AZint8)(ent_num+1)*2 > (AZint8)a_tbl.size()) rehash(MAX(1024, a_tbl.size()*2)); /* keep the load <= 0.5 */
+  unsigned long long h = hash(bytes, bytes_len); 
+  int slot; 
+  int ex = find(bytes, bytes_len, h, &slot); 
+  if (ex >= 0) {
+    a_ent.point_u()[ex].count += count; 
+    return ex; 
+  }
+
+  if (ent_num >= a_ent.size()) a_ent.realloc(MAX(1024, a_ent.size()*2), eyec, "ent"); 
+  if (data_len + bytes_len + 1 > a_data.size()) {
+    a_data.realloc(MAX(data_len + bytes_len + 1, MAX((AZint8)1024*16, a_data.size()*2)), eyec, "data"); 
+  }
+  AzSphEnt *ep = a_ent.point_u() + ent_num; 
+  ep->offs = data_len; ep->len = bytes_len; ep->count = count; ep->hash = h; 
+  AzByte *data = a_data.point_u(); 
+  memcpy(data + data_len, bytes, bytes_len); 
+  data_len += bytes_len; 
+  data[data_len++] = '\0'; 
+  a_tbl.point_u()[slot] = ent_num; 
+  return ent_num++; 
+}
+
+/*------------------------------------------------------------------*/
+void AzStrPoolh::rehash(int tbl_size) {
+  const char *eyec = "AzStrPoolh::rehash"; 
+  AzX::throw_if(tbl_size <= 0 || (tbl_size & (tbl_size-1)) != 0, eyec, "table size must be a power of 2"); 
+  a_tbl.free_alloc(tbl_size, -1, eyec, "tbl"); 
+  tbl_mask = tbl_size - 1; 
+  const AzSphEnt *ent = a_ent.point(); 
+  int *tbl = a_tbl.point_u(); 
+  for (int ex = 0; ex < ent_num; ++ex) {
+    int slot = (int)(ent[ex].hash & (unsigned long long)tbl_mask); 
+    for ( ; tbl[slot] >= 0; slot = (slot + 1) & tbl_mask); 
+    tbl[slot] = ex; 
+  }
+}
+
+/*------------------------------------------------------------------*/
+void AzStrPoolh::reduce(int min_count) {
+  AzIntArr ia_keep; ia_keep.prepare(ent_num); 
+  const AzSphEnt *ent = a_ent.point(); 
+  for (int ex = 0; ex < ent_num; ++ex) if (ent[ex].count >= min_count) ia_keep.put(ex); 
+  reduce(&ia_keep); 
+}
+
+/*------------------------------------------------------------------*/
+void AzStrPoolh::reduce(const AzIntArr *ia_keep) {
+  const char *eyec = "AzStrPoolh::reduce(ia_keep)"; 
+  AzSphEnt *ent = a_ent.point_u(); 
+  AzByte *data = a_data.point_u(); 
+  int new_ex = 0; 
+  AZint8 new_offs = 0; 
+  for (int ix = 0; ix < ia_keep->size(); ++ix) {
+    int ex = ia_keep->get(ix); 
+    AzX::throw_if(ex < 0 || ex >= ent_num, eyec, "index is out of range"); 
+    AzX::throw_if(ix > 0 && ex <= ia_keep->get(ix-1), eyec, "index array must be sorted and have no duplication"); 
+    AzSphEnt e = ent[ex]; 
+    memmove(data + new_offs, data + e.offs, e.len + 1); /* new_offs <= e.offs */
+    e.offs = new_offs; new_offs += e.len + 1; 
+    ent[new_ex++] = e; 
+  }
+  ent_num = new_ex; data_len = new_offs; 
+  if (a_tbl.size() > 0) rehash(a_tbl.size()); 
+}
+
 /*------------------------------------------------------------------*/
 void AzStrPoolc::reset(const AzStrPool &sp, AzByte dlm) {
   const char *eyec = "AzStrPoolc::reset"; 
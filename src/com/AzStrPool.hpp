@@ -287,6 +287,94 @@ protected:
                              bool do_remove_number) const;                             
 }; 
 
+/**************************************************************/
+/* h for hash: counting distinct strings.                            */
+/* put() adds to the count of an existing string in O(1) using open  */
+/* addressing with 64-bit hashes, so there is no commit().  Entries  */
+/* are kept in the order of first appearance; copy_to() produces an  */
+/* AzStrPool sorted once.                                            */
+typedef struct {
+  AZint8 offs; 
+  int len; 
+  AZint8 count; 
+  unsigned long long hash; 
+} AzSphEnt; 
+
+class AzStrPoolh {
+protected:
+  AzBaseArr<AzSphEnt> a_ent; 
+  int ent_num; 
+  AzBaseArr<AzByte,AZint8> a_data; /* strings terminated by '\0' */
+  AZint8 data_len; 
+  AzBaseArr<int> a_tbl; /* entry# or -1; size is a power of 2 */
+  int tbl_mask; 
+public:
+  AzStrPoolh() : ent_num(0), data_len(0), tbl_mask(-1) {}
+  AzStrPoolh(const AzStrPoolh &inp) : ent_num(0), data_len(0), tbl_mask(-1) { put(&inp); }
+  AzStrPoolh & operator =(const AzStrPoolh &inp) { 
+    if (this != &inp) { reset(); put(&inp); }
+    return *this; 
+  }
+  void reset() {
+    a_ent.free(); ent_num = 0; a_data.free(); data_len = 0; a_tbl.free(); tbl_mask = -1; 
+  }
+  int size() const { return ent_num; }
+  int put(const AzByte *bytes, int bytes_len, AZint8 count=1); 
+  int put(const char *str, AZint8 count=1) { return put((AzByte *)str, Az64::cstrlen(str), count); }
+  int put(const AzBytArr &s, AZint8 count=1) { return put(s.point(), s.length(), count); }
+  void put(const AzStrPoolh *inp) {
+    for (int ex = 0; ex < inp->size(); ++ex) {
+      int len; const AzByte *bytes = inp->point(ex, &len); 
+      put(bytes, len, inp->getCount(ex)); 
+    }
+  }
+  void put(const AzStrPool *inp) {
+    for (int ex = 0; ex < inp->size(); ++ex) {
+      int len; const AzByte *bytes = inp->point(ex, &len); 
+      put(bytes, len, inp->getCount(ex)); 
+    }
+  }
+  int find(const AzByte *bytes, int bytes_len) const; 
+  int find(const char *str) const { return find((AzByte *)str, Az64::cstrlen(str)); }
+
+  const AzByte *point(int ex, int *out_len=NULL) const { 
+    check_range(ex, "AzStrPoolh::point"); 
+    const AzSphEnt *ep = a_ent.point() + ex; 
+    if (out_len != NULL) *out_len = ep->len; 
+    return a_data.point() + ep->offs; 
+  }
+  const char *c_str(int ex) const { return (const char *)point(ex); }
+  AZint8 getCount(int ex) const { check_range(ex, "AzStrPoolh::getCount"); return a_ent.point()[ex].count; }
+
+  void reduce(int min_count); /* remove the entries with count < min_count */
+  void reduce(const AzIntArr *ia_keep); /* keep only these entries; must be sorted */
+  void copy_to(AzStrPool *sp) const { /* committed */
+    sp->reset(ent_num, (ent_num > 0) ? data_len/ent_num : 1); 
+    put_to(sp); 
+    sp->commit(); 
+  }
+  void put_to(AzStrPool *sp) const { /* not committed */
+    for (int ex = 0; ex < ent_num; ++ex) {
+      int len; const AzByte *bytes = point(ex, &len); 
+      sp->put(bytes, len, getCount(ex)); 
+    }
+  }
+  void write(AzFile *file) const { /* in the format of AzStrPool */
+    AzStrPool sp; copy_to(&sp); sp.write(file); 
+  }
+  static unsigned long long hash(const AzByte *bytes, int len) { /* FNV-1a */
+    unsigned long long h = 14695981039346656037ULL; 
+    for (int ix = 0; ix < len; ++ix) { h ^= bytes[ix]; h *= 1099511628211ULL; }
+    return h; 
+  }
+protected:
+  int find(const AzByte *bytes, int bytes_len, unsigned long long h, int *out_slot) const; 
+  void rehash(int tbl_size); 
+  void check_range(int ex, const char *eyec) const {
+    AzX::throw_if(ex < 0 || ex >= ent_num, eyec, "out of range"); 
+  }
+}; 
+
 /**************************************************************/
 /* c for compact */
 class AzStrPoolc {
@@ -321,6 +409,16 @@ public:
     data.free_alloc(len, "AzStrPoolc::read", "data"); 
     file->readBytes(data.point_u(), data.size()); 
   }
+  void copy_to(AzStrPool *sp, AzByte dlm) const { /* inverse of reset(sp, dlm) */
+    sp->reset(num, 10); 
+    const AzByte *ptr = data.point(), *end = ptr + data.size(); 
+    while (ptr < end) {
+      const AzByte *dp = (const AzByte *)memchr(ptr, dlm, end-ptr); 
+      if (dp == NULL) dp = end; 
+      sp->put(ptr, Az64::ptr_diff(dp-ptr)); 
+      ptr = dp + 1; 
+    }
+  }
   void writeText(const char *fn) const {
     AzFile file(fn); file.open("wb"); 
     file.writeBytes(data.point(), data.size()); 
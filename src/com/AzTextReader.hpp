@@ -0,0 +1,123 @@
+/* * * * *
+ *  AzTextReader.hpp
+ *  Copyright (C) 2017 Rie Johnson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * * * * */
+
+#ifndef _AZ_TEXT_READER_HPP_
+#define _AZ_TEXT_READER_HPP_
+
+#include "AzUtil.hpp"
+
+/*---  read a text file line by line through a large read-ahead buffer  ---*/
+/* next() returns a line (with '\n' if any) in place in the buffer; it is    */
+/* null-terminated and writable, and valid until the next call.  No limit on */
+/* the line length is needed in advance: the buffer grows as needed.         */
+/* With offs0/offs1, only the lines that begin in [offs0, offs1) are read so */
+/* that a file can be split into chunks at byte offsets, e.g., for threads.  */
+/* A null character in the file is an error as in AzFile::scan.              */
+#define AzTextReader_blk_dflt (1024*1024*4)
+class AzTextReader {
+protected:
+  AzFile file;
+  AzBytArr s_buff;
+  AzByte *buff;
+  int buff_size;
+  int beg, end;    /* unread bytes: buff[beg,end) */
+  AZint8 offs;     /* file offset of buff[beg] */
+  AZint8 offs1;    /* don't read lines beginning at or after this; -1: till eof */
+  bool is_eof;
+  int saved_pos;   /* buff[saved_pos] was overwritten by '\0' */
+  AzByte saved;
+
+  void fill() { /* keep the unread bytes and read more after them */
+    const char *eyec = "AzTextReader::fill";
+    if (beg > 0) {
+      if (end > beg) memmove(buff, buff+beg, end-beg);
+      end -= beg; beg = 0;
+    }
+    if (end >= buff_size-1) { /* a long line; one byte is for '\0' */
+      AzX::throw_if(buff_size > 0x3fffffff, AzInputError, eyec, "Too long a line in ", file.pointFileName());
+      AzBytArr s_keep(buff, end);
+      buff_size *= 2; buff = s_buff.reset(buff_size, 0);
+      memcpy(buff, s_keep.point(), end);
+    }
+    int len = file.readBytesUpTo(buff+end, buff_size-1-end);
+    if (len <= 0) { is_eof = true; return; }
+    if (memchr(buff+end, '\0', len) != NULL) {
+      AzBytArr s(": A null character (\\0) was detected in the text file: "); s << file.pointFileName() << " .  ";
+      s << "Remove or replace null characters and retry.";
+      AzX::throw_if(true, AzInputError, eyec, s.c_str());
+    }
+    end += len;
+  }
+
+public:
+  AzTextReader() : buff(NULL), buff_size(0), beg(0), end(0), offs(0), offs1(-1), is_eof(true),
+                   saved_pos(-1), saved(0) {}
+  ~AzTextReader() { close(); }
+
+  void open(const char *fn, AZint8 offs0=0, AZint8 _offs1=-1, int blk_size=AzTextReader_blk_dflt) {
+    close();
+    file.reset(fn); file.open("rb");
+    buff_size = MAX(blk_size, 1024);
+    buff = s_buff.reset(buff_size, 0);
+    beg = end = 0; offs = 0; offs1 = -1; is_eof = false; saved_pos = -1;
+    if (offs0 > 0) { /* skip the line that started in the previous chunk */
+      file.seek(offs0-1); offs = offs0-1;
+      AzByte *line = NULL; next(line);
+    }
+    offs1 = _offs1;
+  }
+  void close() {
+    file.close(); is_eof = true; beg = end = 0; saved_pos = -1;
+  }
+
+  /*---  return the length of the line; 0 at the end  ---*/
+  int next(AzByte *&line) {
+    if (saved_pos >= 0) { buff[saved_pos] = saved; saved_pos = -1; }
+    line = NULL;
+    if (offs1 >= 0 && offs >= offs1) return 0;
+    const AzByte *nl = NULL;
+    for ( ; ; ) {
+      nl = (end > beg) ? (AzByte *)memchr(buff+beg, '\n', end-beg) : NULL;
+      if (nl != NULL || is_eof) break;
+      fill();
+    }
+    int len = (nl != NULL) ? Az64::ptr_diff(nl-buff)+1-beg : end-beg;
+    if (len <= 0) return 0;
+    line = buff+beg;
+    saved_pos = beg+len; saved = buff[saved_pos]; buff[saved_pos] = '\0';
+    beg += len; offs += len;
+    return len;
+  }
+  AZint8 tell() const { return offs; }
+
+  /*---  return the number of lines; also the maximum line length  ---*/
+  static int count_lines(const char *fn, int *max_len=NULL, int blk_size=AzTextReader_blk_dflt) {
+    AzTextReader rdr; rdr.open(fn, 0, -1, blk_size);
+    int num = 0, mx = 0;
+    AzByte *line = NULL;
+    for ( ; ; ++num) {
+      int len = rdr.next(line);
+      if (len <= 0) break;
+      mx = MAX(mx, len);
+    }
+    rdr.close();
+    if (max_len != NULL) *max_len = mx;
+    return num;
+  }
+};
+#endif
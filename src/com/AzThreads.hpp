@@ -0,0 +1,125 @@
+/* * * * *
+ *  AzThreads.hpp
+ *  Copyright (C) 2017 Rie Johnson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * * * * */
+
+#ifndef _AZ_THREADS_HPP_
+#define _AZ_THREADS_HPP_
+
+#include "AzUtil.hpp"
+#ifndef __AZ_MSDN__
+#include <pthread.h>
+#endif
+
+/*---  a unit of work to be done on a thread  ---*/
+class AzThread_ {
+public:
+  virtual ~AzThread_() {}
+  virtual void run() = 0;  /* called on its own thread; must not write to shared objects */
+};
+
+/*---  run AzThread_ objects in parallel and wait for all of them  ---*/
+/* An AzException thrown on a thread is re-thrown on the calling thread after */
+/* all the threads are done.  Nothing is done in parallel if num is 1 or if   */
+/* compiled with __AZ_MSDN__ (no pthreads).                                   */
+class AzThreads {
+protected:
+#ifndef __AZ_MSDN__
+  class AzThreadArg {
+  public:
+    AzThread_ *thr;
+    AzException *err;
+    AzThreadArg() : thr(NULL), err(NULL) {}
+  };
+  static void *start(void *arg) {
+    AzThreadArg *ta = (AzThreadArg *)arg;
+    try {
+      ta->thr->run();
+    }
+    catch (AzException *e) {
+      ta->err = e;
+    }
+    return NULL;
+  }
+#endif
+public:
+  static void run(AzThread_ **thrs, int num) {
+    const char *eyec = "AzThreads::run";
+    if (num <= 0) return;
+#ifdef __AZ_MSDN__
+    for (int ix = 0; ix < num; ++ix) thrs[ix]->run();
+#else
+    if (num == 1) { thrs[0]->run(); return; }
+    AzBaseArr<AzThreadArg> _args; _args.alloc(num); AzThreadArg *args = _args.point_u();
+    AzBaseArr<pthread_t> _ids; _ids.alloc(num); pthread_t *ids = _ids.point_u();
+    int started = 0;
+    for ( ; started < num; ++started) {
+      args[started].thr = thrs[started];
+      if (pthread_create(&ids[started], NULL, start, &args[started]) != 0) break;
+    }
+    for (int ix = 0; ix < started; ++ix) pthread_join(ids[ix], NULL);
+    AzX::throw_if(started < num, eyec, "Failed to create a thread");
+    for (int ix = 0; ix < num; ++ix) if (args[ix].err != NULL) throw args[ix].err;
+#endif
+  }
+  template <class T> /* T: derived from AzThread_ */
+  static void run(AzDataArr<T> &arr, int num=-1) { /* the first num; all if num < 0 */
+    if (num < 0 || num > arr.size()) num = arr.size();
+    AzBaseArr<AzThread_ *> thrs; thrs.alloc(num);
+    for (int ix = 0; ix < num; ++ix) thrs(ix, arr(ix));
+    run(thrs.point_u(), num);
+  }
+};
+
+/*---  run an AzThread_ object in the background, e.g., to prepare the next input while computing  ---*/
+/* join() waits for it and re-throws an AzException thrown on it.  start() runs */
+/* it on the calling thread if a thread cannot be created or with __AZ_MSDN__.  */
+class AzThreadBg : public AzThreads {
+protected:
+#ifndef __AZ_MSDN__
+  AzThreadArg arg;
+  pthread_t id;
+#endif
+  bool is_running;
+  AzThreadBg(const AzThreadBg &) {} /* not copyable */
+  AzThreadBg & operator =(const AzThreadBg &) { return *this; }
+public:
+  AzThreadBg() : is_running(false) {}
+  ~AzThreadBg() { join(false); }
+  void start(AzThread_ *thr) {
+    join();
+#ifndef __AZ_MSDN__
+    arg.thr = thr; arg.err = NULL;
+    if (pthread_create(&id, NULL, AzThreads::start, &arg) == 0) {
+      is_running = true;
+      return;
+    }
+#endif
+    thr->run();
+  }
+  void join(bool do_throw=true) { /* do_throw=false: discard the exception if any */
+#ifndef __AZ_MSDN__
+    if (!is_running) return;
+    pthread_join(id, NULL);
+    is_running = false;
+    AzException *err = arg.err; arg.err = NULL;
+    if (err == NULL) return;
+    if (do_throw) throw err;
+    delete err;
+#endif
+  }
+};
+#endif
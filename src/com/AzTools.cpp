@@ -255,3 +255,54 @@ void AzTools::writeMatrix(const AzDmat &m, const char *fn, const AzOut &out, int
   }
   AzTimeLog::print("Done ... ", out); 
 }
+
+/*------------------------------------------------------------------*/
+/* Same value as atof (strtod) but faster for short decimal numbers  */
+/* such as "-0.123456" in text files of vectors.  If the mantissa    */
+/* fits in 53 bits and |exponent| <= 22, one multiplication or       */
+/* division of two exact doubles gives the correctly rounded value,  */
+/* as strtod does; otherwise, strtod is called.                      */
+double AzTools::atof_fast(const AzByte *str, const AzByte **end) {
+  static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 }; 
+  const AzByte *p = str; 
+  bool is_neg = (*p == '-'); 
+  if (*p == '-' || *p == '+') ++p; 
+  unsigned long long mant = 0; 
+  int sig = 0, exp10 = 0; 
+  bool is_num = false; 
+  for ( ; *p >= '0' && *p <= '9'; ++p) {
+    is_num = true; 
+    if (mant > 0 || *p != '0') { mant = mant*10 + (*p-'0'); ++sig; }
+  }
+  if (*p == '.') {
+    for (++p; *p >= '0' && *p <= '9'; ++p) {
+      is_num = true; 
+      if (mant > 0 || *p != '0') { mant = mant*10 + (*p-'0'); ++sig; }
+      --exp10; 
+    }
+  }
+  bool is_fast = is_num; 
+  if (is_fast && (*p == 'e' || *p == 'E')) {
+    ++p; 
+    bool is_eneg = (*p == '-'); 
+    if (*p == '-' || *p == '+') ++p; 
+    int e = 0; 
+    is_fast = (*p >= '0' && *p <= '9'); 
+    for ( ; *p >= '0' && *p <= '9'; ++p) if (e < 10000) e = e*10 + (*p-'0'); 
+    exp10 += (is_eneg) ? -e : e; 
+  }
+  if (is_fast) is_fast = (*p == '\0' || *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\v' || *p == '\f'); 
+  if (is_fast) is_fast = (sig <= 19 && mant <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22); 
+  if (!is_fast) {
+    char *e = NULL; 
+    double val = strtod((const char *)str, &e); 
+    if (end != NULL) *end = (const AzByte *)e; 
+    return val; 
+  }
+  double val = (double)mant; 
+  if      (exp10 < 0) val /= pow10[-exp10]; 
+  else if (exp10 > 0) val *= pow10[exp10]; 
+  if (end != NULL) *end = p; 
+  return (is_neg) ? -val : val; 
+}
@@ -91,6 +91,8 @@ public:
     v.reform(ifa.size()); 
     for (int ix = 0; ix < ifa.size(); ++ix) v.set(ix, ifa.get(ix)); 
   }
+  /*---  same value as atof; *end: where the number ends  ---*/
+  static double atof_fast(const AzByte *str, const AzByte **end=NULL); 
 
   static void shuffle(int rand_seed, AzIntArr *iq, bool withReplacement = false); 
   static void shuffle2(AzIntArr &ia); 
@@ -20,6 +20,11 @@
 #include <ctype.h>
 #include "AzUtil.hpp"
 #include "AzPrint.hpp"
+#ifdef __AZ_MSDN__
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 static int th_autoSqueeze = 1024; 
 
@@ -146,6 +151,20 @@ void AzFile::seek(AZint8 offs) {
   seekReadBytes(offs, 0, NULL); 
 }
 
+/*-------------------------------------------------------------*/
+void AzFile::truncate(AZint8 len) {
+  const char *eyec = "AzFile::truncate"; 
+  check_fp(eyec); 
+  AzX::throw_if(fflush(fp) != 0, AzFileIOError, eyec, pointFileName(), "fflush"); 
+#ifdef __AZ_MSDN__
+  int ret = _chsize_s(_fileno(fp), len); 
+#else
+  int ret = ftruncate(fileno(fp), (off_t)len); 
+#endif
+  AzX::throw_if(ret != 0, AzFileIOError, eyec, pointFileName(), "truncate"); 
+  seek(len); 
+}
+
 /*-------------------------------------------------------------*/
 #define AZ_BIN_MARKER_INT 1
 #define AZ_BIN_MARKER_DBL 1.0
@@ -141,6 +141,7 @@ public:
   } 
   
   template <class T>  void writeItems(const T *data, int num) { writeBytes(data, sizeof(T), num); }
+  int readBytesUpTo(AzByte *buff, int buff_len) { return _readBytes(buff, buff_len); } /* fewer bytes only at eof */
   
   virtual int gets(AzByte *buff, int buffsize); 
   virtual void seekReadBytes(AZint8 offs, AZint8 len, void *buff); 
@@ -154,6 +155,7 @@ public:
     return (AZint8)ftell(fp); 
   }
   virtual AZint8 size(); 
+  void truncate(AZint8 len); /* cut the file at len bytes and seek there */
   int size_under2G(const char *msg) { /* prohibit a file larger than 2GB */
     AZint8 _sz = size(); 
     int sz = Az64::to_int((size_t)_sz, msg); 
@@ -198,7 +200,7 @@ public:
     AzFile file(fn); file.open("rb"); cls->read(&file);  file.close(true); 
   }   
 protected:
-  int _readBytes(AzByte *buff, int buff_len) { /* used only by scan */
+  int _readBytes(AzByte *buff, int buff_len) { /* used by scan and readBytesUpTo */
     const char *eyec = "AzFile::readBytes"; 
     check_overflow(buff_len, eyec); 
     check_fp(eyec); 
@@ -0,0 +1,55 @@
+/* * * * *
+ *  AzVarint.hpp
+ *  Copyright (C) 2017 Rie Johnson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * * * * */
+
+#ifndef _AZ_VARINT_HPP_
+#define _AZ_VARINT_HPP_
+
+#include "AzUtil.hpp"
+
+/*---  variable-length encoding of non-negative integers  ---*/
+/* 7 bits per byte, low-order first; the high bit of a byte is on if more    */
+/* bytes follow.  Small values such as the gaps between sorted row#'s take   */
+/* one byte.  zigzag() maps signed values to non-negative ones: 0,-1,1,-2... */
+class AzVarint {
+public:
+  static int size(unsigned int val) {
+    int sz = 1; 
+    for ( ; val >= 0x80; val >>= 7) ++sz; 
+    return sz; 
+  }
+  static AzByte *put(unsigned int val, AzByte *out) { /* return the end */
+    for ( ; val >= 0x80; val >>= 7) *out++ = (AzByte)(val | 0x80); 
+    *out++ = (AzByte)val; 
+    return out; 
+  }
+  static const AzByte *get(const AzByte *inp, const AzByte *end, unsigned int &val) { /* return the end */
+    if (inp < end && *inp < 0x80) { val = *inp; return inp+1; } /* one byte */
+    val = 0; 
+    for (int shift = 0; shift < 35; shift += 7) {
+      AzX::throw_if(inp >= end, AzInputError, "AzVarint::get", "Truncated data"); 
+      AzByte byte = *inp++; 
+      val |= (unsigned int)(byte & 0x7f) << shift; 
+      if (byte < 0x80) return inp; 
+    }
+    AzX::throw_if(true, AzInputError, "AzVarint::get", "Corrupted data"); 
+    return inp; 
+  }
+  static unsigned int zigzag(int val) { return ((unsigned int)val << 1) ^ (unsigned int)(val >> 31); }
+  static int unzigzag(unsigned int val) { return (int)(val >> 1) ^ -(int)(val & 1); }
+}; 
+#endif
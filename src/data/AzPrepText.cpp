@@ -23,6 +23,9 @@
 #include "AzHelp.hpp"
 #include "AzTextMat.hpp"
 #include "AzRandGen.hpp"
+#include "AzThreads.hpp"
+#include "AzCountMin.hpp"
+#include "AzTokCache.hpp"
 
 /*-------------------------------------------------------------------------*/
 class AzPrepText_Param_ {
@@ -60,10 +63,15 @@ public:
   bool do_lower, do_remove_number, do_utf8dashes, do_write_count, do_stop_if_all; 
   int min_count, nn, max_num; 
   bool do_char, do_byte; 
+  int thr_num; 
+  double sketch_mb; 
+  int max_cand; 
+  bool do_sort_word; 
   
   AzPrepText_gen_vocab_Param(int argc, const char *argv[], const AzOut &out)
      : do_lower(false), do_remove_number(false), do_utf8dashes(false), min_count(-1), nn(1), 
-       max_num(-1), do_write_count(false), do_char(false), do_byte(false), do_stop_if_all(false) {
+       max_num(-1), do_write_count(false), do_char(false), do_byte(false), do_stop_if_all(false), thr_num(1), 
+       sketch_mb(-1), max_cand(10000000), do_sort_word(false) {
     reset(argc, argv, out); 
   }
   
@@ -82,9 +90,14 @@ public:
   #define kw_do_char "Char"
   #define kw_do_byte "Byte"  
   #define kw_do_stop_if_all "StopIfAll"
+  #define kw_thr_num "thread_num="
+  #define kw_sketch_mb "sketch_mb="
+  #define kw_max_cand "max_candidates="
+  #define kw_do_sort_word "SortByWord"
 
   #define help_do_lower "Convert upper-case to lower-case characters."
   #define help_do_utf8dashes "Convert UTF8 en dash, em dash, single/double quotes to ascii characters."
+  #define help_do_sort_word "Write the vocabulary file in the byte order of the words instead of in the descending order of the counts so that it can be merged by \"merge_vocab\" with Streaming.  Use it with WriteCount."
   /*-------------------------------------------------------------------------*/
   virtual void resetParam(const AzOut &out, AzParam &azp) {
     const char *eyec = "AzPrepText_gen_vocab_Param::resetParam"; 
@@ -100,12 +113,18 @@ public:
     azp.swOn(o, do_remove_number, kw_do_remove_number); 
     azp.swOn(o, do_utf8dashes, kw_do_utf8dashes); 
     azp.swOn(o, do_write_count, kw_do_write_count); 
+    azp.swOn(o, do_sort_word, kw_do_sort_word); 
     azp.swOn(o, do_char, kw_do_char); 
     if (!do_char) azp.swOn(o, do_byte, kw_do_byte); 
     azp.swOn(o, do_stop_if_all, kw_do_stop_if_all); 
+    azp.vInt(o, kw_thr_num, thr_num); 
+    azp.vFloat(o, kw_sketch_mb, sketch_mb); 
+    if (sketch_mb > 0) azp.vInt(o, kw_max_cand, max_cand); 
   
     AzXi::throw_if_empty(s_inp_fn, eyec, kw_inp_fn); 
     AzXi::throw_if_empty(s_voc_fn, eyec, kw_voc_fn); 
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
+    if (sketch_mb > 0) AzXi::throw_if_nonpositive(max_cand, eyec, kw_max_cand); 
     o.printEnd(); 
   }
       
@@ -122,20 +141,105 @@ public:
     h.item(kw_do_utf8dashes, help_do_utf8dashes); 
     h.item(kw_do_remove_number, "Exclude words that contain numbers.");     
     h.item(kw_do_write_count, "Write word counts as well as the words to the vocabulary file."); 
+    h.item(kw_do_sort_word, help_do_sort_word); 
 
     h.item(kw_nn, "n for n-grams.  E.g., if n=3, only tri-grams are included.");   
+    h.item(kw_thr_num, "Number of threads.  Each file is split into this many chunks, which are processed in parallel.  The output does not depend on this.", "1"); 
+    h.item(kw_sketch_mb, "Use this many megabytes (per thread) for a count-min sketch of word counts in the first pass over the input, and count exactly in the second pass only the words whose estimated counts are large enough to keep at most max_candidates words.  Whether the result is exact is shown at the end.  Use this if the exact counting would run out of memory, e.g., with n-grams.", "Exact counting in one pass"); 
+    h.item(kw_max_cand, "Used with sketch_mb.  Maximum number of words counted exactly in the second pass.", "10000000"); 
     h.end(); 
   }    
 };                      
+
+/*-------------------------------------------------------------------------*/
+/*---  gen_vocab: count words in the lines starting in [offs0, offs1) of a file  ---*/
+/* With cm_out, only the sketch is updated (pass 1 of sketch_mb=).                  */
+/* With cm_in, only the words with estimate >= th are counted (pass 2), and th is   */
+/* raised if the number of counted words exceeds max_cand.                          */
+class AzPrepText_gen_vocab_count : public virtual AzThread_ {
+public:
+  AzStrPoolh sp_voc[256]; /* output */
+  AzCountMin cm_out;      /* output */
+  unsigned int th;        /* input/output */
+protected: 
+  const AzPrepText_gen_vocab_Param *p; 
+  const AzStrPool *sp_stop; 
+  const char *fn; 
+  AZint8 offs0, offs1; 
+  bool do_sketch; 
+  const AzCountMin *cm_in; 
+  int max_cand; 
+public:
+  AzPrepText_gen_vocab_count() : th(0), p(NULL), sp_stop(NULL), fn(NULL), offs0(0), offs1(0), 
+                                 do_sketch(false), cm_in(NULL), max_cand(-1) {}
+  void reset(const AzPrepText_gen_vocab_Param *_p, const AzStrPool *_sp_stop, 
+             const char *_fn, AZint8 _offs0, AZint8 _offs1) {
+    p = _p; sp_stop = _sp_stop; fn = _fn; offs0 = _offs0; offs1 = _offs1; 
+    for (int vx = 0; vx < 256; ++vx) sp_voc[vx].reset(); 
+    do_sketch = false; cm_in = NULL; 
+  }
+  void reset_sketch() { /* call after reset(); cm_out keeps accumulating over the files */
+    do_sketch = true; 
+  }
+  void reset_filter(const AzCountMin *_cm_in, unsigned int _th, int _max_cand) { /* call after reset() */
+    cm_in = _cm_in; th = _th; max_cand = _max_cand; 
+  }
+  void run() {
+    AzTextReader rdr; 
+    rdr.open(fn, offs0, offs1); /* the lines that begin in [offs0, offs1) */
+    int cand_num = 0; 
+    AzBytArr s_ngram; 
+    for ( ; ; ) {
+      AzByte *buff = NULL; 
+      int len = rdr.next(buff); 
+      if (len <= 0) break;
+    
+      AzStrPool sp;     
+      AzTools_text::tokenize(buff, len, p->do_utf8dashes, p->do_lower, sp, p->do_char, p->do_byte); 
+      for (int wx = 0; wx < sp.size(); ++wx) {
+        const char *item = AzPrepText::gen_voc_item(p->nn, sp, wx, p->do_stop_if_all, sp_stop, p->do_remove_number, s_ngram); 
+        if (item == NULL) continue; 
+        if (do_sketch) { cm_out.add(item); continue; }
+        if (cm_in != NULL && cm_in->estimate(item) < th) continue; 
+        AzStrPoolh &sp_v = sp_voc[AzPrepText::gen_1byte_index(&sp, wx)]; 
+        int sz = sp_v.size(); 
+        sp_v.put(item); 
+        if (sp_v.size() > sz && cm_in != NULL && ++cand_num > max_cand) {
+          th = AzPrepText::raise_vocab_threshold(sp_voc, *cm_in, th, max_cand); 
+          cand_num = 0; for (int vx = 0; vx < 256; ++vx) cand_num += sp_voc[vx].size(); 
+        }
+      }
+    }
+    rdr.close(); 
+  }
+}; 
+
+/*---  gen_vocab: merge the counts of the shards vx = shard0, shard0+step, ...  ---*/
+class AzPrepText_gen_vocab_merge : public virtual AzThread_ {
+protected:
+  AzStrPoolh *sp_voc; /* [256] */
+  AzDataArr<AzPrepText_gen_vocab_count> *counts; 
+  int shard0, step; 
+public:
+  AzPrepText_gen_vocab_merge() : sp_voc(NULL), counts(NULL), shard0(0), step(1) {}
+  void reset(AzStrPoolh *_sp_voc, AzDataArr<AzPrepText_gen_vocab_count> *_counts, int _shard0, int _step) {
+    sp_voc = _sp_voc; counts = _counts; shard0 = _shard0; step = _step; 
+  }
+  void run() {
+    for (int vx = shard0; vx < 256; vx += step) {
+      for (int tx = 0; tx < counts->size(); ++tx) {
+        sp_voc[vx].put(&(*counts)(tx)->sp_voc[vx]); 
+        (*counts)(tx)->sp_voc[vx].reset(); 
+      }
+    }
+  }
+}; 
                   
 /*-------------------------------------------------------------------------*/
 void AzPrepText::gen_vocab(int argc, const char *argv[]) const {
   AzPrepText_gen_vocab_Param p(argc, argv, out);  
 
-  AzStrPool sp_voc[256]; 
-  for (int vx = 0; vx < 256; ++vx) {
-    sp_voc[vx].reset(100000,20); 
-  }
+  AzStrPoolh sp_voc[256]; /* hashed; sorted only once at the end */
   
   AzStrPool *sp_stop = NULL, _sp_stop; 
   if (p.s_stop_fn.length() > 0) {
@@ -144,36 +248,58 @@ void AzPrepText::gen_vocab(int argc, const char *argv[]) const {
     if (_sp_stop.size() > 0) sp_stop = &_sp_stop; 
   }  
 
-  AzIntArr ia_data_num; 
-  AzStrPool sp_list; 
-  int buff_size = AzTools_text::scan_files_in_list(p.s_inp_fn.c_str(), p.s_txt_ext.c_str(), 
-                                                   out, &sp_list, &ia_data_num); 
-  buff_size += 256;  /* just in case */
-  AzBytArr s_buff; 
-  AzByte *buff = s_buff.reset(buff_size, 0);                                                    
-
+  AzStrPool sp_list; /* no need to scan: the reader takes care of the line length */
+  AzTools_text::read_file_list(p.s_inp_fn.c_str(), &sp_list); 
+
+  /*---  each file is split into thr_num chunks, counted in parallel, and then  ---*/
+  /*---  merged into sp_voc in parallel, each thread taking care of some shards  ---*/
+  AzDataArr<AzPrepText_gen_vocab_count> counts(p.thr_num); 
+  AzDataArr<AzPrepText_gen_vocab_merge> merges(p.thr_num); 
+  for (int tx = 0; tx < p.thr_num; ++tx) merges(tx)->reset(sp_voc, &counts, tx, p.thr_num); 
+
+  /*---  pass 1 with sketch_mb: sketch the counts of all the words  ---*/
+  AzCountMin cm; 
+  unsigned int th = MAX(1, p.min_count); 
+  if (p.sketch_mb > 0) {
+    AzTimeLog::print("Pass 1: sketching counts ... ", out); 
+    cm.reset(p.sketch_mb); 
+    for (int tx = 0; tx < p.thr_num; ++tx) counts(tx)->cm_out.reset_shape(cm); 
+    for (int fx = 0; fx < sp_list.size(); ++fx) {
+      AzBytArr s_fn(sp_list.c_str(fx), p.s_txt_ext.c_str()); 
+      const char *fn = s_fn.c_str();   
+      AzTimeLog::print(fn, out); 
+      AzFile file(fn); file.open("rb"); AZint8 fsz = file.size(); file.close(); 
+      for (int tx = 0; tx < p.thr_num; ++tx) {
+        counts(tx)->reset(&p, sp_stop, fn, fsz*tx/p.thr_num, fsz*(tx+1)/p.thr_num); 
+        counts(tx)->reset_sketch(); 
+      }
+      AzThreads::run(counts); 
+    }
+    for (int tx = 0; tx < p.thr_num; ++tx) cm.add(counts[tx]->cm_out); /* once after all the files */
+    AzBytArr s("Sketch: width="); s << cm.get_width() << " depth=" << cm.get_depth() << " #word="; s << (double)cm.total_count(); 
+    s << "; overestimate <= " << cm.eps()*(double)cm.total_count() << " with prob >= "; s.cn(1-exp(-(double)cm.get_depth()), 4); 
+    AzTimeLog::print(s, out); 
+    AzTimeLog::print("Pass 2: counting candidates ... ", out); 
+  }
   for (int fx = 0; fx < sp_list.size(); ++fx) {
     AzBytArr s_fn(sp_list.c_str(fx), p.s_txt_ext.c_str()); 
     const char *fn = s_fn.c_str();   
     AzTimeLog::print(fn, out); 
-    AzFile file(fn); file.open("rb"); 
-    for ( ; ; ) {
-      int len = file.gets(buff, buff_size); 
-      if (len <= 0) break;
-    
-      AzStrPool sp;     
-      AzTools_text::tokenize(buff, len, p.do_utf8dashes, p.do_lower, sp, p.do_char, p.do_byte); 
-      for (int wx = 0; wx < sp.size(); ++wx) {
-        int index = gen_1byte_index(&sp, wx); 
-        put_in_voc(p.nn, sp_voc[index], sp, wx, 1, p.do_stop_if_all, sp_stop, p.do_remove_number); 
-      }
+    AzFile file(fn); file.open("rb"); AZint8 fsz = file.size(); file.close(); 
+    for (int tx = 0; tx < p.thr_num; ++tx) {
+      counts(tx)->reset(&p, sp_stop, fn, fsz*tx/p.thr_num, fsz*(tx+1)/p.thr_num); 
+      if (p.sketch_mb > 0) counts(tx)->reset_filter(&cm, th, MAX(1, p.max_cand/p.thr_num)); 
+    }
+    AzThreads::run(counts); 
+    AzThreads::run(merges); 
+    if (p.sketch_mb > 0) {
+      for (int tx = 0; tx < p.thr_num; ++tx) th = MAX(th, counts[tx]->th); 
+      th = raise_vocab_threshold(sp_voc, cm, th, p.max_cand); 
     }
     int num = 0; 
-    for (int vx = 0; vx < 256; ++vx) {
-      sp_voc[vx].commit(); 
-      num += sp_voc[vx].size(); 
-    }    
-    AzTimeLog::print(" ... size: ", num, out); 
+    for (int vx = 0; vx < 256; ++vx) num += sp_voc[vx].size(); 
+    if (p.sketch_mb > 0) AzTimeLog::print(" ... size: ", num, " threshold: ", (int)th, out); 
+    else                 AzTimeLog::print(" ... size: ", num, out); 
   }
   if (p.min_count > 1) {
     int num = 0; 
@@ -184,37 +310,94 @@ void AzPrepText::gen_vocab(int argc, const char *argv[]) const {
     AzTimeLog::print("Removed <min_count -> ", num, out);     
   }
   AzTimeLog::print("Merging ... ", out); 
-  for (int vx = 1; vx < 256; ++vx) {
-    sp_voc[0].put(&sp_voc[vx]); 
+  AzStrPool sp_all; 
+  for (int vx = 0; vx < 256; ++vx) {
+    sp_voc[vx].put_to(&sp_all); 
     sp_voc[vx].reset(); 
   }
-  sp_voc[0].commit(); 
+  sp_all.commit(); 
   AzTimeLog::print("Writing to ", p.s_voc_fn.c_str(), out); 
-  int sz = write_vocab(p.s_voc_fn.c_str(), &sp_voc[0], p.max_num, p.min_count, p.do_write_count); 
+  int sz = write_vocab(p.s_voc_fn.c_str(), &sp_all, p.max_num, p.min_count, p.do_write_count, p.do_sort_word); 
   AzTimeLog::print("Done: size=", sz, out); 
+  if (p.sketch_mb > 0) check_vocab_threshold(sp_all, p.max_num, p.min_count, th); 
+}
+
+/*-------------------------------------------------------------------------*/
+/* With sketch_mb, the counts of all the words with count >= th are exact, and */
+/* the others are missing.  So the output is exact if th was not raised beyond */
+/* min_count, or if the smallest count written is >= th.                      */
+void AzPrepText::check_vocab_threshold(const AzStrPool &sp, int max_num, int min_count, unsigned int th) const {
+  if (th <= (unsigned int)MAX(1, min_count)) {
+    AzPrint::writeln(out, "The vocabulary is exact."); 
+    return; 
+  }
+  AzIFarr ifa_count; sp.getAllCount(&ifa_count); 
+  ifa_count.sort_Float(false); 
+  int num = (max_num > 0) ? MIN(max_num, ifa_count.size()) : ifa_count.size(); 
+  double last_count = (num > 0) ? ifa_count.get(num-1) : 0; 
+  if (max_num > 0 && num >= max_num && last_count >= th) {
+    AzBytArr s("The vocabulary is exact: the smallest count written ("); s << last_count << ") >= threshold (" << (double)th << ")."; 
+    AzPrint::writeln(out, s); 
+  }
+  else {
+    AzBytArr s("!WARNING! The vocabulary may be missing words with counts < "); s << (double)th; 
+    s << ".  Increase max_candidates= or sketch_mb=."; 
+    AzPrint::writeln(out, s); 
+  }
 }
 
 /*-------------------------------------------------------------------------*/
-void AzPrepText::put_in_voc(int nn, 
-                  AzStrPool &sp_voc, 
+/* Raise th so that at most max_cand words have sketch estimates >= th, and */
+/* remove the words with estimates < th.  Since the estimates don't change  */
+/* in pass 2 and never underestimate, the counts of the remaining words     */
+/* are exact and the removed words have counts < th.                        */
+unsigned int AzPrepText::raise_vocab_threshold(AzStrPoolh *sp_voc, /* [256] */
+                                               const AzCountMin &cm, unsigned int th, int max_cand) /* static */ {
+  AzIntArr ia_est; 
+  for (int vx = 0; vx < 256; ++vx) {
+    for (int ex = 0; ex < sp_voc[vx].size(); ++ex) {
+      int len; const AzByte *bytes = sp_voc[vx].point(ex, &len); 
+      unsigned int est = cm.estimate(bytes, len); 
+      if (est >= th) ia_est.put((int)MIN(est, (unsigned int)0x7fffffff)); 
+    }
+  }
+  if (ia_est.size() > max_cand) { 
+    ia_est.sort(false); /* descending */
+    int keep = MAX(1, max_cand/2); 
+    th = MAX(th+1, (unsigned int)ia_est.get(keep-1)); 
+    if (ia_est.get(keep-1) == ia_est.get(0)) th = (unsigned int)ia_est.get(0)+1; /* all tied */
+  }
+  for (int vx = 0; vx < 256; ++vx) {
+    AzIntArr ia_keep; 
+    for (int ex = 0; ex < sp_voc[vx].size(); ++ex) {
+      int len; const AzByte *bytes = sp_voc[vx].point(ex, &len); 
+      if (cm.estimate(bytes, len) >= th) ia_keep.put(ex); 
+    }
+    if (ia_keep.size() < sp_voc[vx].size()) sp_voc[vx].reduce(&ia_keep); 
+  }
+  return th; 
+}
+
+/*-------------------------------------------------------------------------*/
+/* Return the vocabulary item (word or n-gram) at wx, or NULL if it is excluded. */
+const char *AzPrepText::gen_voc_item(int nn, 
                   const AzStrPool &sp_words, 
                   int wx, /* position in sp_words */
-                  AZint8 count, 
                   bool do_stop_if_all, 
                   const AzStrPool *sp_stop, 
-                  bool do_remove_number) /* static */ {
-  if (wx < 0 || wx+nn > sp_words.size()) return; 
+                  bool do_remove_number, 
+                  AzBytArr &s_ngram) /* static */ { /* work area */
+  if (wx < 0 || wx+nn > sp_words.size()) return NULL; 
   if (nn == 1) {
     if (sp_stop != NULL && sp_stop->find(sp_words.c_str(wx)) >= 0 ||       
-        do_remove_number && strpbrk(sp_words.c_str(wx), "0123456789") != NULL) {}
-    else sp_voc.put(sp_words.c_str(wx), count); 
+        do_remove_number && strpbrk(sp_words.c_str(wx), "0123456789") != NULL) return NULL; 
+    return sp_words.c_str(wx); 
   }
   else {
-    AzBytArr s_ngram;   
+    s_ngram.reset(); 
     sp_words.compose_ngram(s_ngram, wx, nn, do_stop_if_all, sp_stop, do_remove_number); 
-    if (s_ngram.length() > 0) {
-      sp_voc.put(s_ngram.c_str(), count); 
-    }
+    if (s_ngram.length() > 0) return s_ngram.c_str(); 
+    return NULL; 
   }
 } 
 
@@ -233,7 +416,8 @@ AzByte AzPrepText::gen_1byte_index(const AzStrPool *sp_words, int wx)
 int AzPrepText::write_vocab(const char *fn, const AzStrPool *sp, 
                             int max_num, 
                             int min_count, 
-                            bool do_write_count)
+                            bool do_write_count, 
+                            bool do_sort_word) /* order by word instead of count */
 {
   AzFile file(fn); file.open("wb"); 
   AzIFarr ifa_ix_count; ifa_ix_count.prepare(sp->size()); 
@@ -243,11 +427,23 @@ int AzPrepText::write_vocab(const char *fn, const AzStrPool *sp,
   } 
   ifa_ix_count.sort_FloatInt(false, true); /* float: descending, int: ascending */
   ifa_ix_count.cut(max_num); 
+  AzStrPool sp_sorted; 
+  if (do_sort_word) { /* e.g., for merge_vocab Streaming */
+    sp_sorted.reset(ifa_ix_count.size(), 10); 
+    for (int ix = 0; ix < ifa_ix_count.size(); ++ix) {
+      int idx; ifa_ix_count.get(ix, &idx); 
+      int len; const AzByte *bytes = sp->point(idx, &len); 
+      sp_sorted.put(bytes, len, sp->getCount(idx)); 
+    }
+    sp_sorted.commit(); 
+  }
   for (int ix = 0; ix < ifa_ix_count.size(); ++ix) {
-    int idx; 
-    ifa_ix_count.get(ix, &idx); 
-    AzBytArr s(sp->c_str(idx)); 
-    if (do_write_count) s << '\t' << sp->getCount(idx); 
+    const AzStrPool *sp_w = sp; 
+    int idx = ix; 
+    if (do_sort_word) sp_w = &sp_sorted; 
+    else              ifa_ix_count.get(ix, &idx); 
+    AzBytArr s(sp_w->c_str(idx)); 
+    if (do_write_count) s << '\t' << sp_w->getCount(idx); 
     s.nl(); s.writeText(&file);  
   }
   file.close(true); 
@@ -256,6 +452,7 @@ int AzPrepText::write_vocab(const char *fn, const AzStrPool *sp,
  
 /*-------------------------------------------------------------------------*/
 #define xtext_ext ".xtext"
+#define help_thr_num "Number of threads.  Documents are read in batches, and each batch is split into this many chunks, which are processed in parallel.  The output does not depend on this."
 /*-------------------------------------------------------------------------*/
 class AzPrepText_gen_regions_Param : public virtual AzPrepText_Param_ {
 public:
@@ -272,9 +469,13 @@ public:
   AzBytArr s_inppos_fn; 
   bool do_unkw; 
   int shift_right, shift_left; /* used only with inppos_fn */
+  int thr_num, batch_num; 
+  bool do_compress; 
+  int hash_bits, hash_nn; 
+  AzBytArr s_tokc_ext; 
   
   AzPrepText_gen_regions_Param(int argc, const char *argv[], const AzOut &out) 
-    : do_bow(false), do_skip_stopunk(false), do_lower(false), pch_sz(-1), pch_step(1), padding(0), 
+    : thr_num(1), batch_num(1), do_compress(false), hash_bits(-1), hash_nn(1), do_bow(false), do_skip_stopunk(false), do_lower(false), pch_sz(-1), pch_step(1), padding(0), 
       do_allow_zero(false), do_allow_multi(false), do_allow_nocat(false), do_utf8dashes(false), 
       do_region_only(false), s_x_ext(".xsmatbcvar"), s_y_ext(".y"), do_write_pos(false), do_ignore_bad(false), do_unkw(false), 
       shift_right(-1), shift_left(-1), do_char(false), do_byte(false), do_contain(false), 
@@ -299,12 +500,18 @@ public:
   #define kw_y_ext "y_ext="   
   #define kw_x_ext "x_ext="
   #define kw_batch_id "batch_id="
+  #define kw_num "num_batches="
   #define kw_inppos_fn "input_pos_fn="
   #define kw_do_write_pos "WritePositions"
   #define kw_do_ignore_bad "ExcludeMultiNo"
   #define kw_do_unkw "Unkw"
+  #define kw_do_compress "Compress"
   #define kw_shift_left "shift_left="
   #define kw_shift_right "shift_right="
+  #define kw_hash_bits "hash_bits="
+  #define kw_hash_nn "hash_n="
+  #define AzPrepText_hash_bits_max 24
+  #define kw_tokc_ext "token_cache_ext="
   /*-------------------------------------------------------------------------*/  
   virtual void resetParam(const AzOut &out, AzParam &azp) {
     const char *eyec = "AzPrepText_gen_regions_Param::resetParam";   
@@ -320,7 +527,10 @@ public:
     azp.swOn(o, do_bow, kw_do_bow, kw_do_bow_old);
     azp.vStr(o, kw_inp_fn, s_inp_fn); 
     azp.vStr(o, kw_txt_ext, s_txt_ext); 
-    azp.vStr(o, kw_voc_fn, s_voc_fn); 
+    azp.vStr_prt_if_not_empty(o, kw_tokc_ext, s_tokc_ext); 
+    azp.vInt(o, kw_hash_bits, hash_bits); 
+    if (hash_bits > 0) azp.vInt(o, kw_hash_nn, hash_nn); 
+    else               azp.vStr(o, kw_voc_fn, s_voc_fn); 
     azp.vStr(o, kw_rnm, s_rnm); 
     azp.swOn(o, do_lower, kw_do_lower); 
     azp.swOn(o, do_utf8dashes, kw_do_utf8dashes); 
@@ -332,6 +542,7 @@ public:
     azp.vStr(o, kw_y_ext, s_y_ext); 
     azp.vStr(o, kw_x_ext, s_x_ext); 
     azp.vStr_prt_if_not_empty(o, kw_batch_id, s_batch_id); 
+    azp.vInt(o, kw_num, batch_num); 
     
     azp.vStr_prt_if_not_empty(o, kw_inppos_fn, s_inppos_fn); /* positions of regions for which vectors are generated */
     if (s_inppos_fn.length() <= 0) {
@@ -346,6 +557,8 @@ public:
       if (shift_left <= 0) azp.vInt(o, kw_shift_right, shift_right); 
     }
     azp.swOn(o, do_unkw, kw_do_unkw); 
+    azp.vInt(o, kw_thr_num, thr_num); 
+    azp.swOn(o, do_compress, kw_do_compress); 
     
     AzXi::throw_if_both(do_unkw && do_bow, eyec, kw_do_unkw, kw_do_bow); 
     
@@ -354,19 +567,30 @@ public:
       AzXi::throw_if_empty(s_cat_ext, eyec, kw_cat_ext);     
       AzXi::throw_if_empty(s_cat_dic_fn, eyec, kw_cat_dic_fn);  
     }
-    AzXi::throw_if_empty(s_voc_fn, eyec, kw_voc_fn);   
+    if (hash_bits > 0) {
+      AzX::throw_if(hash_bits > AzPrepText_hash_bits_max, AzInputError, eyec, kw_hash_bits, " must be no greater than 24."); 
+      AzXi::throw_if_nonpositive(hash_nn, eyec, kw_hash_nn); 
+      AzXi::throw_if_both(do_unkw, eyec, kw_do_unkw, kw_hash_bits); 
+      AzX::no_support(hash_nn > 1 && !do_bow, eyec, "n-gram sequential"); 
+      AzX::no_support(hash_nn > 1 && do_skip_stopunk, eyec, "n-gram VariableStride"); 
+    }
+    else AzXi::throw_if_empty(s_voc_fn, eyec, kw_voc_fn);   
     AzXi::throw_if_empty(s_rnm, eyec, kw_rnm);     
     AzX::throw_if(s_rnm.contains('+'), AzInputError, eyec, kw_rnm, " must not conatin \'+\'."); 
     AzXi::throw_if_empty(s_y_ext, eyec, kw_y_ext);         
     
     AzStrPool sp_x_ext(10,10); sp_x_ext.put(".xsmatbcvar", ".xsmatcvar"); /* We need .xsmatcvar for seq2-bown */
     AzXi::check_input(s_x_ext, &sp_x_ext, eyec, kw_x_ext);       
+    AzX::no_support(do_compress && !s_x_ext.contains("bc"), eyec, kw_do_compress " with x_ext=.xsmatcvar"); 
     
     AzXi::throw_if_nonpositive(pch_sz, eyec, kw_pch_sz); 
     if (s_inppos_fn.length() <= 0) {
       AzXi::throw_if_nonpositive(pch_step, eyec, kw_pch_step); 
       AzXi::throw_if_negative(padding, eyec, kw_padding);        
     }
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
+    AzXi::throw_if_nonpositive(batch_num, eyec, kw_num); 
+    AzXi::throw_if_both(batch_num > 1 && s_batch_id.length() > 0, eyec, kw_num, kw_batch_id); 
     o.printEnd(); 
   }
 
@@ -377,11 +601,14 @@ public:
   #define help_voc_fn "Path to the vocabulary file generated by \"gen_vocab\" (input)." 
   #define help_y_ext "Filename extension of the target file (output).  \".y\" | \".ysmat\".  Use \".ysmat\" when the number of classes is large."
   #define help_batch_id "Batch ID, e.g., \"1of5\" (the first batch out of 5), \"2of5\" (the second batch out of 5).  Specify this when making multiple files for one dataset."
+  #define help_batch_num "Number of output batches.  The documents are divided into this many batches in order, and each is written to the files with the extension, e.g., \".1of5\", as soon as it is done so that only one batch is kept in memory.  Use \"num_batches=\" of \"reNet\" to read them.  If this is greater than 1, the text files may be read once more beforehand to count the documents."
+  #define help_tokc_ext "Filename extension of the token cache file(s) written by \"tokenize_corpus\".  If specified, the token cache file(s) are read instead of the text file(s) so that tokenization is skipped.  The output is the same.  LowerCase and UTF8 (and Char and Byte if any) must be the same as in \"tokenize_corpus\"."
+  #define help_do_compress "Compress the binary region and target files (*smatbc*) by encoding the row indexes as variable-length gaps.  \"reNet\" reads both formats.  Use \"prepText compress_regions\" to convert existing files."
   void printHelp(const AzOut &out) const {
     AzHelp h(out); 
     h.item_required(kw_inp_fn, help_inp_fn); 
     h.item_required(kw_cat_dic_fn, help_cat_dic_fn); 
-    h.item_required(kw_voc_fn, help_voc_fn); 
+    h.item_required(kw_voc_fn, help_voc_fn " Not required with hash_bits."); 
     h.item_required(kw_rnm, "Pathname stem of the region file, target file, and word-mapping file (output).  To make the pathnames, the respective extensions will be attached."); 
     h.item(kw_x_ext, "Filename extension of the region file (output).  \".xsmatcvar\" | \".xsmatbcvar\".", ".xsmatbcvar");     
 /*    h.item(kw_y_ext, help_y_ext, ".y"); */
@@ -389,6 +616,7 @@ public:
     h.item(kw_pch_step, "Region stride.", "1"); 
     h.item(kw_padding, "Padding size.", "0"); 
     h.item(kw_txt_ext, help_txt_ext, ".txt.tok"); 
+    h.item(kw_tokc_ext, help_tokc_ext); 
     h.item(kw_cat_ext, help_cat_ext, ".cat");     
     h.item(kw_do_bow, "Use bag-of-word representation for sparse region vectors."); 
     h.item(kw_do_skip_stopunk, "Take variable strides.");      
@@ -399,12 +627,142 @@ public:
     h.item(kw_do_region_only, "Generate a region file only.  Do not generate a target file.");
       
     h.item(kw_batch_id, help_batch_id); 
+    h.item(kw_num, help_batch_num, "1"); 
+    h.item(kw_thr_num, "Number of threads.  Documents are read in batches, and each batch is split into this many chunks, which are processed in parallel.  The output does not depend on this.", "1"); 
+    h.item(kw_do_compress, help_do_compress); 
+    h.item(kw_hash_bits, "k: Use feature hashing instead of a vocabulary file so that \"gen_vocab\" is not needed: each word (or n-gram) is mapped to one of 2^k dimensions by its hash.  1 <= k <= 24.  Collisions are not resolved.  The word-mapping file is then one line \"#hash<k>n<n-list>\" (followed by \"p<region size>\" without Bow) so that \"reNet\" can check that training and test data agree."); 
+    h.item(kw_hash_nn, "n: With hash_bits and Bow, use 1-grams through n-grams.", "1"); 
     h.end(); 
   }   
 }; 
 
 /*-------------------------------------------------------------------------*/
-int AzPrepText::add_unkw(AzDic &dic) const {
+/*---  gen_regions: generate regions of the documents [dx_beg, dx_end) of a batch  ---*/
+/* The output (bc, ia_dcolind, and positions) is relative to this chunk; it is */
+/* appended to the output batch in the order of chunks so that the result is  */
+/* the same as processing the documents one by one.                            */
+class AzPrepText_gen_regions_thread : public virtual AzThread_ {
+public:
+  Az_bc bc;            /* output */
+  AzIntArr ia_dcolind; /* output */
+  AzIntArr ia_pos_all, ia_pos_end; /* output: positions of the documents concatenated; only for WritePositions */
+protected:
+  const AzPrepText_gen_regions_Param *p; 
+  const AzDic *dic_word; 
+  AzIntArr ia_nn; 
+  int unkw_id; 
+  const AzDataArr<AzIntArr> *aia_inppos; /* NULL if no input positions */
+  const AzTokCache *tokc; /* NULL if the documents are text */
+  AzPrepText_docs *docs; /* tagged with data# */
+  int dx_beg, dx_end; 
+public:
+  AzPrepText_gen_regions_thread() : p(NULL), dic_word(NULL), unkw_id(-1), aia_inppos(NULL), 
+                                    tokc(NULL), docs(NULL), dx_beg(0), dx_end(0) {}
+  void reset_common(const AzPrepText_gen_regions_Param *_p, const AzDic *_dic_word, const AzIntArr &_ia_nn, 
+                    int _unkw_id, const AzDataArr<AzIntArr> *_aia_inppos, const AzTokCache *_tokc) {
+    p = _p; dic_word = _dic_word; ia_nn.reset(&_ia_nn); unkw_id = _unkw_id; 
+    aia_inppos = _aia_inppos; tokc = _tokc; 
+  }
+  void reset_docs(AzPrepText_docs *_docs, int _dx_beg, int _dx_end) {
+    docs = _docs; dx_beg = _dx_beg; dx_end = _dx_end; 
+    bc.reset(dx_end-dx_beg, 0); 
+    ia_dcolind.reset(); ia_dcolind.prepare((dx_end-dx_beg)*2); 
+    ia_pos_all.reset(); ia_pos_end.reset(); 
+  }
+  void run() {
+    const char *eyec = "AzPrepText::gen_regions"; 
+    for (int dx = dx_beg; dx < dx_end; ++dx) {
+      int data_no = docs->no(dx), len = 0; 
+      AzByte *buff = docs->point_u(dx, &len); 
+      AzIntArr ia_pos, *ia_opos = (p->do_write_pos) ? &ia_pos : NULL; 
+      AzDataArr<AzIntArr> aia_xtokno; 
+      int voc_sz = (p->hash_bits > 0) ? (1 << p->hash_bits) : dic_word->size(); 
+      int t_num = 0; 
+      if (tokc != NULL) t_num = (p->hash_bits > 0) ? tokc->identify_hashed(buff, len, p->hash_bits, ia_nn, aia_xtokno) 
+                                                   : tokc->identify(buff, len, dic_word, ia_nn, aia_xtokno); 
+      else t_num = (p->hash_bits > 0) 
+                  ? AzTools_text::tokenize_hashed(buff, len, p->hash_bits, ia_nn, p->do_lower, p->do_utf8dashes, 
+                                                  aia_xtokno, p->do_char, p->do_byte) 
+                  : AzTools_text::tokenize(buff, len, dic_word, ia_nn, p->do_lower, p->do_utf8dashes, 
+                                           aia_xtokno, p->do_char, p->do_byte);  
+      bc.check_overflow(eyec, t_num*p->pch_sz*ia_nn.size(), data_no);   
+      ia_dcolind.put(bc.colNum()); 
+      if (p->do_bow) {
+        if (aia_inppos != NULL) AzPrepText::gen_bow_regions_pos(t_num, aia_xtokno, ia_nn, p->do_contain, p->pch_sz, 
+                                                                *(*aia_inppos)[data_no], bc, ia_opos);     
+        else AzPrepText::gen_bow_regions(t_num, aia_xtokno, ia_nn, p->do_contain, p->pch_sz, p->pch_step, p->padding, 
+                                         p->do_allow_zero, p->do_skip_stopunk, bc, ia_opos); 
+      }
+      else {
+        if (aia_inppos != NULL) AzPrepText::gen_nobow_regions_pos(t_num, aia_xtokno, voc_sz, p->pch_sz, 
+                                                                  *(*aia_inppos)[data_no], unkw_id, bc, ia_opos);     
+        else AzPrepText::gen_nobow_regions(t_num, aia_xtokno, voc_sz, p->pch_sz, p->pch_step, p->padding, 
+                                           p->do_allow_zero, unkw_id, bc, ia_opos); 
+      }        
+      ia_dcolind.put(bc.colNum()); 
+      if (p->do_write_pos) {
+        ia_pos_all.concat(&ia_pos); ia_pos_end.put(ia_pos_all.size()); 
+      }
+    }
+  }
+  
+  /*---  process a batch in parallel and append the output to bc, ia_dcolind, and positions in order  ---*/
+  static void run_batch(AzDataArr<AzPrepText_gen_regions_thread> &thrs, AzPrepText_docs &docs, 
+                        Az_bc &bc, AzIntArr &ia_dcolind, AzIntArr &ia_pos_all, AzIntArr &ia_pos_end) {
+    int num = docs.run(thrs); 
+    for (int tx = 0; tx < num; ++tx) {
+      AzPrepText_gen_regions_thread *thr = thrs(tx); 
+      ia_dcolind.concat(&thr->ia_dcolind, bc.colNum()); 
+      bc.concat(thr->bc); 
+      ia_pos_end.concat(&thr->ia_pos_end, ia_pos_all.size()); 
+      ia_pos_all.concat(&thr->ia_pos_all); 
+      thr->bc.destroy(); thr->ia_dcolind.reset(); thr->ia_pos_all.reset(); thr->ia_pos_end.reset(); 
+    }
+    docs.clear(); 
+  }
+}; 
+
+/*---  gen_regions: an output batch  ---*/
+class AzPrepText_gen_regions_out {
+public:
+  AzSmat m_cat;        /* [data_no-data_beg] */
+  Az_bc bc; 
+  AzIntArr ia_dcolind; 
+  AzIntArr ia_pos_all, ia_pos_end; /* only for WritePositions */
+  bool is_prepped; 
+  int data_beg; 
+  AzPrepText_gen_regions_out() : bc(0, 0), is_prepped(false), data_beg(0) {}
+  
+  /*---  write the data [data_beg, data_end) and clear for the next batch  ---*/
+  void write(const AzOut &out, const AzPrepText_gen_regions_Param &p, int row_num, int data_end, const AzBytArr &s_batch_id) {
+    const char *outnm = p.s_rnm.c_str(); 
+    bc.commit(); 
+    cout << bc.elmNum() << " " << bc.colNum() << endl;   
+    AzPrepText::write_regions(out, bc, row_num, ia_dcolind, s_batch_id, outnm, p.s_x_ext.c_str(), p.do_compress);  
+    if (!p.do_region_only) { /* labeled data */
+      m_cat.resize(data_end-data_beg); 
+      AzBytArr s_y_fn(outnm, p.s_y_ext.c_str()); 
+      AzPrepText::write_Y(out, m_cat, s_y_fn, &s_batch_id, p.do_compress); 
+      m_cat.reform(m_cat.rowNum(), 1024); 
+    }
+    if (p.do_write_pos) {
+      AzBytArr s_pos_fn(outnm, ".pos"); 
+      if (s_batch_id.length() > 0) s_pos_fn << "." << s_batch_id.c_str();
+      AzDataArr<AzIntArr> aia_outpos(ia_pos_end.size()); 
+      for (int dx = 0; dx < ia_pos_end.size(); ++dx) {
+        int beg = (dx > 0) ? ia_pos_end[dx-1] : 0; 
+        aia_outpos(dx)->reset(ia_pos_all.point()+beg, ia_pos_end[dx]-beg); 
+      }
+      AzFile::write(s_pos_fn.c_str(), &aia_outpos);   
+    }
+    bc.reset(0, 0); ia_dcolind.reset(); ia_pos_all.reset(); ia_pos_end.reset(); 
+    is_prepped = false; data_beg = data_end; 
+  }
+}; 
+
+/*-------------------------------------------------------------------------*/
+/* static */
+int AzPrepText::add_unkw(const AzOut &out, AzDic &dic) {
   AzStrPool sp_words(&dic.ref()); 
   AzBytArr s("__UNK__"); 
   for ( ; ; ) {
@@ -424,27 +782,39 @@ void AzPrepText::gen_regions(int argc, const char *argv[]) const {
   AzPrepText_gen_regions_Param p(argc, argv, out);   
   check_y_ext(p.s_y_ext, eyec); 
   check_batch_id(p.s_batch_id); 
-  AzDic dic_word(p.s_voc_fn.c_str()); /* read the vocabulary set */
-  AzX::throw_if(dic_word.size() <= 0, AzInputError, eyec, "empty dic: ", p.s_voc_fn.c_str()); 
-  
-  int max_nn = dic_word.get_max_n(); 
+  AzDic dic_word; 
   AzIntArr ia_nn; 
-  if (max_nn == 1) ia_nn.put(1); 
+  int unkw_id = -1; 
+  if (p.hash_bits > 0) { /* feature hashing: no vocabulary */
+    for (int nn = 1; nn <= p.hash_nn; ++nn) ia_nn.put(nn); 
+    AzBytArr s("Feature hashing: 2^"); s << p.hash_bits << " dimensions, "; 
+    if (p.hash_nn > 1) s << "1-"; 
+    s << p.hash_nn << " grams"; 
+    AzPrint::writeln(out, s.c_str()); 
+    AzTools_text::gen_hash_dic(p.hash_bits, ia_nn, (p.do_bow) ? 1 : p.pch_sz, dic_word); /* for the word-mapping file */
+  }
   else {
-    AzX::no_support((max_nn == 0), eyec, "Empty vocabulary"); 
-    int min_nn = dic_word.get_min_n(); 
-    AzBytArr s("Vocabulary with "); 
-    if (min_nn != max_nn) s << min_nn << "-"; 
-    s << max_nn << " grams"; 
-    AzPrint::writeln(out, s.c_str());     
-    for (int ix = min_nn; ix <= max_nn; ++ix) ia_nn.put(ix); 
+    dic_word.reset(p.s_voc_fn.c_str()); /* read the vocabulary set */
+    AzX::throw_if(dic_word.size() <= 0, AzInputError, eyec, "empty dic: ", p.s_voc_fn.c_str()); 
+  
+    int max_nn = dic_word.get_max_n(); 
+    if (max_nn == 1) ia_nn.put(1); 
+    else {
+      AzX::no_support((max_nn == 0), eyec, "Empty vocabulary"); 
+      int min_nn = dic_word.get_min_n(); 
+      AzBytArr s("Vocabulary with "); 
+      if (min_nn != max_nn) s << min_nn << "-"; 
+      s << max_nn << " grams"; 
+      AzPrint::writeln(out, s.c_str());     
+      for (int ix = min_nn; ix <= max_nn; ++ix) ia_nn.put(ix); 
+    }
+    AzXi::throw_if_both(p.do_unkw && max_nn != 1, eyec, kw_do_unkw, "n-grams with n>1"); 
+    if (p.do_unkw) unkw_id = add_unkw(dic_word); 
+    dic_word.build_hash(); /* for looking up n-grams without composing strings */
+    AzXi::throw_if_both(p.do_unkw && p.do_bow, eyec, kw_do_unkw, kw_do_bow); 
+    AzX::no_support(max_nn>1 && !p.do_bow, eyec, "n-gram sequential"); 
+    AzX::no_support(max_nn>1 && p.do_skip_stopunk, eyec, "n-gram VariableStride"); 
   }
-  int unkw_id = -1; 
-  AzXi::throw_if_both(p.do_unkw && max_nn != 1, eyec, kw_do_unkw, "n-grams with n>1"); 
-  if (p.do_unkw) unkw_id = add_unkw(dic_word); 
-  AzXi::throw_if_both(p.do_unkw && p.do_bow, eyec, kw_do_unkw, kw_do_bow); 
-  AzX::no_support(max_nn>1 && !p.do_bow, eyec, "n-gram sequential"); 
-  AzX::no_support(max_nn>1 && p.do_skip_stopunk, eyec, "n-gram VariableStride"); 
   
   AzDataArr<AzIntArr> aia_inppos;   
   bool do_pos = false; 
@@ -465,45 +835,86 @@ void AzPrepText::gen_regions(int argc, const char *argv[]) const {
   AzDic dic_cat; 
   if (!p.do_region_only) dic_cat.reset(p.s_cat_dic_fn.c_str());  /* read categories */
 
-  /*---  scan files to determine buffer size and #data  ---*/
+  /*---  no scan: #data is counted while reading, and memory is sized from the bytes  ---*/
+  bool do_tokc = (p.s_tokc_ext.length() > 0); /* read token caches instead of text */
+  const char *inp_ext = (do_tokc) ? p.s_tokc_ext.c_str() : p.s_txt_ext.c_str(); 
   AzStrPool sp_list; 
-  AzIntArr ia_data_num; 
-  int buff_size = AzTools_text::scan_files_in_list(p.s_inp_fn.c_str(), p.s_txt_ext.c_str(), 
-                                                   out, &sp_list, &ia_data_num); 
-  int data_num = ia_data_num.sum(); 
-  AzDataArr<AzIntArr> aia_outpos(data_num); 
+  AzTools_text::read_file_list(p.s_inp_fn.c_str(), &sp_list); 
+  AZint8 bytes_all = 0; 
+  for (int fx = 0; fx < sp_list.size(); ++fx) {
+    AzBytArr s_inp_fn(sp_list.c_str(fx), inp_ext); 
+    AzFile file(s_inp_fn.c_str()); file.open("rb"); bytes_all += file.size(); file.close(); 
+  }
+  int doc_num = -1; 
+  if (p.batch_num > 1) { /* count the documents to divide them into batches in order */
+    AzIntArr ia_data_num; 
+    if (do_tokc) AzTokCache::scan_files_in_list(p.s_inp_fn.c_str(), inp_ext, out, NULL, &ia_data_num); /* headers only */
+    else         AzTools_text::scan_files_in_list(p.s_inp_fn.c_str(), inp_ext, out, NULL, &ia_data_num); 
+    doc_num = ia_data_num.sum(); 
+    AzX::throw_if(p.batch_num > doc_num, AzInputError, eyec, kw_num, " exceeds #data"); 
+  }
   
-  /*---  read data and generate features  ---*/
-  AzSmat m_cat; 
-  if (!p.do_region_only) m_cat.reform(dic_cat.size(), data_num); 
-
-  int chkmem=100, wlen=5; /* estimamte required memory size after 100 documents; assume a word is 5 char long. */
-  int ini = buff_size*chkmem/wlen*2;
-  Az_bc bc(ini, ini*p.pch_sz*ia_nn.size()); 
-  AzIntArr ia_dcolind(data_num*2); 
+  /*---  read data and generate features; with num_batches, only one output batch is kept in memory  ---*/
+  AzPrepText_gen_regions_out o; 
+  if (!p.do_region_only) o.m_cat.reform(dic_cat.size(), 1024); /* grows as needed */
+  AZint8 batch_bytes = MAX(1, bytes_all/p.batch_num), bytes_done = 0; /* memory is sized once 1/16 of it is done */
+  int bx = 0, doc_end = (p.batch_num > 1) ? doc_num/p.batch_num : -1; /* output batch#bx ends at doc#doc_end */
   
-  AzX::throw_if((do_pos && aia_inppos.size() != data_num), AzInputError, eyec, kw_inppos_fn, "#data mismatch");  
+  /*---  documents are read in batches of bounded size; regions are generated in parallel  ---*/
+  AzTokCache tokc; /* reopened for each file; a batch is processed before that */
+  AzDataArr<AzPrepText_gen_regions_thread> thrs(p.thr_num); 
+  for (int tx = 0; tx < p.thr_num; ++tx) thrs(tx)->reset_common(&p, &dic_word, ia_nn, unkw_id, (do_pos) ? &aia_inppos : NULL, 
+                                                                (do_tokc) ? &tokc : NULL); 
+  int batch_size = AzPrepText_docs::batch_size(p.thr_num); 
+  AzPrepText_docs docs; docs.reset(batch_size); 
   
-  buff_size += 256; 
-  AzBytArr s_buff; 
-  AzByte *buff = s_buff.reset(buff_size, 0); 
+  const char *outnm = p.s_rnm.c_str(); 
+  int voc_sz = (p.hash_bits > 0) ? (1 << p.hash_bits) : dic_word.size(); 
+  int row_num = (p.do_bow) ? voc_sz : voc_sz*p.pch_sz;
   int no_cat = 0, multi_cat = 0; 
-  int data_no = 0; 
-  for (int fx = 0; fx < sp_list.size(); ++fx) { /* for each file */
-    AzBytArr s_txt_fn(sp_list.c_str(fx), p.s_txt_ext.c_str()); 
-    const char *fn = s_txt_fn.c_str(); 
+  int data_no = 0, doc_no = 0; /* doc_no: including the excluded ones */
+  for (int fx = 0; fx <= sp_list.size(); ++fx) { /* for each file; fx==sp_list.size() to finish */
+    bool is_end = (fx == sp_list.size()); 
     AzStrPool sp_cat;     
-    if (!p.do_region_only) {
-      AzBytArr s_cat_fn(sp_list.c_str(fx), p.s_cat_ext.c_str()); 
-      AzTools::readList(s_cat_fn.c_str(), &sp_cat); 
+    AzTextReader rdr; 
+    if (!is_end) {
+      AzBytArr s_txt_fn(sp_list.c_str(fx), inp_ext); 
+      const char *fn = s_txt_fn.c_str(); 
+      if (!p.do_region_only) {
+        AzBytArr s_cat_fn(sp_list.c_str(fx), p.s_cat_ext.c_str()); 
+        AzTools::readList(s_cat_fn.c_str(), &sp_cat); 
+      }
+      AzTimeLog::print(fn, out);   
+      if (do_tokc) {
+        tokc.open(fn); 
+        tokc.check_flags(p.do_lower, p.do_utf8dashes, p.do_char, p.do_byte, eyec); 
+      }
+      else rdr.open(fn); 
     }
-    AzTimeLog::print(fn, out);   
-    AzFile file(fn); 
-    file.open("rb"); 
     int num_in_file = 0; 
     for ( ; ; ++num_in_file) {  /* for each document */
-      int len = file.gets(buff, buff_size); 
+      bool is_batch_end = (doc_end >= 0 && doc_no >= doc_end); 
+      if (is_end || is_batch_end || docs.bytes() >= batch_size) {
+        bytes_done += docs.bytes(); 
+        AzPrepText_gen_regions_thread::run_batch(thrs, docs, o.bc, o.ia_dcolind, o.ia_pos_all, o.ia_pos_end); 
+        if (!o.is_prepped && bytes_done > 0 && bytes_done >= batch_bytes/16) {
+          o.bc.prepmem(bytes_done, batch_bytes); 
+          o.is_prepped = true; 
+        }
+        if (is_end || is_batch_end) { /* write an output batch */
+          AzBytArr s_batch_id(&p.s_batch_id); 
+          if (p.batch_num > 1) { s_batch_id.reset(); s_batch_id << bx+1 << "of" << p.batch_num; }
+          cout << "#data=" << data_no-o.data_beg << " no-cat=" << no_cat << " multi-cat=" << multi_cat << endl; 
+          o.write(out, p, row_num, data_no, s_batch_id); 
+          if (is_end) break; 
+          ++bx; bytes_done = 0; 
+          doc_end = (bx < p.batch_num-1) ? (int)((AZint8)doc_num*(bx+1)/p.batch_num) : -1; 
+        }
+      }
+      AzByte *buff = NULL; 
+      int len = (do_tokc) ? tokc.next(buff) : rdr.next(buff); 
       if (len <= 0) break; 
+      ++doc_no; 
 
       /*---  categories  ---*/      
       if (!p.do_region_only) {
@@ -516,59 +927,26 @@ void AzPrepText::gen_regions(int argc, const char *argv[]) const {
           if (p.do_ignore_bad) continue; 
           AzX::throw_if(true, AzInputError, eyec, s_err.c_str()); 
         }
-        m_cat.col_u(data_no)->load(&ia_cats, 1);                               
+        int col = data_no - o.data_beg; 
+        if (col >= o.m_cat.colNum()) o.m_cat.resize(col*2); 
+        o.m_cat.col_u(col)->load(&ia_cats, 1);                               
       }
            
-      /*---  text  ---*/
-      AzIntArr *ia_opos = aia_outpos(data_no); 
-      AzDataArr<AzIntArr> aia_xtokno; 
-      int t_num = AzTools_text::tokenize(buff, len, &dic_word, ia_nn, p.do_lower, p.do_utf8dashes, 
-                                         aia_xtokno, p.do_char, p.do_byte);  
-      bc.check_overflow(eyec, t_num*p.pch_sz*ia_nn.size(), data_no);   
-      ia_dcolind.put(bc.colNum()); 
-      if (p.do_bow) {
-        if (do_pos) gen_bow_regions_pos(t_num, aia_xtokno, ia_nn, p.do_contain, p.pch_sz, aia_inppos[data_no], 
-                                        bc, ia_opos);     
-        else        gen_bow_regions(t_num, aia_xtokno, ia_nn, p.do_contain, p.pch_sz, p.pch_step, p.padding, 
-                                    p.do_allow_zero, p.do_skip_stopunk, bc, ia_opos); 
-      }
-      else {
-        if (do_pos) gen_nobow_regions_pos(t_num, aia_xtokno, dic_word.size(), p.pch_sz, aia_inppos[data_no], unkw_id, 
-                                          bc, ia_opos);     
-        else        gen_nobow_regions(t_num, aia_xtokno, dic_word.size(), p.pch_sz, p.pch_step, p.padding, 
-                                      p.do_allow_zero, unkw_id, bc, ia_opos); 
-      }        
-      ia_dcolind.put(bc.colNum()); 
-            
+      /*---  text: keep it in the batch  ---*/
+      AzX::throw_if((do_pos && data_no >= aia_inppos.size()), AzInputError, eyec, kw_inppos_fn, "#data mismatch"); 
+      docs.put(buff, len, data_no); 
       ++data_no;
-      if (data_no == chkmem) {
-        bc.prepmem(data_no, data_num);  
-      }
     } /* for each doc */
+    if (is_end) break; 
     AzX::throw_if(!p.do_region_only && num_in_file != sp_cat.size(), AzInputError, eyec, "#data mismatch2: btw text file and cat file");  
+    if (do_tokc) { /* token ids are of this file */
+      bytes_done += docs.bytes(); 
+      AzPrepText_gen_regions_thread::run_batch(thrs, docs, o.bc, o.ia_dcolind, o.ia_pos_all, o.ia_pos_end); 
+    }
   } /* for each file */
-  if (!p.do_region_only) m_cat.resize(data_no); 
-  cout << "#data=" << data_no << " no-cat=" << no_cat << " multi-cat=" << multi_cat << endl; 
-  bc.commit(); 
-  
-  cout << bc.elmNum() << " " << bc.colNum() << endl;   
-  
-  /*---  write files  ---*/
-  const char *outnm = p.s_rnm.c_str(); 
-  int row_num = (p.do_bow) ? dic_word.size() : dic_word.size()*p.pch_sz;
-  write_regions(bc, row_num, ia_dcolind, p.s_batch_id, outnm, p.s_x_ext.c_str());  
-  write_dic(dic_word, row_num, outnm, xtext_ext); 
-
-  if (!p.do_region_only) { /* labeled data */
-    AzBytArr s_y_fn(outnm, p.s_y_ext.c_str()); 
-    write_Y(m_cat, s_y_fn, &p.s_batch_id); 
-  }
-  
-  if (p.do_write_pos) {
-    AzBytArr s_pos_fn(outnm, ".pos"); 
-    if (p.s_batch_id.length() > 0) s_pos_fn << "." << p.s_batch_id.c_str();
-    AzFile::write(s_pos_fn.c_str(), &aia_outpos);   
-  }
+  AzX::throw_if((do_pos && aia_inppos.size() != data_no), AzInputError, eyec, kw_inppos_fn, "#data mismatch");  
+  if (p.hash_bits > 0) { AzBytArr s_fn(outnm, xtext_ext); dic_word.writeText(&s_fn); } /* the signature only */
+  else write_dic(dic_word, row_num, outnm, xtext_ext); 
   AzTimeLog::print("Done ... ", out); 
 }
 
@@ -600,6 +978,7 @@ void AzPrepText::check_batch_id(const AzBytArr &s_batch_id) {
 }  
 
 /*-------------------------------------------------------------------------*/
+/* static */
 void AzPrepText::gen_nobow_regions(int t_num, 
                        const AzDataArr<AzIntArr> &aia_nx_tok,
                        int dic_sz, int pch_sz, int pch_step, int padding,  
@@ -607,7 +986,7 @@ void AzPrepText::gen_nobow_regions(int t_num,
                        int unkw,  /* for unigram only */
                        /*---  output  ---*/
                        Az_bc &bc, 
-                       AzIntArr *ia_pos) /* patch position: may be NULL */ const {
+                       AzIntArr *ia_pos) /* patch position: may be NULL */ {
   int pch_num = DIVUP(t_num+padding*2-pch_sz, pch_step) + 1; 
   if (pch_num <= 0) return; 
   if (ia_pos != NULL) ia_pos->reset(); 
@@ -634,11 +1013,12 @@ void AzPrepText::gen_nobow_regions(int t_num,
 }
 
 /*-------------------------------------------------------------------------*/
+/* static */
 void AzPrepText::gen_nobow_regions_pos(int t_num, const AzDataArr<AzIntArr> &aia_tok, 
                        int dic_sz, int pch_sz, const AzIntArr &ia_tx0, int unkw, 
                        /*---  output  ---*/
                        Az_bc &bc, 
-                       AzIntArr *ia_pos) const {
+                       AzIntArr *ia_pos) {
   if (ia_pos != NULL) ia_pos->reset(); 
  
   for (int col = 0; col < ia_tx0.size(); ++col) {
@@ -659,13 +1039,14 @@ void AzPrepText::gen_nobow_regions_pos(int t_num, const AzDataArr<AzIntArr> &aia
 }
 
 /*-------------------------------------------------------------------------*/
+/* static */
 void AzPrepText::gen_bow_regions(int t_num, const AzDataArr<AzIntArr> &aia_tokno, 
                        const AzIntArr &ia_nn, bool do_contain, 
                        int pch_sz, int pch_step, int padding,  
                        bool do_allow_zero, bool do_skip_stopunk,
                        /*---  output  ---*/
                        Az_bc &bc, 
-                       AzIntArr *ia_pos) /* patch position: may be NULL */ const {
+                       AzIntArr *ia_pos) /* patch position: may be NULL */ {
   int pch_num = DIVUP(t_num+padding*2-pch_sz, pch_step) + 1; 
   if (ia_pos != NULL) ia_pos->reset(); 
 
@@ -710,13 +1091,14 @@ void AzPrepText::gen_bow_regions(int t_num, const AzDataArr<AzIntArr> &aia_tokno
 } 
 
 /*-------------------------------------------------------------------------*/
+/* static */
 void AzPrepText::gen_bow_regions_pos(int t_num, 
                        const AzDataArr<AzIntArr> &aia_tokno, 
                        const AzIntArr &ia_nn, bool do_contain, 
                        int pch_sz, const AzIntArr &ia_tx0,
                        /*---  output  ---*/
                        Az_bc &bc, 
-                       AzIntArr *ia_pos) const {
+                       AzIntArr *ia_pos) {
   if (ia_pos != NULL) ia_pos->reset(); 
   for (int col = 0; col < ia_tx0.size(); ++col) {
     int tx0 = ia_tx0[col]; 
@@ -789,6 +1171,7 @@ void AzPrepText::show_regions(int argc, const char *argv[]) const {
   }
   else mv.read(s_x_fn.c_str()); 
   AzDic dic(s_xtext_fn.c_str()); 
+  if (dic.is_hash_signature()) { AzDic sig(dic); sig.expand_hash_signature(dic); } /* feature hashing */
   _show_regions(&mv, &dic, p.do_wordonly); 
 }
 
@@ -820,9 +1203,10 @@ public:
   AzBytArr s_nbw_fn; 
   double alpha; 
   bool do_lower, do_utf8dashes, do_ignore_bad; 
+  int thr_num; 
   
   AzPrepText_gen_nbw_Param(int argc, const char *argv[], const AzOut &out) 
-    : alpha(1), do_lower(false), do_utf8dashes(false), do_ignore_bad(false), 
+    : alpha(1), do_lower(false), do_utf8dashes(false), do_ignore_bad(false), thr_num(1), 
       s_txt_ext(".txt.tok"), s_cat_ext(".cat") /* 07/08/2016 */ {
     reset(argc, argv, out); 
   }      
@@ -846,6 +1230,7 @@ public:
     azp.swOn(o, do_lower, kw_do_lower); 
     azp.swOn(o, do_utf8dashes, kw_do_utf8dashes); 
     azp.swOn(o, do_ignore_bad, kw_do_ignore_bad); 
+    azp.vInt(o, kw_thr_num, thr_num); 
     
     AzXi::throw_if_empty(s_voc_fn, eyec, kw_voc_fn); 
     AzXi::throw_if_empty(s_trn_fn, eyec, kw_trn_fn);    
@@ -853,6 +1238,7 @@ public:
     AzXi::throw_if_empty(s_txt_ext, eyec, kw_txt_ext);  
     AzXi::throw_if_empty(s_cat_ext, eyec, kw_cat_ext);  
     AzXi::throw_if_empty(s_cat_dic_fn, eyec, kw_cat_dic_fn);    
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
     o.printEnd(); 
   }  
   void printHelp(const AzOut &out) const {  
@@ -867,15 +1253,50 @@ public:
     h.item(kw_alpha, "The value that should be added for smoothing", "1"); 
     h.item(kw_do_lower, help_do_lower);     
     h.item(kw_do_utf8dashes, help_do_utf8dashes);    
+    h.item(kw_thr_num, help_thr_num, "1"); 
     h.end(); 
   }  
 }; 
+/*-------------------------------------------------------------------------*/
+/*---  gen_nbw: sum the word counts for each class over the words [row0, row1)  ---*/
+/* The threads write to disjoint rows of one matrix, and each sum is taken over */
+/* the documents in order, so the result does not depend on the number of threads. */
+class AzPrepText_gen_nbw_sum : public virtual AzThread_ {
+protected:
+  const AzSmat *m_count; 
+  const AzIntArr *ia_cat; /* [doc]: class */
+  AzDmat *m_sum; /* output: #word x #class */
+  int row0, row1; 
+public:
+  AzPrepText_gen_nbw_sum() : m_count(NULL), ia_cat(NULL), m_sum(NULL), row0(0), row1(0) {}
+  void reset(const AzSmat *_m_count, const AzIntArr *_ia_cat, AzDmat *_m_sum, int _row0, int _row1) {
+    m_count = _m_count; ia_cat = _ia_cat; m_sum = _m_sum; row0 = _row0; row1 = _row1; 
+  }
+  void run() {
+    if (row0 >= row1) return; 
+    for (int col = 0; col < m_count->colNum(); ++col) {
+      int num; 
+      const AZI_VECT_ELM *elm = m_count->rawcol_elm(col, &num); 
+      if (num <= 0 || elm[num-1].no < row0 || elm[0].no >= row1) continue; 
+      int lo = 0, hi = num; /* rows are in ascending order; find the first one >= row0 */
+      while (lo < hi) {
+        int mid = (lo+hi)/2; 
+        if (elm[mid].no < row0) lo = mid+1; 
+        else                    hi = mid; 
+      }
+      double *sum = m_sum->col_u((*ia_cat)[col])->point_u(); 
+      for (int ex = lo; ex < num && elm[ex].no < row1; ++ex) sum[elm[ex].no] += elm[ex].val; 
+    }
+  }
+}; 
+
 /*-------------------------------------------------------------------------*/
 void AzPrepText::gen_nbw(int argc, const char *argv[]) const {
   const char *eyec = "AzPrepText::gen_nbw"; 
 
   AzPrepText_gen_nbw_Param p(argc, argv, out);   
   AzDic dic(p.s_voc_fn.c_str()); /* vocabulary */
+  dic.build_hash(); /* for looking up n-grams without composing strings */
   AzDic dic_cat(p.s_cat_dic_fn.c_str());  /* read categories */
   AzX::throw_if(dic_cat.size() < 2, AzInputError, eyec, "#class must be no smaller than 2"); 
   
@@ -891,14 +1312,39 @@ void AzPrepText::gen_nbw(int argc, const char *argv[]) const {
         p.s_trn_fn.c_str(), p.s_txt_ext.c_str(), p.s_cat_ext.c_str(), 
         dic, dic_cat, nn, 
         do_allow_multi, do_allow_nocat, p.do_lower, p.do_utf8dashes, 
-        &m_trn_count, &m_trn_cat); 
-
-  AzDmat m_trn_sum(m_trn_count.rowNum(), m_trn_cat.rowNum()); 
-  for (int col = 0; col < m_trn_count.colNum(); ++col) {
-    int cat; 
-    m_trn_cat.col(col)->max(&cat); 
-    m_trn_sum.col_u(cat)->add(m_trn_count.col(col)); 
-  }
+        &m_trn_count, &m_trn_cat, false, p.thr_num); 
+
+  int data_num = m_trn_count.colNum(); 
+  AzIntArr ia_cat(data_num, -1); 
+  for (int col = 0; col < data_num; ++col) m_trn_cat.col(col)->max(ia_cat.point_u()+col); 
+
+  /*---  divide the words among threads so that each gets a similar number of   ---*/
+  /*---  non-zero counts, estimated from the first documents                    ---*/
+  int row_num = m_trn_count.rowNum(); 
+  AzIntArr ia_nz(row_num, 0); 
+  int *nz = ia_nz.point_u(); 
+  AZint8 nz_all = 0; 
+  for (int col = 0; col < MIN(data_num, 1024); ++col) {
+    int num; 
+    const AZI_VECT_ELM *elm = m_trn_count.rawcol_elm(col, &num); 
+    for (int ex = 0; ex < num; ++ex) ++nz[elm[ex].no]; 
+    nz_all += num; 
+  }
+  AzIntArr ia_row0; ia_row0.put(0); 
+  AZint8 nz_sum = 0; 
+  for (int row = 0; row < row_num && ia_row0.size() < p.thr_num; ++row) {
+    nz_sum += nz[row]; 
+    if (nz_sum*p.thr_num >= nz_all*ia_row0.size()) ia_row0.put(row+1); 
+  }
+  while (ia_row0.size() <= p.thr_num) ia_row0.put(row_num); 
+
+  AzDmat m_trn_sum(row_num, dic_cat.size()); 
+  AzDataArr<AzPrepText_gen_nbw_sum> sums(p.thr_num); 
+  for (int tx = 0; tx < p.thr_num; ++tx) {
+    sums(tx)->reset(&m_trn_count, &ia_cat, &m_trn_sum, ia_row0[tx], ia_row0[tx+1]); 
+  }
+  AzThreads::run(sums); 
+  sums.reset(); 
   AzDmat m_val(dic.size(), dic_cat.size()); 
   for (int cat = 0; cat < dic_cat.size(); ++cat) {
     AzDvect v_posi(m_trn_sum.col(cat)); 
@@ -934,9 +1380,10 @@ public:
   AzBytArr s_inp_fn, s_txt_ext, s_cat_ext, s_cat_dic_fn, s_voc_fn; 
   AzBytArr s_outnm, s_x_ext, s_y_ext, s_nbw_fn, s_batch_id; 
   bool do_lower, do_utf8dashes, do_no_cat, do_ignore_bad; 
+  int thr_num; 
   
   AzPrepText_gen_nbwfeat_Param(int argc, const char *argv[], const AzOut &out) 
-    : do_lower(false), do_utf8dashes(false), do_no_cat(false), s_x_ext(".xsmatcvar"), s_y_ext(".y"), do_ignore_bad(false), 
+    : do_lower(false), do_utf8dashes(false), do_no_cat(false), s_x_ext(".xsmatcvar"), s_y_ext(".y"), do_ignore_bad(false), thr_num(1), 
       s_txt_ext(".txt.tok"), s_cat_ext(".cat") /* 07/09/2017 */ {
     reset(argc, argv, out); 
   }      
@@ -967,12 +1414,14 @@ public:
     
     azp.swOn(o, do_ignore_bad, kw_do_ignore_bad); 
     azp.vStr_prt_if_not_empty(o, kw_batch_id, s_batch_id); 
+    azp.vInt(o, kw_thr_num, thr_num); 
     AzXi::throw_if_empty(s_voc_fn, eyec, kw_voc_fn); 
     AzXi::throw_if_empty(s_inp_fn, eyec, kw_inp_fn); 
     AzXi::throw_if_empty(s_outnm, eyec, kw_outnm); 
     AzXi::throw_if_empty(s_x_ext, eyec, kw_x_ext); 
     AzXi::throw_if_empty(s_y_ext, eyec, kw_y_ext);      
     AzXi::throw_if_empty(s_nbw_fn, eyec, kw_nbw_fn);       
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
     if (!do_no_cat) AzXi::throw_if_empty(s_cat_ext, eyec, kw_cat_ext);  
     AzXi::throw_if_empty(s_cat_dic_fn, eyec, kw_cat_dic_fn);    
     o.printEnd(); 
@@ -993,6 +1442,7 @@ public:
     h.item(kw_do_utf8dashes, help_do_utf8dashes);    
     h.item(kw_do_no_cat, help_do_no_cat); 
     h.item(kw_batch_id, help_batch_id); 
+    h.item(kw_thr_num, help_thr_num, "1"); 
     h.end(); 
   }   
 }; 
@@ -1004,6 +1454,7 @@ void AzPrepText::gen_nbwfeat(int argc, const char *argv[]) const {
   check_y_ext(p.s_y_ext, eyec);  
   check_batch_id(p.s_batch_id);   
   AzDic dic(p.s_voc_fn.c_str()); /* vocabulary */
+  dic.build_hash(); /* for looking up n-grams without composing strings */
   AzDic dic_cat(p.s_cat_dic_fn.c_str());  /* read categories */
   AzX::throw_if(dic_cat.size() < 2, AzInputError, eyec, "#class must be no smaller than 2"); 
   AzX::throw_if(!p.s_nbw_fn.endsWith("dmat"), AzInputError, eyec, kw_nbw_fn, " should end with \"dmat\"");     
@@ -1029,7 +1480,7 @@ void AzPrepText::gen_nbwfeat(int argc, const char *argv[]) const {
         p.s_inp_fn.c_str(), p.s_txt_ext.c_str(), p.s_cat_ext.c_str(), 
         dic, dic_cat, nn, 
         do_allow_multi, do_allow_nocat, p.do_lower, p.do_utf8dashes, 
-        &m_count, &m_cat, p.do_no_cat); 
+        &m_count, &m_cat, p.do_no_cat, p.thr_num); 
 
   AzTimeLog::print("Binarizing ... ", out); 
   m_count.binarize(); /* binary features */
@@ -1038,7 +1489,7 @@ void AzPrepText::gen_nbwfeat(int argc, const char *argv[]) const {
   for (int cat = 0; cat < dic_cat.size(); ++cat) {
     AzTimeLog::print("Cat", cat, out); 
     AzSmat m_feat(&m_count); 
-    scale(&m_feat, m_val.col(cat));  /* multiply NB-weights */
+    scale(&m_feat, m_val.col(cat), p.thr_num);  /* multiply NB-weights */
  
     /*---  generate binary labels for one vs. others training  ---*/
     AzSmat m_bcat(2, m_cat.colNum()); 
@@ -1069,19 +1520,40 @@ void AzPrepText::gen_nbwfeat(int argc, const char *argv[]) const {
 }
 
 /*-------------------------------------------------------------------------*/ 
-void AzPrepText::scale(AzSmat *ms, const AzDvect *v) 
-{
-  for (int col = 0; col < ms->colNum(); ++col) {
-    AzIFarr ifa; 
-    ms->col(col)->nonZero(&ifa); 
-    AzIFarr ifa_new; ifa_new.prepare(ifa.size()); 
-    for (int ix = 0; ix < ifa.size(); ++ix) {
-      double val = ifa.get(ix); 
-      int row = ifa.getInt(ix); 
-      ifa_new.put(row, val*v->get(row)); 
+/*---  scale: multiply the rows of the columns [col0, col1) by v  ---*/
+class AzPrepText_scale_thread : public virtual AzThread_ {
+protected:
+  AzSmat *ms; 
+  const AzDvect *v; 
+  int col0, col1; 
+public:
+  AzPrepText_scale_thread() : ms(NULL), v(NULL), col0(0), col1(0) {}
+  void reset(AzSmat *_ms, const AzDvect *_v, int _col0, int _col1) { ms = _ms; v = _v; col0 = _col0; col1 = _col1; }
+  void run() {
+    for (int col = col0; col < col1; ++col) {
+      AzIFarr ifa; 
+      ms->col(col)->nonZero(&ifa); 
+      AzIFarr ifa_new; ifa_new.prepare(ifa.size()); 
+      for (int ix = 0; ix < ifa.size(); ++ix) {
+        double val = ifa.get(ix); 
+        int row = ifa.getInt(ix); 
+        ifa_new.put(row, val*v->get(row)); 
+      }
+      ms->col_u(col)->load(&ifa_new); 
     }
-    ms->col_u(col)->load(&ifa_new); 
   }
+}; 
+
+/*-------------------------------------------------------------------------*/ 
+void AzPrepText::scale(AzSmat *ms, const AzDvect *v, int thr_num) 
+{
+  thr_num = MAX(1, thr_num); 
+  int col_num = ms->colNum(); 
+  AzDataArr<AzPrepText_scale_thread> thrs(thr_num); 
+  for (int tx = 0; tx < thr_num; ++tx) {
+    thrs(tx)->reset(ms, v, (int)((AZint8)col_num*tx/thr_num), (int)((AZint8)col_num*(tx+1)/thr_num)); 
+  }
+  AzThreads::run(thrs); 
 }
 
 /*-------------------------------------------------------------------------*/
@@ -1213,7 +1685,8 @@ void AzPrepText::gen_b_feat(int argc, const char *argv[]) const {
  
 /*-------------------------------------------------------------------------*/
 void AzPrepText::write_X(const AzOut &out, const AzSmat &m_x, const AzBytArr &s_x_fn, 
-                         const AzBytArr *s_batch_id) /* static */ /* may be NULL */ {
+                         const AzBytArr *s_batch_id, /* may be NULL */ 
+                         bool do_compress) /* static */ {
   check_size(out, m_x);                            
   AzBytArr s_fn(&s_x_fn); 
   if (s_batch_id != NULL && s_batch_id->length() > 0) s_fn << "." << s_batch_id->c_str(); 
@@ -1231,7 +1704,7 @@ void AzPrepText::write_X(const AzOut &out, const AzSmat &m_x, const AzBytArr &s_
   else if (s_x_fn.endsWith("smatbc")) {
     AzTimeLog::print(fn, s.c_str(), " (smatbc)", out);      
     AzSmatbc mbc; mbc.set(&m_x); 
-    mbc.write(fn); 
+    mbc.write(fn, do_compress); 
   }
   else if (s_x_fn.endsWith(".x")) {
     int digits = 5; 
@@ -1247,7 +1720,8 @@ void AzPrepText::write_X(const AzOut &out, const AzSmat &m_x, const AzBytArr &s_
 /*-------------------------------------------------------------------------*/
 void AzPrepText::write_Y(const AzOut &out, const AzSmat &m_y, 
                          const AzBytArr &s_y_fn, 
-                         const AzBytArr *s_batch_id) /* may be NULL */ /* static */ {
+                         const AzBytArr *s_batch_id, /* may be NULL */ 
+                         bool do_compress) /* static */ {
   check_size(out, m_y); 
   AzBytArr s(": "); AzTools::show_smat_stat(m_y, s);  
   AzBytArr s_fn(&s_y_fn); 
@@ -1260,7 +1734,7 @@ void AzPrepText::write_Y(const AzOut &out, const AzSmat &m_y,
   else if (s_y_fn.endsWith("smatbc")) {
     AzTimeLog::print(fn, s.c_str(), " (smatbc)", out);
     AzSmatbc mbc; mbc.set(&m_y); 
-    mbc.write(fn); 
+    mbc.write(fn, do_compress); 
   }
   else if (s_y_fn.endsWith(".y")) {
     int digits=5; 
@@ -1276,7 +1750,6 @@ void AzPrepText::write_Y(const AzOut &out, const AzSmat &m_y,
 /*-----------------------------------------------------------------*/
 /*-----------------------------------------------------------------*/
 #define kw_ext "ext="
-#define kw_num "num_batches="
 #define kw_split "split="
 #define kw_seed "random_seed="
 #define kw_id_fn "id_fn_stem="
@@ -1332,11 +1805,7 @@ void AzPrepText::split_text(int argc, const char *argv[]) const {
   
   AzIntArr ia_data_num; 
   AzStrPool sp_list; 
-  int buff_size = AzTools_text::scan_files_in_list(p.s_inp_fn.c_str(), p.s_ext.c_str(), 
-                                                   out, &sp_list, &ia_data_num); 
-  buff_size += 256;  /* just in case */
-  AzBytArr s_buff; 
-  AzByte *buff = s_buff.reset(buff_size, 0);                                                    
+  AzTools_text::scan_files_in_list(p.s_inp_fn.c_str(), p.s_ext.c_str(), out, &sp_list, &ia_data_num); 
 
   int data_num = ia_data_num.sum(); 
 
@@ -1384,9 +1853,10 @@ void AzPrepText::split_text(int argc, const char *argv[]) const {
     AzBytArr s_fn(sp_list.c_str(fx), p.s_ext.c_str()); 
     const char *fn = s_fn.c_str();   
     AzTimeLog::print(fn, out); 
-    AzFile file(fn); file.open("rb"); 
+    AzTextReader rdr; rdr.open(fn); 
     for ( ; ; ) {
-      int len = file.gets(buff, buff_size); 
+      AzByte *buff = NULL; 
+      int len = rdr.next(buff); 
       if (len <= 0) break;  
   
       int gx = ia_dx2group[dx];     
@@ -1434,8 +1904,10 @@ public:
   bool do_join; 
   bool do_1stfirst; /* make the same output as "merge_sort_dic" */
                     /* so that the order of the input files matter */
+  bool do_stream, do_sort_word; 
   AzPrepText_merge_vocab_Param(int argc, const char *argv[], const AzOut &out)
-       : min_count(-1), max_num(-1), do_write_count(false), do_join(false), do_1stfirst(false) {
+       : min_count(-1), max_num(-1), do_write_count(false), do_join(false), do_1stfirst(false), 
+         do_stream(false), do_sort_word(false) {
       reset(argc, argv, out); 
   }
 
@@ -1443,6 +1915,7 @@ public:
   #define kw_inp_fns "input_fns="
   #define kw_do_join "Join"
   #define kw_do_1stfirst "UseInputFileOrder"
+  #define kw_do_stream "Streaming"
   
   /*-------------------------------------------------------------------------*/
   virtual void resetParam(const AzOut &out, AzParam &azp) {
@@ -1454,9 +1927,12 @@ public:
     azp.vInt(o, kw_max_num, max_num); 
     azp.swOn(o, do_write_count, kw_do_write_count); 
     azp.swOn(o, do_join, kw_do_join); 
+    azp.swOn(o, do_stream, kw_do_stream); 
+    azp.swOn(o, do_sort_word, kw_do_sort_word); 
     AzXi::throw_if_empty(s_inp_fns, eyec, kw_inp_fns); 
     AzXi::throw_if_empty(s_voc_fn, eyec, kw_voc_fn); 
     if (!do_join) azp.swOn(&do_1stfirst, kw_do_1stfirst); 
+    AzXi::throw_if_both(do_stream && do_1stfirst, eyec, kw_do_stream, kw_do_1stfirst); 
     o.printEnd(); 
   }            
   void printHelp(const AzOut &out) const {
@@ -1468,6 +1944,8 @@ public:
     h.item(kw_max_num, "Maximum number of words to be included in the vocabulary file.  The most frequent ones will be included.", "No limit"); 
     h.item(kw_do_write_count, "Write word counts as well as the words to the vocabulary file."); 
     h.item(kw_do_join, "Take the intersection of the input vocabulary files.  Default: Union");     
+    h.item(kw_do_stream, "Merge the input files by reading them in parallel line by line instead of loading them so that the memory does not grow with the vocabulary size (except for the max_vocab_size most frequent words if max_vocab_size is given, and except for the output if SortByWord is not given).  The input files must be in the byte order of the words, e.g., written with SortByWord by \"gen_vocab\" or \"merge_vocab\".  The output is the same as without Streaming given the same input files: words with the same count are in the byte order either way, since with Join, the order without Streaming is that of the smallest input file."); 
+    h.item(kw_do_sort_word, help_do_sort_word); 
     h.end(); 
   }   
 };                      
@@ -1478,11 +1956,146 @@ void AzPrepText::merge_vocab(int argc, const char *argv[]) const {
 
   AzStrPool sp_fns(100,100); 
   AzTools::getStrings(p.s_inp_fns.c_str(), '+', &sp_fns); 
+  if (p.do_stream) {
+    int num = stream_merge_vocab(sp_fns, p.s_voc_fn.c_str(), p.do_join, p.max_num, p.min_count, 
+                                 p.do_write_count, p.do_sort_word); 
+    AzTimeLog::print("Merged ... ", num, out); 
+    return; 
+  }
   AzStrPool sp; 
   if (p.do_join) join_vocab(sp_fns, sp); 
   else           union_vocab(sp_fns, sp, p.do_1stfirst); 
   AzTimeLog::print("Merged ... ", sp.size(), out); 
-  write_vocab(p.s_voc_fn.c_str(), &sp, p.max_num, p.min_count, p.do_write_count); 
+  write_vocab(p.s_voc_fn.c_str(), &sp, p.max_num, p.min_count, p.do_write_count, p.do_sort_word); 
+}
+
+/*-------------------------------------------------------------------------*/
+/*---  read a vocabulary file in the byte order of the words line by line  ---*/
+/* A line is parsed as in AzDic (AzTools::readList): word[<tab>count]; the  */
+/* count is 1 if omitted.  Blank lines are skipped.                        */
+class AzPrepText_vocab_reader {
+protected:
+  AzTextReader rdr; 
+  AzBytArr s_fn, s_word, s_prev; 
+  AZint8 count; 
+  bool is_done; 
+public:
+  AzPrepText_vocab_reader() : count(0), is_done(true) {}
+  void open(const char *fn) {
+    s_fn.reset(fn); 
+    rdr.open(fn, 0, -1, 1024*64); /* small buffer: many files may be open */
+    s_prev.reset(); is_done = false; 
+    next(); 
+  }
+  bool done() const { return is_done; }
+  const AzBytArr &word() const { return s_word; }
+  AZint8 get_count() const { return count; }
+  void next() {
+    const char *eyec = "AzPrepText_vocab_reader::next"; 
+    s_prev.reset(&s_word); 
+    for ( ; ; ) {
+      AzByte *line = NULL; 
+      int len = rdr.next(line); 
+      if (len <= 0) { is_done = true; s_word.reset(); rdr.close(); return; }
+      int str_len; 
+      const AzByte *str = AzTools::strip(line, line+len, &str_len); 
+      if (str_len <= 0) continue; 
+      int ix; 
+      for (ix = 0; ix < str_len; ++ix) if (str[ix] == '\t') break; 
+      count = (ix < str_len) ? (AZint8)atof((char *)(str+ix+1)) : 1; 
+      s_word.reset(str, ix); 
+      break; 
+    }
+    if (s_prev.length() > 0 && compare(s_prev, s_word) >= 0) {
+      AzBytArr s("The vocabulary file must be in the byte order of the words without duplicates (use SortByWord): "); 
+      s << s_fn.c_str() << " at \"" << s_word.c_str() << "\""; 
+      AzX::throw_if(true, AzInputError, eyec, s.c_str()); 
+    }
+  }
+  static int compare(const AzBytArr &s1, const AzBytArr &s2) { /* as AzStrPool::commit */
+    int cmp = memcmp(s1.point(), s2.point(), MIN(s1.length(), s2.length())); 
+    if (cmp != 0) return cmp; 
+    return (s1.length() < s2.length()) ? -1 : (s1.length() > s2.length()) ? 1 : 0; 
+  }
+  /*---  heap of reader#'s by the current words  ---*/
+  static void sift_down(const AzDataArr<AzPrepText_vocab_reader> &rdrs, int *heap, int num, int hx) {
+    for ( ; ; ) {
+      int mx = hx, lx = hx*2+1, rx = hx*2+2; 
+      if (lx < num && compare(rdrs[heap[lx]]->word(), rdrs[heap[mx]]->word()) < 0) mx = lx; 
+      if (rx < num && compare(rdrs[heap[rx]]->word(), rdrs[heap[mx]]->word()) < 0) mx = rx; 
+      if (mx == hx) return; 
+      int temp = heap[hx]; heap[hx] = heap[mx]; heap[mx] = temp; 
+      hx = mx; 
+    }
+  }
+}; 
+
+/*-------------------------------------------------------------------------*/
+/* k-way merge of vocabulary files in the byte order of the words with a    */
+/* heap of the files.  The counts of the same word are summed, and the words */
+/* are selected as write_vocab does as they come out in order.  Memory is   */
+/* O(k) if SortByWord without max_num; otherwise the max_num most frequent  */
+/* words (or all the selected words) are kept for ordering by count.        */
+/* Return the number of the distinct words in the input.                   */
+int AzPrepText::stream_merge_vocab(const AzStrPool &sp_fns, const char *voc_fn, bool do_join, 
+                                   int max_num, int min_count, bool do_write_count, bool do_sort_word) const {
+  int k = sp_fns.size(); 
+  AzTimeLog::print((do_join) ? "Join (streaming) ... " : "Union (streaming) ... ", k, out); 
+  AzDataArr<AzPrepText_vocab_reader> rdrs(k); 
+  AzIntArr ia_heap; /* reader#'s; the smallest word at the top */
+  for (int ix = 0; ix < k; ++ix) {
+    rdrs(ix)->open(sp_fns.c_str(ix)); 
+    if (!rdrs[ix]->done()) ia_heap.put(ix); 
+  }
+  int *heap = ia_heap.point_u(), heap_num = ia_heap.size(); 
+  for (int hx = heap_num/2-1; hx >= 0; --hx) AzPrepText_vocab_reader::sift_down(rdrs, heap, heap_num, hx); 
+
+  bool do_direct = (do_sort_word && max_num <= 0); /* write as they come */
+  AzFile file; 
+  if (do_direct) { file.reset(voc_fn); file.open("wb"); }
+  AzStrPool sp_cand; /* candidates in the byte order */
+  int out_num = 0, inp_num = 0; 
+  AzBytArr s_word; 
+  while (heap_num > 0) {
+    s_word.reset(&rdrs[heap[0]]->word()); 
+    AZint8 count = 0; 
+    int num = 0; 
+    while (heap_num > 0 && AzPrepText_vocab_reader::compare(rdrs[heap[0]]->word(), s_word) == 0) {
+      AzPrepText_vocab_reader *rdr = rdrs(heap[0]); 
+      count += rdr->get_count(); ++num; 
+      rdr->next(); 
+      if (rdr->done()) heap[0] = heap[--heap_num]; 
+      AzPrepText_vocab_reader::sift_down(rdrs, heap, heap_num, 0); 
+    }
+    ++inp_num; 
+    if (do_join && num < k) continue; 
+    if ((double)count < min_count) continue; 
+    if (do_direct) {
+      AzBytArr s(&s_word); 
+      if (do_write_count) s << '\t' << count; 
+      s.nl(); s.writeText(&file); 
+      ++out_num; 
+      continue; 
+    }
+    sp_cand.put(&s_word, count); 
+    if (max_num > 0 && sp_cand.size() >= MAX(max_num*2, 1024)) { /* keep the max_num most frequent */
+      AzIFarr ifa_ix_count; sp_cand.getAllCount(&ifa_ix_count); 
+      ifa_ix_count.sort_FloatInt(false, true); /* float: descending, int: ascending */
+      ifa_ix_count.cut(max_num); 
+      AzIntArr ia_keep; ifa_ix_count.int1(&ia_keep); 
+      ia_keep.sort(true); /* to keep the byte order */
+      AzStrPool sp(ia_keep.size(), 10); 
+      for (int ix = 0; ix < ia_keep.size(); ++ix) {
+        int len; const AzByte *bytes = sp_cand.point(ia_keep[ix], &len); 
+        sp.put(bytes, len, sp_cand.getCount(ia_keep[ix])); 
+      }
+      sp_cand.reset(&sp); 
+    }
+  }
+  if (do_direct) file.close(true); 
+  else out_num = write_vocab(voc_fn, &sp_cand, max_num, min_count, do_write_count, do_sort_word); 
+  AzTimeLog::print("Written ... ", out_num, out); 
+  return inp_num; 
 }
 
 /*-------------------------------------------------------------------------*/
@@ -1545,7 +2158,7 @@ void AzPrepText::join_vocab(const AzStrPool &sp_fns, AzStrPool &out_sp) const {
 /*-------------------------------------------------------------------------*/
 class AzPrepText_gen_regions_unsup_Param : public virtual AzPrepText_Param_ {
 public: 
-  AzBytArr s_xtyp, s_xdic_fn, s_ydic_fn, s_inp_fn, s_txt_ext, s_rnm; 
+  AzBytArr s_xtyp, s_xdic_fn, s_ydic_fn, s_inp_fn, s_txt_ext, s_rnm, s_tokc_ext; 
   AzBytArr s_batch_id, s_x_ext, s_y_ext; 
   int dist, min_x, min_y; 
   int gap; 
@@ -1554,11 +2167,13 @@ public:
   bool do_nolr; /* only when bow */
   bool do_no_skip; 
   bool do_rightonly, do_leftonly; 
+  int thr_num, batch_num; 
+  bool do_compress; 
   
   #define kw_bow "Bow"
   #define kw_seq "Seq"   
   AzPrepText_gen_regions_unsup_Param(int argc, const char *argv[], const AzOut &out) 
-    : dist(-1), min_x(1), min_y(1), pch_sz(-1), pch_step(1), padding(-1), gap(0), 
+    : thr_num(1), batch_num(1), do_compress(false), dist(-1), min_x(1), min_y(1), pch_sz(-1), pch_step(1), padding(-1), gap(0), 
       s_x_ext(".xsmatbc"), s_y_ext(".ysmatbc"), s_xtyp(kw_bow), do_rightonly(false), do_leftonly(false), 
       do_lower(false), do_utf8dashes(false), do_nolr(false), do_no_skip(false) {
     reset(argc, argv, out); 
@@ -1595,6 +2210,7 @@ public:
     azp.vStr(o, kw_inp_fn, s_inp_fn);      
     azp.vStr(o, kw_rnm, s_rnm);  
     azp.vStr_prt_if_not_empty(o, kw_txt_ext, s_txt_ext);  
+    azp.vStr_prt_if_not_empty(o, kw_tokc_ext, s_tokc_ext); 
     azp.vInt(o, kw_pch_sz, pch_sz);      
     azp.vInt(o, kw_pch_step, pch_step);   
     azp.vInt(o, kw_padding, padding);   
@@ -1613,8 +2229,14 @@ public:
     azp.swOn(o, do_leftonly, kw_do_leftonly); 
     if (!do_leftonly) azp.swOn(o, do_rightonly, kw_do_rightonly); 
     if (do_leftonly || do_rightonly) do_nolr = true;
+    azp.vInt(o, kw_thr_num, thr_num); 
+    azp.vInt(o, kw_num, batch_num); 
+    azp.swOn(o, do_compress, kw_do_compress); 
 
     AzX::throw_if(min_x>1 || min_y>1, AzInputError, eyec, "min_x and min_y must be no greater than 1.");     
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
+    AzXi::throw_if_nonpositive(batch_num, eyec, kw_num); 
+    AzXi::throw_if_both(batch_num > 1 && s_batch_id.length() > 0, eyec, kw_num, kw_batch_id); 
     AzStrPool sp_typ(10,10); sp_typ.put(kw_bow, kw_seq); 
     AzXi::check_input(s_xtyp, &sp_typ, eyec, kw_xtyp);     
     AzXi::throw_if_empty(s_xdic_fn, eyec, kw_xdic_fn);  
@@ -1650,97 +2272,84 @@ public:
     h.item(kw_do_nolr, help_do_nolr); 
     h.item(kw_do_rightonly, "Use this for training a forward LSTM (left to right) so that the region to the right (future) of the current time step is regarded as a target region."); 
     h.item(kw_do_leftonly, "Use this for training a backward LSTM (right to left) so that the region to the left (past) of the current time step is regarded as a target region."); 
+    h.item(kw_thr_num, help_thr_num, "1"); 
+    h.item(kw_num, help_batch_num, "1"); 
+    h.item(kw_do_compress, help_do_compress); 
+    h.item(kw_tokc_ext, help_tokc_ext); 
     /* txt_ext, x_ext, y_ext, do_no_skip, min_x, min_y */
     h.end(); 
   }   
 }; 
 
 /*-------------------------------------------------------------------------*/
-/* Note: X and Y use different dictionaries */
-void AzPrepText::gen_regions_unsup(int argc, const char *argv[]) const {
-  const char *eyec = "AzPrepText::gen_regions_unsup"; 
-  AzPrepText_gen_regions_unsup_Param p(argc, argv, out);   
-  check_batch_id(p.s_batch_id);     
- 
-  bool do_xseq = p.s_xtyp.equals(kw_seq); 
-
-  AzDic ydic(p.s_ydic_fn.c_str()); 
-  int ydic_nn = ydic.get_max_n(); 
-  AzPrint::writeln(out, "y dic n=", ydic_nn); 
-  AzX::throw_if((ydic.size() <= 0), AzInputError, eyec, "No Y (target) vocabulary."); 
-  
-  AzDic xdic(p.s_xdic_fn.c_str()); 
-  int xdic_nn = xdic.get_max_n(); 
-  AzPrint::writeln(out, "x dic n=", xdic_nn);   
-  AzX::throw_if((xdic.size() <= 0), AzInputError, eyec, "No vocabulary.");   
-  AzX::no_support((xdic_nn > 1 && do_xseq), eyec, "X with multi-word vocabulary and Seq option");    
-
-  /*---  scan files to determine buffer size and #data  ---*/
-  AzOut noout; 
-  AzStrPool sp_list; 
-  AzIntArr ia_data_num; 
-  int buff_size = AzTools_text::scan_files_in_list(p.s_inp_fn.c_str(), p.s_txt_ext.c_str(), 
-                                                   noout, &sp_list, &ia_data_num);   
-  int data_num = ia_data_num.sum(); 
-  
-  /*---  read data and generate features  ---*/
-  int chkmem=100, wlen=5; /* estimate required memory size after 100 documents; assume a word is 5 char long. */  
-  int ini = buff_size*chkmem/wlen*2; 
-  Az_bc xbc(ini, ini*p.pch_sz*xdic_nn), ybc(ini, ini*p.dist*2*ydic_nn); 
-  AzIntArr ia_dcolind(data_num*2); 
-  
-  buff_size += 256; 
-  AzBytArr s_buff; 
-  AzByte *buff = s_buff.reset(buff_size, 0); 
-  int no_data = 0, data_no = 0, cnum = 0, cnum_before_reduce = 0; 
-  int l_dist = -p.dist, r_dist = p.dist; 
-  if (p.do_leftonly) r_dist = 0; 
-  if (p.do_rightonly) l_dist = 0; 
-
-  AzIntArr ia_xnn; for (int ix = 1; ix <= xdic_nn; ++ix) ia_xnn.put(ix); 
-  AzIntArr ia_ynn; for (int ix = 1; ix <= ydic_nn; ++ix) ia_ynn.put(ix); 
-  
-  for (int fx = 0; fx < sp_list.size(); ++fx) { /* for each file */
-    AzBytArr s_fn(sp_list.c_str(fx), p.s_txt_ext.c_str()); 
-    const char *fn = s_fn.c_str(); 
-    AzTimeLog::print(fn, out);   
-    AzFile file(fn); 
-    file.open("rb"); 
-    int num_in_file = ia_data_num.get(fx); 
-    int inc = num_in_file / 50, milestone = inc; 
-    int dx = 0; 
-    for ( ; ; ++dx) {  /* for each doc */
-      AzTools::check_milestone(milestone, dx, inc); 
-      int len = file.gets(buff, buff_size); 
-      if (len <= 0) break; 
-      
+/*---  gen_regions_unsup: generate X and Y of the documents [dx_beg, dx_end) of a batch  ---*/
+/* As in gen_regions, the output is relative to this chunk.  The documents */
+/* without any region are skipped, and min_x and min_y are applied to each */
+/* document as it is done.                                                 */
+class AzPrepText_gen_regions_unsup_thread : public virtual AzThread_ {
+public:
+  Az_bc xbc, ybc;      /* output */
+  AzIntArr ia_dcolind; /* output */
+  int data_num, no_data, cnum, cnum_before_reduce; /* output */
+protected:
+  const AzPrepText *prep; 
+  const AzPrepText_gen_regions_unsup_Param *p; 
+  const AzDic *xdic, *ydic; 
+  AzIntArr ia_xnn, ia_ynn; 
+  bool do_xseq; 
+  int l_dist, r_dist; 
+  const AzTokCache *tokc; /* NULL if the documents are text */
+  AzPrepText_docs *docs; 
+  int dx_beg, dx_end; 
+public:
+  AzPrepText_gen_regions_unsup_thread() : data_num(0), no_data(0), cnum(0), cnum_before_reduce(0), 
+      prep(NULL), p(NULL), xdic(NULL), ydic(NULL), do_xseq(false), l_dist(0), r_dist(0), 
+      tokc(NULL), docs(NULL), dx_beg(0), dx_end(0) {}
+  void reset(const AzPrepText *_prep, const AzPrepText_gen_regions_unsup_Param *_p, 
+             const AzDic *_xdic, const AzDic *_ydic, bool _do_xseq, int _l_dist, int _r_dist, 
+             const AzTokCache *_tokc) {
+    prep = _prep; p = _p; xdic = _xdic; ydic = _ydic; do_xseq = _do_xseq; l_dist = _l_dist; r_dist = _r_dist; 
+    tokc = _tokc; 
+    ia_xnn.reset(); for (int ix = 1; ix <= xdic->get_max_n(); ++ix) ia_xnn.put(ix); 
+    ia_ynn.reset(); for (int ix = 1; ix <= ydic->get_max_n(); ++ix) ia_ynn.put(ix); 
+  }
+  void reset_docs(AzPrepText_docs *_docs, int _dx_beg, int _dx_end) {
+    docs = _docs; dx_beg = _dx_beg; dx_end = _dx_end; 
+    xbc.reset(dx_end-dx_beg, 0); ybc.reset(dx_end-dx_beg, 0); 
+    ia_dcolind.reset(); 
+    data_num = no_data = cnum = cnum_before_reduce = 0; 
+  }
+  void run() {
+    const char *eyec = "AzPrepText::gen_regions_unsup"; 
+    int xdic_nn = ia_xnn.size(), ydic_nn = ia_ynn.size(); 
+    bool do_skip_stopunk = (do_xseq)?false:true, do_allow_zero = false; 
+    if (p->do_no_skip) {
+      do_allow_zero = true; 
+      do_skip_stopunk = false; 
+    }
+    if (xdic_nn > 1) do_skip_stopunk = false; /* 6/4/2017: prohibit VariableStride with n-grams */
+    if (do_xseq) do_skip_stopunk = false;   /* 6/4/2017: prohibit VariableStride if sequential */
+    bool do_contain = (xdic_nn > 1); 
+    int unkw = -1;       
+    for (int dx = dx_beg; dx < dx_end; ++dx) {
+      int doc_no = docs->no(dx), len = 0; 
+      const AzByte *buff = docs->point_u(dx, &len); 
       int col_beg = xbc.colNum(); 
       
       /*---  X  ---*/
       AzIntArr ia_x_pos;    
       AzBytArr s_data(buff, len); 
       int my_len = s_data.length();
-
-      bool do_skip_stopunk = (do_xseq)?false:true, do_allow_zero = false; 
-      if (p.do_no_skip) {
-        do_allow_zero = true; 
-        do_skip_stopunk = false; 
-      }
-      if (xdic_nn > 1) do_skip_stopunk = false; /* 6/4/2017: prohibit VariableStride with n-grams */
-      if (do_xseq) do_skip_stopunk = false;   /* 6/4/2017: prohibit VariableStride if sequential */
-      bool do_contain = (xdic_nn > 1); 
-      int unkw = -1;       
-
       AzDataArr<AzIntArr> aia_xtokno; 
-      int xtok_num = AzTools_text::tokenize(s_data.point_u(), my_len, &xdic, ia_xnn, p.do_lower, p.do_utf8dashes, aia_xtokno);        
-      xbc.check_overflow(eyec, xtok_num*p.pch_sz*xdic_nn, data_no); 
-      if (do_xseq) gen_nobow_regions(xtok_num, aia_xtokno, xdic.size(), 
-                                     p.pch_sz, p.pch_step, p.padding, do_allow_zero, unkw, 
+      int xtok_num = (tokc != NULL) ? tokc->identify(buff, len, xdic, ia_xnn, aia_xtokno) 
+                   : AzTools_text::tokenize(s_data.point_u(), my_len, xdic, ia_xnn, p->do_lower, p->do_utf8dashes, aia_xtokno);        
+      xbc.check_overflow(eyec, xtok_num*p->pch_sz*xdic_nn, doc_no); 
+      if (do_xseq) AzPrepText::gen_nobow_regions(xtok_num, aia_xtokno, xdic->size(), 
+                                     p->pch_sz, p->pch_step, p->padding, do_allow_zero, unkw, 
                                      xbc, &ia_x_pos); 
-      else         gen_bow_regions(xtok_num, aia_xtokno, ia_xnn, do_contain,
-                                   p.pch_sz, p.pch_step, p.padding, do_allow_zero, do_skip_stopunk, 
+      else         AzPrepText::gen_bow_regions(xtok_num, aia_xtokno, ia_xnn, do_contain,
+                                   p->pch_sz, p->pch_step, p->padding, do_allow_zero, do_skip_stopunk, 
                                    xbc, &ia_x_pos);  
-
       if (ia_x_pos.size() <= 0) {
         ++no_data; 
         continue; 
@@ -1751,56 +2360,178 @@ void AzPrepText::gen_regions_unsup(int argc, const char *argv[]) const {
       my_len = s_data.length();        
       if (ydic_nn > 1) { /* n-grams */
         AzDataArr<AzIntArr> aia_ytokno; 
-        int ytok_num = AzTools_text::tokenize(s_data.point_u(), my_len, &ydic, ia_ynn, p.do_lower, p.do_utf8dashes, aia_ytokno);  
+        int ytok_num = (tokc != NULL) ? tokc->identify(buff, len, ydic, ia_ynn, aia_ytokno) 
+                     : AzTools_text::tokenize(s_data.point_u(), my_len, ydic, ia_ynn, p->do_lower, p->do_utf8dashes, aia_ytokno);  
         AzX::throw_if((xtok_num != ytok_num), eyec, "conflict in the numbers of X tokens and Y tokens"); 
-        ybc.check_overflow(eyec, ytok_num*ydic_nn*p.dist*2, data_no);         
-        gen_Y_ngram_bow(ia_ynn, aia_ytokno, ydic.size(), ia_x_pos, 
-                        p.pch_sz, l_dist, r_dist, p.gap, p.do_nolr, ybc); 
+        ybc.check_overflow(eyec, ytok_num*ydic_nn*p->dist*2, doc_no);         
+        prep->gen_Y_ngram_bow(ia_ynn, aia_ytokno, ydic->size(), ia_x_pos, 
+                              p->pch_sz, l_dist, r_dist, p->gap, p->do_nolr, ybc); 
       }
       else { /* words */
         int nn = 1; 
         AzIntArr ia_ytokno; 
-        AzTools_text::tokenize(s_data.point_u(), my_len, &ydic, nn, p.do_lower, p.do_utf8dashes, &ia_ytokno);  
+        if (tokc != NULL) tokc->identify(buff, len, ydic, nn, &ia_ytokno); 
+        else AzTools_text::tokenize(s_data.point_u(), my_len, ydic, nn, p->do_lower, p->do_utf8dashes, &ia_ytokno);  
         int ytok_num = ia_ytokno.size(); 
         AzX::throw_if((xtok_num != ytok_num), eyec, "conflict in the numbers of X tokens and Y tokens"); 
-        ybc.check_overflow(eyec, ytok_num*ydic_nn*p.dist*2, data_no);         
-        gen_Y(ia_ytokno, ydic.size(), ia_x_pos, 
-              p.pch_sz, l_dist, r_dist, p.gap, p.do_nolr, ybc);      
+        ybc.check_overflow(eyec, ytok_num*ydic_nn*p->dist*2, doc_no);         
+        prep->gen_Y(ia_ytokno, ydic->size(), ia_x_pos, 
+                    p->pch_sz, l_dist, r_dist, p->gap, p->do_nolr, ybc);      
       }
       
       cnum_before_reduce += xbc.colNum()-col_beg; 
-      reduce_xy(p.min_x, p.min_y, col_beg, xbc, ybc); 
+      prep->reduce_xy(p->min_x, p->min_y, col_beg, xbc, ybc); 
       if (xbc.colNum() <= col_beg) {
         ++no_data; 
         continue;         
       }
       cnum += xbc.colNum()-col_beg; 
-      
-      ++data_no;         
+      ++data_num; 
       ia_dcolind.put(col_beg); ia_dcolind.put(xbc.colNum()); 
       AzX::throw_if(xbc.colNum() != ybc.colNum(), eyec, "Conflict btw X index size and Y index size");         
-      if (data_no == chkmem) {
-        xbc.prepmem(data_no, data_num);
-        ybc.prepmem(data_no, data_num);
-      }           
+    }
+  }
+  
+  /*---  write X and Y (and the word-mapping files if do_dic), and clear them  ---*/
+  static void write(const AzOut &out, Az_bc &xbc, Az_bc &ybc, AzIntArr &ia_dcolind, 
+                    const AzBytArr &s_batch_id, bool do_dic, 
+                    const AzDic &xdic, int x_row_num, const AzDic &ydic, int y_row_num, 
+                    const char *outnm, const AzPrepText_gen_regions_unsup_Param &p) {
+    xbc.commit(); ybc.commit(); 
+    AzTimeLog::print("Generating X ... ", out);
+    AzPrepText::write_regions(out, xbc, x_row_num, ia_dcolind, s_batch_id, outnm, p.s_x_ext.c_str(), p.do_compress); 
+    if (do_dic) AzPrepText::write_dic(xdic, x_row_num, outnm, xtext_ext);  
+    AzTimeLog::print("Generating Y ... ", out);  
+    AzPrepText::write_regions(out, ybc, y_row_num, ia_dcolind, s_batch_id, outnm, p.s_y_ext.c_str(), p.do_compress); 
+    if (do_dic) AzPrepText::write_dic(ydic, y_row_num, outnm, ytext_ext);  
+    xbc.destroy(); ybc.destroy(); ia_dcolind.reset(); 
+  }
+}; 
+
+/*-------------------------------------------------------------------------*/
+/* Note: X and Y use different dictionaries */
+void AzPrepText::gen_regions_unsup(int argc, const char *argv[]) const {
+  const char *eyec = "AzPrepText::gen_regions_unsup"; 
+  AzPrepText_gen_regions_unsup_Param p(argc, argv, out);   
+  check_batch_id(p.s_batch_id);     
+ 
+  bool do_xseq = p.s_xtyp.equals(kw_seq); 
+
+  AzDic ydic(p.s_ydic_fn.c_str()); 
+  int ydic_nn = ydic.get_max_n(); 
+  AzPrint::writeln(out, "y dic n=", ydic_nn); 
+  AzX::throw_if((ydic.size() <= 0), AzInputError, eyec, "No Y (target) vocabulary."); 
+  ydic.build_hash(); 
+  
+  AzDic xdic(p.s_xdic_fn.c_str()); 
+  int xdic_nn = xdic.get_max_n(); 
+  AzPrint::writeln(out, "x dic n=", xdic_nn);   
+  AzX::throw_if((xdic.size() <= 0), AzInputError, eyec, "No vocabulary.");   
+  xdic.build_hash(); 
+  AzX::no_support((xdic_nn > 1 && do_xseq), eyec, "X with multi-word vocabulary and Seq option");    
+
+  /*---  no scan: memory is sized from the bytes once 1/16 of them is done  ---*/
+  bool do_tokc = (p.s_tokc_ext.length() > 0); /* read token caches instead of text */
+  const char *inp_ext = (do_tokc) ? p.s_tokc_ext.c_str() : p.s_txt_ext.c_str(); 
+  AzStrPool sp_list; 
+  AzTools_text::read_file_list(p.s_inp_fn.c_str(), &sp_list); 
+  AZint8 bytes_all = 0; 
+  for (int fx = 0; fx < sp_list.size(); ++fx) {
+    AzBytArr s_fn(sp_list.c_str(fx), inp_ext); 
+    AzFile file(s_fn.c_str()); file.open("rb"); bytes_all += file.size(); file.close(); 
+  }
+  int doc_num = -1; 
+  if (p.batch_num > 1) { /* count the documents to divide them into batches in order */
+    AzOut noout; 
+    AzIntArr ia_data_num; 
+    if (do_tokc) AzTokCache::scan_files_in_list(p.s_inp_fn.c_str(), inp_ext, noout, NULL, &ia_data_num); /* headers only */
+    else         AzTools_text::scan_files_in_list(p.s_inp_fn.c_str(), inp_ext, noout, NULL, &ia_data_num);   
+    doc_num = ia_data_num.sum(); 
+    AzX::throw_if(p.batch_num > doc_num, AzInputError, eyec, kw_num, " must not exceed #data"); 
+  }
+  
+  /*---  read data in batches and generate features in parallel  ---*/
+  /*---  a batch ends at the end of each file, which the token cache relies on  ---*/
+  int l_dist = -p.dist, r_dist = p.dist; 
+  if (p.do_leftonly) r_dist = 0; 
+  if (p.do_rightonly) l_dist = 0; 
+  AzTokCache tokc; 
+  AzDataArr<AzPrepText_gen_regions_unsup_thread> thrs(p.thr_num); 
+  for (int tx = 0; tx < p.thr_num; ++tx) thrs(tx)->reset(this, &p, &xdic, &ydic, do_xseq, l_dist, r_dist, (do_tokc) ? &tokc : NULL); 
+  int batch_size = AzPrepText_docs::batch_size(p.thr_num); 
+  AzPrepText_docs docs; docs.reset(batch_size); 
+
+  /*---  with num_batches, each output batch is written as soon as it is done  ---*/
+  const char *outnm = p.s_rnm.c_str(); 
+  int x_row_num = (xdic_nn <= 1 && do_xseq) ? xdic.size()*p.pch_sz : xdic.size();   
+  int y_row_num = (p.do_nolr) ? ydic.size() : ydic.size()*2; 
+  Az_bc xbc(0, 0), ybc(0, 0); 
+  AzIntArr ia_dcolind; 
+  AZint8 batch_bytes = MAX(1, bytes_all/p.batch_num), bytes_done = 0; /* memory is sized once 1/16 of it is done */
+  bool is_prepped = false; 
+  int bx = 0, doc_end = (p.batch_num > 1) ? doc_num/p.batch_num : -1; /* output batch#bx ends at doc#doc_end */
+  int doc_no = 0; 
+  
+  int no_data = 0, data_no = 0, cnum = 0, cnum_before_reduce = 0; 
+  for (int fx = 0; fx < sp_list.size(); ++fx) { /* for each file */
+    AzBytArr s_fn(sp_list.c_str(fx), inp_ext); 
+    const char *fn = s_fn.c_str(); 
+    AzTimeLog::print(fn, out);   
+    AzTextReader rdr; 
+    if (do_tokc) {
+      tokc.open(fn); 
+      tokc.check_flags(p.do_lower, p.do_utf8dashes, false, false, eyec); 
+    }
+    else rdr.open(fn); 
+    AzFile file(fn); file.open("rb"); int kb_in_file = (int)(file.size()/1024); file.close(); 
+    int inc = kb_in_file / 50, milestone = inc; /* progress in KB */
+    for ( ; ; ) {  /* for each doc */
+      AzTools::check_milestone(milestone, (int)(((do_tokc) ? tokc.tell() : rdr.tell())/1024), inc); 
+      AzByte *buff = NULL; 
+      int len = (do_tokc) ? tokc.next(buff) : rdr.next(buff); 
+      bool is_batch_end = (doc_end >= 0 && doc_no >= doc_end); 
+      if (len <= 0 || is_batch_end || docs.bytes() >= batch_size) {
+        /*---  generate X and Y of the documents in the batch and append them  ---*/
+        bytes_done += docs.bytes(); 
+        int num = docs.run(thrs); 
+        for (int tx = 0; tx < num; ++tx) {
+          AzPrepText_gen_regions_unsup_thread *thr = thrs(tx); 
+          ia_dcolind.concat(&thr->ia_dcolind, xbc.colNum()); 
+          xbc.concat(thr->xbc); ybc.concat(thr->ybc); 
+          thr->xbc.destroy(); thr->ybc.destroy(); 
+          data_no += thr->data_num; no_data += thr->no_data; 
+          cnum += thr->cnum; cnum_before_reduce += thr->cnum_before_reduce; 
+        }
+        docs.clear(); 
+        if (!is_prepped && bytes_done > 0 && bytes_done >= batch_bytes/16) {
+          xbc.prepmem(bytes_done, batch_bytes); 
+          ybc.prepmem(bytes_done, batch_bytes); 
+          is_prepped = true; 
+        }           
+        if (is_batch_end) { /* done with this output batch */
+          AzBytArr s_batch_id; s_batch_id << bx+1 << "of" << p.batch_num; 
+          AzPrepText_gen_regions_unsup_thread::write(out, xbc, ybc, ia_dcolind, s_batch_id, bx == 0, 
+                                                     xdic, x_row_num, ydic, y_row_num, outnm, p); 
+          ++bx; bytes_done = 0; is_prepped = false; 
+          doc_end = (bx < p.batch_num-1) ? (int)((AZint8)doc_num*(bx+1)/p.batch_num) : -1; 
+        }
+      }
+      if (len <= 0) break; 
+      docs.put(buff, len, doc_no); 
+      ++doc_no; 
     } /* for each doc */
     AzTools::finish_milestone(milestone); 
     AzBytArr s("   #data="); s<<data_no<<" no_data="<<no_data<<" #col="<<cnum; AzPrint::writeln(out, s); 
   } /* for each file */
   AzBytArr s("#data="); s<<data_no<<" no_data="<<no_data<<" #col="<<cnum<<" #col_all="<<cnum_before_reduce;
-  s<<" #x="<<xbc.elmNum()<<" #y="<<ybc.elmNum(); 
+  if (p.batch_num <= 1) s<<" #x="<<xbc.elmNum()<<" #y="<<ybc.elmNum(); 
   AzPrint::writeln(out, s);  
-  xbc.commit(); ybc.commit(); 
+  AzX::throw_if(doc_num >= 0 && doc_no != doc_num, eyec, "#data mismatch"); 
 
-  const char *outnm = p.s_rnm.c_str(); 
-  AzTimeLog::print("Generating X ... ", out);
-  int x_row_num = (xdic_nn <= 1 && do_xseq) ? xdic.size()*p.pch_sz : xdic.size();   
-  write_regions(xbc, x_row_num, ia_dcolind, p.s_batch_id, outnm, p.s_x_ext.c_str()); 
-  write_dic(xdic, x_row_num, outnm, xtext_ext);  
-  AzTimeLog::print("Generating Y ... ", out);  
-  int y_row_num = (p.do_nolr) ? ydic.size() : ydic.size()*2; 
-  write_regions(ybc, y_row_num, ia_dcolind, p.s_batch_id, outnm, p.s_y_ext.c_str()); 
-  write_dic(ydic, y_row_num, outnm, ytext_ext);  
+  AzBytArr s_batch_id(&p.s_batch_id); 
+  if (p.batch_num > 1) { s_batch_id.reset(); s_batch_id << bx+1 << "of" << p.batch_num; }
+  AzPrepText_gen_regions_unsup_thread::write(out, xbc, ybc, ia_dcolind, s_batch_id, bx == 0, 
+                                             xdic, x_row_num, ydic, y_row_num, outnm, p); 
   AzTimeLog::print("Done ... ", out); 
 }
 
@@ -1830,8 +2561,11 @@ void AzPrepText::write_regions(const AzOut &out, const Az_bc &bc,
                            int row_num, 
                            const AzIntArr &ia_dcolind, 
                            const AzBytArr &s_batch_id, 
-                           const char *outnm, const char *xy_ext) /* static */ {
+                           const char *outnm, const char *xy_ext, 
+                           bool do_compress) /* static */ {
   AzX::throw_if(!bc.isCommitted(), "AzPrepText::write_regions", "bc is not commited."); 
+  AzX::no_support(do_compress && !AzBytArr::contains(xy_ext, "bc"), "AzPrepText::write_regions", 
+                  "Compression of a file other than binary (*smatbc*)"); 
   int data_num = ia_dcolind.size()/2; 
   AzBytArr s_xy(": "); s_xy << row_num << " x " << bc.colNum() << " (" << (double)bc.elmNum()/(double)bc.colNum(); 
   s_xy << "), #data=" << data_num; 
@@ -1839,13 +2573,14 @@ void AzPrepText::write_regions(const AzOut &out, const Az_bc &bc,
   AzBytArr s_xy_fn(outnm, xy_ext); 
   if (s_batch_id.length() > 0) s_xy_fn << "." << s_batch_id.c_str(); 
   const char *xy_fn = s_xy_fn.c_str(); 
+  if (do_compress) s_xy << " (compressed)"; 
   AzTimeLog::print(xy_fn, s_xy.c_str(), out); 
   AzFile file(xy_fn); file.open("wb"); 
   if (AzBytArr::endsWith(xy_ext, "var")) {
   /* write as AzSmat[b]cVar with consistency check */    
     AzSmatbcVar::write_hdr(&file, data_num, ia_dcolind, true, bc.colNum()); 
   }
-  if (AzBytArr::contains(xy_ext, "bc")) AzSmatbc::write(&file, row_num, bc); 
+  if (AzBytArr::contains(xy_ext, "bc")) AzSmatbc::write(&file, row_num, bc, do_compress); 
   else                                  AzSmatc::write(&file, row_num, bc); /* we need this for seq2-bown */
   file.close(true); 
 }  
@@ -1953,7 +2688,7 @@ void AzPrepText::gen_Y(const AzIntArr &ia_tokno, int dic_sz,
 /*-------------------------------------------------------------------------*/
 class AzPrepText_gen_regions_parsup_Param : public virtual AzPrepText_Param_ {
 public: 
-  AzBytArr s_xtyp, s_xdic_fn, s_inp_fn, s_txt_ext, s_rnm; 
+  AzBytArr s_xtyp, s_xdic_fn, s_inp_fn, s_txt_ext, s_rnm, s_tokc_ext; 
   AzBytArr s_batch_id, s_x_ext, s_y_ext;
   AzBytArr s_feat_fn; 
   int dist, min_x, min_y; 
@@ -1964,9 +2699,11 @@ public:
   bool do_leftonly, do_rightonly, do_no_skip; 
   int top_num_each, top_num_total; 
   double scale_y, min_yval; 
+  int thr_num, batch_num; 
+  bool do_compress; /* X only */
  
   AzPrepText_gen_regions_parsup_Param(int argc, const char *argv[], const AzOut &out) 
-    : dist(0), min_x(1), min_y(1), pch_sz(-1), pch_step(1), padding(0),
+    : thr_num(1), batch_num(1), do_compress(false), dist(0), min_x(1), min_y(1), pch_sz(-1), pch_step(1), padding(0),
       s_x_ext(".xsmatbc"), s_y_ext(".ysmatc"),     
       top_num_each(-1), top_num_total(-1), 
       f_pch_sz(-1), f_pch_step(-1), f_padding(-1), 
@@ -1998,6 +2735,7 @@ public:
     azp.vStr(o, kw_inp_fn, s_inp_fn);      
     azp.vStr(o, kw_rnm, s_rnm);  
     azp.vStr_prt_if_not_empty(o, kw_txt_ext, s_txt_ext);  
+    azp.vStr_prt_if_not_empty(o, kw_tokc_ext, s_tokc_ext); 
     azp.vInt(o, kw_pch_sz, pch_sz);      
     azp.vInt(o, kw_pch_step, pch_step);   
     azp.vInt(o, kw_padding, padding);
@@ -2029,8 +2767,15 @@ public:
     azp.swOn(o, do_leftonly, kw_do_leftonly); 
     if (!do_leftonly) azp.swOn(o, do_rightonly, kw_do_rightonly); 
     if (do_leftonly || do_rightonly) do_nolr = true;
+    azp.vInt(o, kw_thr_num, thr_num); 
+    azp.vInt(o, kw_num, batch_num); 
+    azp.swOn(o, do_compress, kw_do_compress); 
     
     AzX::throw_if(min_x>1 || min_y>1, AzInputError, eyec, "min_x and min_y must be no greater than 1."); 
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
+    AzXi::throw_if_nonpositive(batch_num, eyec, kw_num); 
+    AzXi::throw_if_both(batch_num > 1 && s_batch_id.length() > 0, eyec, kw_num, kw_batch_id); 
+    AzX::no_support(batch_num > 1 && scale_y > 0, eyec, "num_batches= with scale_y= (the scale depends on all the data)"); 
     AzXi::throw_if_empty(s_feat_fn, eyec, kw_feat_fn);      
     AzXi::throw_if_empty(s_xtyp, eyec, kw_xtyp); 
     AzXi::throw_if_empty(s_xdic_fn, eyec, kw_xdic_fn);     
@@ -2073,11 +2818,136 @@ public:
     h.item(kw_do_lower, help_do_lower);     
     h.item(kw_do_utf8dashes, help_do_utf8dashes); 
     h.item(kw_do_nolr, help_do_nolr); 
+    h.item(kw_thr_num, help_thr_num, "1"); 
+    h.item(kw_num, help_batch_num, "1"); 
+    h.item(kw_do_compress, "Compress the region file (X) by encoding the row indexes as variable-length gaps.  The target file (Y) is not binary and is not compressed."); 
+    h.item(kw_tokc_ext, help_tokc_ext); 
     /* txt_ext, x_ext, y_ext, do_no_skip, min_x, min_y, top_num_each */
     h.end(); 
   }   
 }; 
 
+/*-------------------------------------------------------------------------*/
+/*---  gen_regions_parsup: generate X and Y of the documents [dx_beg, dx_end) of a batch  ---*/
+/* Same as AzPrepText_gen_regions_unsup_thread except that Y is generated from  */
+/* the internal features of the documents, which are read in advance to amat.  */
+class AzPrepText_gen_regions_parsup_thread : public virtual AzThread_ {
+public:
+  Az_bc xbc; Az_c yc;  /* output */
+  AzIntArr ia_dcolind; /* output */
+  int data_num, no_data, cnum, cnum_before_reduce, y_row_num; /* output */
+  AzPrepText::feat_info fi[2]; /* output */
+protected:
+  const AzPrepText *prep; 
+  const AzPrepText_gen_regions_parsup_Param *p; 
+  const AzDic *dic; 
+  AzIntArr ia_xnn; 
+  bool do_xseq; 
+  int l_dist, r_dist; 
+  const AzDataArr<AzSmat> *amat; /* [dx]: internal features of doc#dx */
+  const AzTokCache *tokc; /* NULL if the documents are text */
+  AzPrepText_docs *docs; 
+  int dx_beg, dx_end; 
+public:
+  AzPrepText_gen_regions_parsup_thread() : data_num(0), no_data(0), cnum(0), cnum_before_reduce(0), y_row_num(0), 
+      prep(NULL), p(NULL), dic(NULL), do_xseq(false), l_dist(0), r_dist(0), amat(NULL), 
+      tokc(NULL), docs(NULL), dx_beg(0), dx_end(0) {}
+  void reset(const AzPrepText *_prep, const AzPrepText_gen_regions_parsup_Param *_p, 
+             const AzDic *_dic, bool _do_xseq, int _l_dist, int _r_dist, const AzDataArr<AzSmat> *_amat, 
+             const AzTokCache *_tokc) {
+    prep = _prep; p = _p; dic = _dic; do_xseq = _do_xseq; l_dist = _l_dist; r_dist = _r_dist; amat = _amat; 
+    tokc = _tokc; 
+    ia_xnn.reset(); for (int ix = 1; ix <= dic->get_max_n(); ++ix) ia_xnn.put(ix); 
+  }
+  void reset_docs(AzPrepText_docs *_docs, int _dx_beg, int _dx_end) {
+    docs = _docs; dx_beg = _dx_beg; dx_end = _dx_end; 
+    xbc.reset(dx_end-dx_beg, 0); yc.reset(dx_end-dx_beg, 0); 
+    ia_dcolind.reset(); 
+    data_num = no_data = cnum = cnum_before_reduce = 0; 
+    fi[0] = fi[1] = AzPrepText::feat_info(); 
+  }
+  void run() {
+    const char *eyec = "AzPrepText::gen_regions_parsup"; 
+    int xdic_nn = ia_xnn.size(); 
+    bool do_skip_stopunk = (do_xseq) ? false : true;   
+    bool do_allow_zero = false;  
+    if (p->do_no_skip) {
+      do_skip_stopunk = false; 
+      do_allow_zero = true;     
+    }  
+    if (xdic_nn > 1) do_skip_stopunk = false; 
+    bool do_contain = (xdic_nn > 1); 
+    int unkw = -1; 
+    for (int dx = dx_beg; dx < dx_end; ++dx) {
+      int doc_no = docs->no(dx), len = 0; 
+      AzByte *buff = docs->point_u(dx, &len); 
+      int col_beg = xbc.colNum();      
+      /*---  X  ---*/
+      AzIntArr ia_pos; 
+      AzDataArr<AzIntArr> aia_xtokno; 
+      int tok_num = (tokc != NULL) ? tokc->identify(buff, len, dic, ia_xnn, aia_xtokno) 
+                  : AzTools_text::tokenize(buff, len, dic, ia_xnn, p->do_lower, p->do_utf8dashes, aia_xtokno);        
+      xbc.check_overflow(eyec, tok_num*p->pch_sz, doc_no); 
+      if (do_xseq) AzPrepText::gen_nobow_regions(tok_num, aia_xtokno, dic->size(), 
+                                     p->pch_sz, p->pch_step, p->padding, do_allow_zero, unkw, 
+                                     xbc, &ia_pos); 
+      else         AzPrepText::gen_bow_regions(tok_num, aia_xtokno, ia_xnn, do_contain, 
+                                   p->pch_sz, p->pch_step, p->padding, do_allow_zero, do_skip_stopunk, 
+                                   xbc, &ia_pos);  
+      if (ia_pos.size() <= 0) {
+        ++no_data; 
+        continue; 
+      }
+      const AzSmat &m_feat = *(*amat)[dx]; 
+      if (p->top_num_each > 0 || p->top_num_total > 0 || p->scale_y > 0) {
+        double min_ifeat = m_feat.min(); 
+        AzX::no_support((min_ifeat < 0), eyec, "Negative values for internal-feature components."); 
+      }
+ 
+      /*---  Y (ifeat: internal features generated by a supervised model) ---*/ 
+      y_row_num = prep->gen_Y_ifeat(p->top_num_each, p->top_num_total, m_feat, tok_num, ia_pos, 
+                  p->pch_sz, l_dist, r_dist, p->do_nolr, 
+                  p->f_pch_sz, p->f_pch_step, p->f_padding, 
+                  yc, fi); 
+                                        
+      cnum_before_reduce += (xbc.colNum() - col_beg); 
+      prep->reduce_xy(p->min_x, p->min_y, col_beg, xbc, yc);   
+      if (xbc.colNum() <= col_beg) {
+        ++no_data; 
+        continue; 
+      }
+      ia_dcolind.put(col_beg); ia_dcolind.put(xbc.colNum()); 
+      cnum += (xbc.colNum() - col_beg); 
+      ++data_num;         
+      AzX::throw_if(xbc.colNum() != yc.colNum(), eyec, "Conflict btw X #col and Y #col");         
+    }
+  }
+
+  /*---  write X and Y (and the word-mapping file if do_dic), and clear them  ---*/
+  static void write(const AzPrepText *prep, const AzOut &out, Az_bc &xbc, Az_c &yc, AzIntArr &ia_dcolind, 
+                    const AzBytArr &s_batch_id, bool do_dic, 
+                    const AzDic &dic, int x_row_num, int y_row_num, double scale, /* no scaling if scale <= 0 */
+                    const char *outnm, const AzPrepText_gen_regions_parsup_Param &p) {
+    xbc.commit(); yc.commit(); 
+    AzSmatc m_y; m_y.set(y_row_num, yc); 
+    yc.destroy(); 
+    if (p.do_binarize) {
+      AzTimeLog::print("Binarizing Y ... ", log_out); 
+      m_y.binarize(); 
+    }
+    else if (scale > 0) {
+      AzBytArr s("Multiplying Y with "); s << scale; AzPrint::writeln(out, s); 
+      m_y.multiply(scale); 
+    }  
+    AzTimeLog::print("Generating X ... ", out);  
+    AzPrepText::write_regions(out, xbc, x_row_num, ia_dcolind, s_batch_id, outnm, p.s_x_ext.c_str(), p.do_compress);
+    if (do_dic) AzPrepText::write_dic(dic, x_row_num, outnm, xtext_ext); 
+    AzTimeLog::print("Generating Y ... ", out);  
+    prep->write_Y_smatc(m_y, ia_dcolind, s_batch_id, outnm, p.s_y_ext.c_str());   
+    xbc.destroy(); ia_dcolind.reset(); 
+  }
+}; 
+
 /*-------------------------------------------------------------------------*/
 void AzPrepText::gen_regions_parsup(int argc, const char *argv[]) const {
   const char *eyec = "AzPrepText::gen_regions_parsup"; 
@@ -2098,136 +2968,107 @@ void AzPrepText::gen_regions_parsup(int argc, const char *argv[]) const {
   int xdic_nn = dic.get_max_n(); 
   AzPrint::writeln(out, "x dic n=", xdic_nn);
   AzX::throw_if((dic.size() <= 0), AzInputError, eyec, "No vocabulary"); 
+  dic.build_hash(); 
   AzX::no_support((xdic_nn > 1 && do_xseq), eyec, "X with multi-word vocabulary and Seq option"); 
-  AzIntArr ia_xnn; for (int ix = 1; ix <= xdic_nn; ++ix) ia_xnn.put(ix); 
   
-  /*---  scan files to determine buffer size and #data  ---*/
-  AzOut noout; 
+  /*---  no scan: #data is checked against the feature file as it is read  ---*/
+  bool do_tokc = (p.s_tokc_ext.length() > 0); /* read token caches instead of text */
+  const char *inp_ext = (do_tokc) ? p.s_tokc_ext.c_str() : p.s_txt_ext.c_str(); 
   AzStrPool sp_list; 
-  AzIntArr ia_data_num; 
-  int buff_size = AzTools_text::scan_files_in_list(p.s_inp_fn.c_str(), p.s_txt_ext.c_str(), 
-                                                   noout, &sp_list, &ia_data_num);   
-  int data_num = ia_data_num.sum(); 
-  AzX::throw_if ((data_num != feat_data_num), eyec, "#data mismatch"); 
+  AzTools_text::read_file_list(p.s_inp_fn.c_str(), &sp_list); 
+  int data_num = feat_data_num; 
+  AzX::throw_if(p.batch_num > data_num, AzInputError, eyec, kw_num, " must not exceed #data"); 
   
-  /*---  read data and generate features  ---*/
+  /*---  read data in batches and generate features in parallel  ---*/
+  /*---  a batch is also limited by the number and size of internal features  ---*/
+  AzDataArr<AzSmat> amat_feat(1024*p.thr_num); 
+  AzTokCache tokc; 
+  AzDataArr<AzPrepText_gen_regions_parsup_thread> thrs(p.thr_num); 
+  for (int tx = 0; tx < p.thr_num; ++tx) thrs(tx)->reset(this, &p, &dic, do_xseq, l_dist, r_dist, &amat_feat, (do_tokc) ? &tokc : NULL); 
+  int batch_size = AzPrepText_docs::batch_size(p.thr_num); 
+  AzPrepText_docs docs; docs.reset(batch_size); 
+  AZint8 feat_size = 0; 
+
+  /*---  with num_batches, each output batch is written as soon as it is done  ---*/
+  const char *outnm = p.s_rnm.c_str(); 
+  int x_row_num = (xdic_nn <= 1 && do_xseq) ? dic.size()*p.pch_sz : dic.size();     
   Az_bc xbc; 
   Az_c yc; 
   AzIntArr ia_dcolind; 
+  int bx = 0, batch_end = data_num/p.batch_num; /* documents for output batch#bx end here */
+  int doc_no = 0; 
 
-  buff_size += 256; 
-  AzBytArr s_buff; 
-  AzByte *buff = s_buff.reset(buff_size, 0); 
   int no_data = 0, data_no = 0, cnum = 0, cnum_before_reduce = 0; 
   feat_info fi[2];
   int y_row_num = 0;   
   for (int fx = 0; fx < sp_list.size(); ++fx) { /* for each file */
-    AzBytArr s_fn(sp_list.c_str(fx), p.s_txt_ext.c_str()); 
+    AzBytArr s_fn(sp_list.c_str(fx), inp_ext); 
     const char *fn = s_fn.c_str(); 
     AzTimeLog::print(fn, log_out);   
-    AzFile file(fn); 
-    file.open("rb"); 
-    int num_in_file = ia_data_num.get(fx); 
-    int inc = num_in_file / 50, milestone = inc; 
-    int dx = 0; 
-    for ( ; ; ++dx) {  /* for each doc */
-      AzTools::check_milestone(milestone, dx, inc); 
-      int len = file.gets(buff, buff_size); 
-      if (len <= 0) break; 
-
-      bool do_skip_stopunk = (do_xseq) ? false : true;   
-      bool do_allow_zero = false;  
-      if (p.do_no_skip) {
-        do_skip_stopunk = false; 
-        do_allow_zero = true;     
-      }  
-      if (xdic_nn > 1) do_skip_stopunk = false; 
-      bool do_contain = (xdic_nn > 1); 
-      int unkw = -1; 
-      
-      int col_beg = xbc.colNum();      
-      /*---  X  ---*/
-      AzBytArr s_data(buff, len); 
-      int my_len = s_data.length();
-      int tok_num = 0; 
-      AzIntArr ia_pos; 
-
-      AzDataArr<AzIntArr> aia_xtokno; 
-      tok_num = AzTools_text::tokenize(s_data.point_u(), my_len, &dic, ia_xnn, p.do_lower, p.do_utf8dashes, aia_xtokno);        
-      xbc.check_overflow(eyec, tok_num*p.pch_sz, data_no); 
-      if (do_xseq) gen_nobow_regions(tok_num, aia_xtokno, dic.size(), 
-                                     p.pch_sz, p.pch_step, p.padding, do_allow_zero, unkw, 
-                                     xbc, &ia_pos); 
-      else         gen_bow_regions(tok_num, aia_xtokno, ia_xnn, do_contain, 
-                                   p.pch_sz, p.pch_step, p.padding, do_allow_zero, do_skip_stopunk, 
-                                   xbc, &ia_pos);  
-
-      AzSmat m_feat; 
-      mfile.read(&m_feat);      
-      if (ia_pos.size() <= 0) {
-        ++no_data; 
-        continue; 
-      }
-      if (p.top_num_each > 0 || p.top_num_total > 0 || p.scale_y > 0) {
-        double min_ifeat = m_feat.min(); 
-        AzX::no_support((min_ifeat < 0), eyec, "Negative values for internal-feature components."); 
-      }
- 
-      /*---  Y (ifeat: internal features generated by a supervised model) ---*/ 
-      y_row_num = gen_Y_ifeat(p.top_num_each, p.top_num_total, m_feat, tok_num, ia_pos, 
-                  p.pch_sz, l_dist, r_dist, p.do_nolr, 
-                  p.f_pch_sz, p.f_pch_step, p.f_padding, 
-                  yc, fi); 
-                                        
-      cnum_before_reduce += (xbc.colNum() - col_beg); 
-      reduce_xy(p.min_x, p.min_y, col_beg, xbc, yc);   
-      if (xbc.colNum() <= col_beg) {
-        ++no_data; 
-        continue; 
+    AzTextReader rdr; 
+    if (do_tokc) {
+      tokc.open(fn); 
+      tokc.check_flags(p.do_lower, p.do_utf8dashes, false, false, eyec); 
+    }
+    else rdr.open(fn); 
+    AzFile file(fn); file.open("rb"); int kb_in_file = (int)(file.size()/1024); file.close(); 
+    int inc = kb_in_file / 50, milestone = inc; /* progress in KB */
+    for ( ; ; ) {  /* for each doc */
+      AzTools::check_milestone(milestone, (int)(((do_tokc) ? tokc.tell() : rdr.tell())/1024), inc); 
+      AzByte *buff = NULL; 
+      int len = (do_tokc) ? tokc.next(buff) : rdr.next(buff); 
+      if (len <= 0 || doc_no >= batch_end || docs.size() >= amat_feat.size() || 
+          docs.bytes() >= batch_size || feat_size >= batch_size) {
+        /*---  generate X and Y of the documents in the batch and append them  ---*/
+        int num = docs.run(thrs); 
+        for (int tx = 0; tx < num; ++tx) {
+          AzPrepText_gen_regions_parsup_thread *thr = thrs(tx); 
+          ia_dcolind.concat(&thr->ia_dcolind, xbc.colNum()); 
+          xbc.concat(thr->xbc); yc.concat(thr->yc); 
+          thr->xbc.destroy(); thr->yc.destroy(); 
+          data_no += thr->data_num; no_data += thr->no_data; 
+          cnum += thr->cnum; cnum_before_reduce += thr->cnum_before_reduce; 
+          y_row_num = MAX(y_row_num, thr->y_row_num); 
+          fi[0].update(thr->fi[0]); fi[1].update(thr->fi[1]); 
+        }
+        docs.clear(); feat_size = 0; 
+        if (doc_no >= batch_end && bx < p.batch_num-1) { /* done with this output batch */
+          AzBytArr s_batch_id; s_batch_id << bx+1 << "of" << p.batch_num; 
+          AzPrepText_gen_regions_parsup_thread::write(this, out, xbc, yc, ia_dcolind, s_batch_id, bx == 0, 
+                                                      dic, x_row_num, y_row_num, -1, outnm, p); 
+          ++bx; batch_end = (int)((AZint8)data_num*(bx+1)/p.batch_num); 
+        }
       }
-      ia_dcolind.put(col_beg); ia_dcolind.put(xbc.colNum()); 
-      cnum += (xbc.colNum() - col_beg); 
-      ++data_no;         
-      AzX::throw_if(xbc.colNum() != yc.colNum(), eyec, "Conflict btw X #col and Y #col");         
+      if (len <= 0) break; 
+      AzX::throw_if((doc_no >= data_num), AzInputError, eyec, "#data mismatch: the text has more data than the features"); 
+      mfile.read(amat_feat(docs.size())); 
+      feat_size += amat_feat[docs.size()]->elmNum()*(AZint8)sizeof(AZI_VECT_ELM); 
+      docs.put(buff, len, doc_no); 
+      ++doc_no; 
     } /* for each doc */
     AzTools::finish_milestone(milestone); 
     AzBytArr s("   #data="); s << data_no << " no_data=" << no_data << " #col=" << cnum; 
     AzPrint::writeln(out, s); 
   } /* for each file */
+  AzX::throw_if((doc_no != data_num), AzInputError, eyec, "#data mismatch: the text has fewer data than the features"); 
   mfile.done();   
-
-  xbc.commit(); 
-  yc.commit(); 
   
   AzBytArr s("#data="); s<<data_no<<" no_data="<<no_data<<" #col="<<cnum<<" #col_all="<<cnum_before_reduce;        
   AzPrint::writeln(out, s); 
   s.reset("all:"); fi[0].show(s); AzPrint::writeln(out, s); 
   s.reset("top:"); fi[1].show(s); AzPrint::writeln(out, s); 
 
-  AzSmatc m_y; m_y.set(y_row_num, yc); 
-  yc.destroy(); 
-
-  if (p.do_binarize) {
-    AzTimeLog::print("Binarizing Y ... ", log_out); 
-    m_y.binarize(); 
-  }
-  else if (p.scale_y > 0) {
+  double scale = -1; /* no scaling */
+  if (!p.do_binarize && p.scale_y > 0) {
+    scale = 1; 
     double max_top = fi[1].max_val; 
-    double scale = 1; 
     if (max_top < p.scale_y) for ( ; ; scale *= 2) if (max_top*scale >= p.scale_y) break; 
     if (max_top > p.scale_y*2) for ( ; ; scale /= 2) if (max_top*scale <= p.scale_y*2) break; 
-    s.reset("Multiplying Y with "); s << scale; AzPrint::writeln(out, s); 
-    m_y.multiply(scale); 
   }  
-  
-  const char *outnm = p.s_rnm.c_str(); 
-  AzTimeLog::print("Generating X ... ", out);  
-  int x_row_num = (xdic_nn <= 1 && do_xseq) ? dic.size()*p.pch_sz : dic.size();     
-  write_regions(xbc, x_row_num, ia_dcolind, p.s_batch_id, outnm, p.s_x_ext.c_str());
-  write_dic(dic, x_row_num, outnm, xtext_ext); 
-
-  AzTimeLog::print("Generating Y ... ", out);  
-  write_Y_smatc(m_y, ia_dcolind, p.s_batch_id, outnm, p.s_y_ext.c_str());   
+  AzBytArr s_batch_id(&p.s_batch_id); 
+  if (p.batch_num > 1) { s_batch_id.reset(); s_batch_id << bx+1 << "of" << p.batch_num; }
+  AzPrepText_gen_regions_parsup_thread::write(this, out, xbc, yc, ia_dcolind, s_batch_id, bx == 0, 
+                                              dic, x_row_num, y_row_num, scale, outnm, p); 
 }
 
 /*-------------------------------------------------------------------------*/
@@ -2340,6 +3181,7 @@ void AzPrepText::show_regions_XY(int argc, const char *argv[]) const {
   read_XY(p.s_rnm, p.s_y_ext, p.s_batch_id, mv_y); 
   AzBytArr s_xtext_fn(p.s_rnm.c_str(), xtext_ext), s_ytext_fn(p.s_rnm.c_str(), ytext_ext);  
   AzDic xdic(s_xtext_fn.c_str()), ydic(s_ytext_fn.c_str()); 
+  if (xdic.is_hash_signature()) { AzDic sig(xdic); sig.expand_hash_signature(xdic); } /* feature hashing */
   _show_regions_XY(mv_x, mv_y, xdic, ydic, p.do_wordonly); 
 }
 
@@ -2408,6 +3250,7 @@ void AzPrepText::_show_regions_XY(const AzSmatVar &mv_x, const AzSmatVar &mv_y,
 #define kw_do_verbose "Verbose"
 #define kw_rand_seed "random_seed="
 #define kw_wmap_fn "word_map_fn="    
+#define help_w2v_thr_num "Number of threads for reading the word vector text file (wordvec_txt_fn).  The file is split into this many chunks, which are parsed in parallel.  The output does not depend on this."
 /*------------------------------------------------------------*/ 
 class AzPrepText_adapt_word_vectors_Param : public virtual AzPrepText_Param_ {
 public: 
@@ -2416,8 +3259,9 @@ public:
   int rand_seed; 
   double wvec_rand_param; 
   bool do_verbose, do_ignore_dup; 
+  int thr_num; 
   AzPrepText_adapt_word_vectors_Param(int argc, const char *argv[], const AzOut &out) : 
-    wvec_rand_param(-1), do_verbose(false), rand_seed(-1), do_ignore_dup(false) {
+    wvec_rand_param(-1), do_verbose(false), rand_seed(-1), do_ignore_dup(false), thr_num(1) {
     reset(argc, argv, out); 
   }
   void resetParam(const AzOut &out, AzParam &p) {
@@ -2436,12 +3280,14 @@ public:
     p.vFloat(o, kw_wvec_rand_param, wvec_rand_param); 
     p.swOn(o, do_ignore_dup, kw_do_ignore_dup); 
     p.swOn(o, do_verbose, kw_do_verbose); 
+    if (s_w2vtxt_fn.length() > 0) p.vInt(o, kw_thr_num, thr_num); 
     if      (s_wvectxt_fn.length() > 0) AzXi::throw_if_empty(s_wvecdic_fn, eyec, kw_wvecdic_fn); /* old interface */
     else if (s_wvecdic_fn.length() > 0) AzXi::throw_if_empty(s_wvectxt_fn, eyec, kw_wvectxt_fn); /* old interface */ 
     else                                AzXi::throw_if_both_or_neither(s_w2vbin_fn, s_w2vtxt_fn, eyec, kw_w2vbin_fn, kw_w2vtxt_fn); 
     AzXi::throw_if_empty(s_wmap_fn, eyec, kw_wmap_fn); 
     AzXi::throw_if_empty(s_w_fn, eyec, kw_w_fn);   
     if (rand_seed != -1) AzXi::throw_if_nonpositive(rand_seed, eyec, kw_rand_seed); 
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
     
     AzX::throw_if(!s_w_fn.endsWith("dmatc"), AzInputError, eyec, "The weight filename (\"weight_fn\") must end with \"dmatc\"."); 
   }
@@ -2460,6 +3306,7 @@ public:
     h.item(kw_wvec_rand_param, "x: scale of initialization.  If the word-mapping file (word_map_fn) contains words for which word vectors are not given, the word vectors for these unknown words will be randomly set by Gaussian distribution with zero mean with standard deviation x.", "0");     
     /* do_verbose */
     h.item(kw_do_ignore_dup, "Ignore it if there are duplicated words associated with word vectors.  If this is not turned on, the process will be terminated on the detection of duplicated words."); 
+    h.item(kw_thr_num, help_w2v_thr_num, "1"); 
     h.end(); 
   }   
 }; 
@@ -2475,7 +3322,7 @@ void AzPrepText::adapt_word_vectors(int argc, const char *argv[]) const {
   AzDic xdic(p.s_wmap_fn.c_str()), wvecdic; 
   AzDmat m_wvec; 
   if      (p.s_w2vbin_fn.length() > 0) read_word2vec(p.s_w2vbin_fn.c_str(), wvecdic, m_wvec, p.do_ignore_dup); 
-  else if (p.s_w2vtxt_fn.length() > 0) read_word2vec(p.s_w2vtxt_fn.c_str(), wvecdic, m_wvec, p.do_ignore_dup, true); 
+  else if (p.s_w2vtxt_fn.length() > 0) read_word2vec(p.s_w2vtxt_fn.c_str(), wvecdic, m_wvec, p.do_ignore_dup, true, p.thr_num); 
   else {
     wvecdic.reset(p.s_wvecdic_fn.c_str(), p.do_ignore_dup); 
     AzTextMat::readMatrix(p.s_wvectxt_fn.c_str(), &m_wvec); 
@@ -2513,42 +3360,153 @@ void AzPrepText::zerovec_to_randvec(double wvec_rand_param, AzDmat &m_wvec) {
 /*--------------------------------------------------------------*/ 
 /*  read word2vec word vectors as word2vec word-analogy.c does  */
 /*--------------------------------------------------------------*/ 
-void AzPrepText::read_word2vec(const char *fn, AzDic &dic, AzDmat &m_wvec, bool do_ignore_dup, bool is_text) {
+/*---  read_word2vec: parse the vector lines beginning in [offs0, offs1) of a text file  ---*/
+/* With do_count, only the non-blank lines are counted.  Otherwise, the words are   */
+/* put to sp_words and the vectors are written to cols[0::max_num].                 */
+class AzPrepText_read_word2vec_text : public virtual AzThread_ {
+public:
+  int num;              /* output: number of lines (vectors) */
+  AzStrPool sp_words;   /* output */
+protected:
+  const char *fn, *errmsg; 
+  AZint8 offs0, offs1; 
+  int row_num, max_num; 
+  double **cols; 
+  bool do_count; 
+  static bool is_space(AzByte ch) { return (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f'); }
+public:
+  AzPrepText_read_word2vec_text() : num(0), fn(NULL), errmsg(""), offs0(0), offs1(0), row_num(0), max_num(0), 
+                                    cols(NULL), do_count(true) {}
+  void reset_count(const char *_fn, const char *_errmsg, AZint8 _offs0, AZint8 _offs1) {
+    fn = _fn; errmsg = _errmsg; offs0 = _offs0; offs1 = _offs1; do_count = true; cols = NULL; 
+  }
+  void reset_parse(int _row_num, double **_cols, int _max_num) { /* call after reset_count() and run() */
+    row_num = _row_num; cols = _cols; max_num = _max_num; do_count = false; 
+  }
+  void run() {
+    const char *eyec = "AzPrepText_read_word2vec_text::run"; 
+    if (!do_count) sp_words.reset(max_num, 16); 
+    num = 0; 
+    AzTextReader rdr; 
+    rdr.open(fn, offs0, offs1); 
+    for ( ; ; ) {
+      AzByte *line = NULL; 
+      int len = rdr.next(line); 
+      if (len <= 0) break; 
+      const AzByte *p = line, *end = line + len; 
+      for ( ; p < end && is_space(*p); ++p); 
+      if (p >= end) continue; /* blank line */
+      if (do_count) { ++num; continue; }
+      if (num >= max_num) break; 
+      
+      const AzByte *word = p; 
+      for ( ; p < end && !is_space(*p); ++p); 
+      sp_words.put(word, Az64::ptr_diff(p-word)); 
+      double *col = cols[num]; 
+      for (int row = 0; row < row_num; ++row) {
+        for ( ; p < end && is_space(*p); ++p); 
+        AzX::throw_if(p >= end, AzInputError, eyec, errmsg); 
+        col[row] = (float)AzTools::atof_fast(p); /* (float) as before */
+        for ( ; p < end && !is_space(*p); ++p); 
+      }
+      ++num; 
+    }
+    rdr.close(); 
+  }
+}; 
+
+/*--------------------------------------------------------------*/ 
+/* Binary: each vector is read at once through a large stdio buffer. */
+/* Text: the file is split into thr_num chunks at line boundaries;  */
+/*       lines are counted in parallel, and then the chunks are     */
+/*       parsed in parallel directly into the columns of m_wvec.    */
+/* Either way, one word vector per line after the header is assumed */
+/* as in the files written by word2vec.                             */
+void AzPrepText::read_word2vec(const char *fn, AzDic &dic, AzDmat &m_wvec, bool do_ignore_dup, bool is_text, int thr_num) {
   const char *eyec = "AzPrepText::read_word2vec_bin"; 
   AzBytArr s_err("An error was encountered while reading "); 
   s_err << fn << ".  The file is either corrupted or not in the word2vec "; 
   if (is_text) s_err << "text format."; 
   else         s_err << "binary format."; 
+  if (is_text) {
+    read_word2vec_text(fn, dic, m_wvec, do_ignore_dup, thr_num, s_err.c_str()); 
+    return; 
+  }
 
+  AzBytArr s_fbuf; /* declared before file so that it outlives the stream */
   AzFile file(fn); file.open("rb"); 
   FILE *f = file.ptr(); 
+  int fbuf_size = 1024*1024*4; 
+  setvbuf(f, (char *)s_fbuf.reset(fbuf_size, 0), _IOFBF, fbuf_size); /* before reading anything */
   long long words, size; 
   if (fscanf(f, "%lld", &words) != 1) throw new AzException(AzInputError, eyec, s_err.c_str()); 
   if (fscanf(f, "%lld", &size) != 1) throw new AzException(AzInputError, eyec, s_err.c_str()); 
   int row_num = Az64::to_int(size, "dimensionality of word2vec vectors"); 
   int col_num = Az64::to_int(words, "number of word2vec vectors"); 
   m_wvec.reform(row_num, col_num); 
-  char word[4096];  /* assume no words/phrases are longer than this */
-  AzStrPool sp; 
-  for (int b = 0; b < words; b++) {
-    char ch; 
-    if (fscanf(f, "%s%c", word, &ch) != 2) throw new AzException(AzInputError, eyec, s_err.c_str()); 
-    sp.put(word); 
-    for (int a = 0; a < size; a++) {
-      float val; 
-      if (is_text) {
-        char valtxt[4096];  /* assume no values are longer than this */
-        if (fscanf(f, "%s%c", valtxt, &ch) != 2) throw new AzException(AzInputError, eyec, s_err.c_str());         
-        val = (float)atof(valtxt); 
-      }
-      else {
-        if (fread(&val, sizeof(float), 1, f) != 1) throw new AzException(AzInputError, eyec, s_err.c_str()); 
-      }
-      m_wvec.set(a, b, val);  
-    }
+  AzBaseArr<float> a_val; a_val.alloc(MAX(1, row_num)); 
+  float *val = a_val.point_u(); 
+  AzStrPool sp(col_num, 16); 
+  AzBytArr s_word; 
+  for (int b = 0; b < col_num; b++) {
+    /*---  the word: skip white spaces, and read up to a white space, which is also consumed  ---*/
+    int ch; 
+    for (ch = getc(f); ch != EOF && isspace(ch); ch = getc(f)); 
+    if (ch == EOF) throw new AzException(AzInputError, eyec, s_err.c_str()); 
+    s_word.reset(); 
+    for ( ; ch != EOF && !isspace(ch); ch = getc(f)) s_word.concat((AzByte)ch); 
+    if (ch == EOF) throw new AzException(AzInputError, eyec, s_err.c_str()); 
+    sp.put(&s_word); 
+    /*---  the vector  ---*/
+    if (fread(val, sizeof(float), row_num, f) != (size_t)row_num) throw new AzException(AzInputError, eyec, s_err.c_str()); 
+    double *col = m_wvec.col_u(b)->point_u(); 
+    for (int a = 0; a < row_num; ++a) col[a] = val[a]; 
   }
-  dic.reset(&sp, do_ignore_dup);   
   file.close(); 
+  dic.reset(&sp, do_ignore_dup);   
+}
+
+/*--------------------------------------------------------------*/ 
+void AzPrepText::read_word2vec_text(const char *fn, AzDic &dic, AzDmat &m_wvec, bool do_ignore_dup, 
+                                    int thr_num, const char *errmsg) {
+  const char *eyec = "AzPrepText::read_word2vec_text"; 
+  long long words = -1, size = -1; 
+  AZint8 offs = 0, fsz = 0; 
+  {
+    AzTextReader rdr; rdr.open(fn); 
+    AzByte *line = NULL; 
+    int len = rdr.next(line); 
+    AzX::throw_if(len <= 0 || sscanf((char *)line, "%lld %lld", &words, &size) != 2, AzInputError, eyec, errmsg); 
+    offs = rdr.tell(); rdr.close(); 
+    AzFile file(fn); file.open("rb"); fsz = file.size(); file.close(); 
+  }
+  int row_num = Az64::to_int(size, "dimensionality of word2vec vectors"); 
+  int col_num = Az64::to_int(words, "number of word2vec vectors"); 
+  m_wvec.reform(row_num, col_num); 
+
+  AzDataArr<AzPrepText_read_word2vec_text> thrs(MAX(1, thr_num)); 
+  int t_num = thrs.size(); 
+  for (int tx = 0; tx < t_num; ++tx) thrs(tx)->reset_count(fn, errmsg, offs+(fsz-offs)*tx/t_num, offs+(fsz-offs)*(tx+1)/t_num); 
+  if (t_num > 1) AzThreads::run(thrs); /* count the lines of each chunk */
+  else           thrs(0)->num = col_num; /* no need to count */
+  
+  AzBaseArr<double *> a_cols; a_cols.alloc(MAX(1, col_num)); 
+  double **cols = a_cols.point_u(); 
+  for (int col = 0; col < col_num; ++col) cols[col] = m_wvec.col_u(col)->point_u(); 
+  int col0 = 0; 
+  for (int tx = 0; tx < t_num; ++tx) {
+    int num = MIN(thrs[tx]->num, col_num-col0); /* lines after col_num vectors are ignored */
+    thrs(tx)->reset_parse(row_num, cols+col0, num); 
+    col0 += num; 
+  }
+  AzX::throw_if(col0 < col_num, AzInputError, eyec, errmsg); 
+  AzThreads::run(thrs); 
+  AzStrPool sp(col_num, 16); 
+  for (int tx = 0; tx < t_num; ++tx) {
+    sp.put(&thrs(tx)->sp_words); thrs(tx)->sp_words.reset(); 
+  }
+  AzX::throw_if(sp.size() != col_num, AzInputError, eyec, errmsg); 
+  dic.reset(&sp, do_ignore_dup); 
 }
 
 /*------------------------------------------------------------*/ 
@@ -2557,7 +3515,8 @@ class AzPrepText_write_wv_word_mapping_Param : public virtual AzPrepText_Param_
 public: 
   AzBytArr s_w2vbin_fn, s_w2vtxt_fn, s_wmap_fn; 
   bool do_ignore_dup; 
-  AzPrepText_write_wv_word_mapping_Param(int argc, const char *argv[], const AzOut &out) : do_ignore_dup(false) {
+  int thr_num; 
+  AzPrepText_write_wv_word_mapping_Param(int argc, const char *argv[], const AzOut &out) : do_ignore_dup(false), thr_num(1) {
     reset(argc, argv, out); 
   }
   void resetParam(const AzOut &out, AzParam &azp) {
@@ -2567,8 +3526,10 @@ public:
     azp.vStr_prt_if_not_empty(o, kw_w2vtxt_fn, s_w2vtxt_fn);     
     azp.vStr(o, kw_wmap_fn, s_wmap_fn);     
     azp.swOn(o, do_ignore_dup, kw_do_ignore_dup); 
+    if (s_w2vtxt_fn.length() > 0) azp.vInt(o, kw_thr_num, thr_num); 
     AzXi::throw_if_both_or_neither(s_w2vbin_fn, s_w2vtxt_fn, eyec, kw_w2vbin_fn, kw_w2vtxt_fn);    
     AzXi::throw_if_empty(s_wmap_fn, eyec, kw_wmap_fn);       
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
   }
   void printHelp(const AzOut &out) {
     AzHelp h(out); h.begin("", "", "");  h.nl(); 
@@ -2577,6 +3538,7 @@ public:
     h.item(kw_w2vtxt_fn, "Path to a text file containing word vectors and words in the word2vec text format (input).  Either this or wordvec_bin_fn is requried.");
     h.item_required(kw_wmap_fn, "Path to the word mapping file to be written (output)."); 
     h.item(kw_do_ignore_dup, "Ignore it if there are duplicated words associated with word vectors.  If this is not turned on, the process will be terminated on the detection of duplicated words."); 
+    h.item(kw_thr_num, help_w2v_thr_num, "1"); 
     h.end();
   }   
 }; 
@@ -2588,9 +3550,263 @@ void AzPrepText::write_wv_word_mapping(int argc, const char *argv[]) const {
   AzTimeLog::print("Reading vectors ... ", log_out); 
   AzDic wvecdic; AzDmat m_wvec; 
   if (p.s_w2vbin_fn.length() > 0) read_word2vec(p.s_w2vbin_fn.c_str(), wvecdic, m_wvec, p.do_ignore_dup); 
-  else                            read_word2vec(p.s_w2vtxt_fn.c_str(), wvecdic, m_wvec, p.do_ignore_dup, true);  
+  else                            read_word2vec(p.s_w2vtxt_fn.c_str(), wvecdic, m_wvec, p.do_ignore_dup, true, p.thr_num);  
   AzBytArr s(p.s_wmap_fn.c_str()); s << ": size=" << wvecdic.size(); 
   AzTimeLog::print(s.c_str(), log_out); 
   wvecdic.writeText(p.s_wmap_fn.c_str());  
   AzTimeLog::print("Done ... ", log_out); 
 } 
+
+/*-------------------------------------------------------------------------*/
+class AzPrepText_compress_regions_Param : public virtual AzPrepText_Param_ {
+public:
+  AzBytArr s_inp_fn, s_out_fn; 
+  bool do_decompress; 
+  AzPrepText_compress_regions_Param(int argc, const char *argv[], const AzOut &out) : do_decompress(false) {
+    reset(argc, argv, out); 
+  }
+  #define kw_out_fn "output_fn="
+  #define kw_do_decompress "Decompress"
+  void resetParam(const AzOut &out, AzParam &azp) {
+    const char *eyec = "AzPrepText_compress_regions_Param::resetParam"; 
+    AzPrint o(out); 
+    azp.vStr(o, kw_inp_fn, s_inp_fn); 
+    azp.vStr(o, kw_out_fn, s_out_fn); 
+    azp.swOn(o, do_decompress, kw_do_decompress); 
+    AzXi::throw_if_empty(s_inp_fn, eyec, kw_inp_fn); 
+    AzXi::throw_if_empty(s_out_fn, eyec, kw_out_fn); 
+    AzX::throw_if(s_inp_fn.equals(s_out_fn.c_str()), AzInputError, eyec, kw_inp_fn " and " kw_out_fn " must be different."); 
+    o.printEnd(); 
+  }
+  void printHelp(const AzOut &out) const {
+    AzHelp h(out); h.begin("", "", "");  h.nl(); 
+    h.writeln("To convert a binary region or target file (*smatbc or *smatbcvar) to the compressed format (see \"Compress\" of \"gen_regions\"), or back to the uncompressed format.\n", 3); 
+    h.item_required(kw_inp_fn, "Path to the input file, e.g., \"data/train.xsmatbcvar\" or \"data/train.xsmatbcvar.1of5\".  It can be either compressed or not."); 
+    h.item_required(kw_out_fn, "Path to the output file."); 
+    h.item(kw_do_decompress, "Write the uncompressed format, e.g., for an older version of \"reNet\"."); 
+    h.end(); 
+  }
+}; 
+
+/*-------------------------------------------------------------------------*/
+void AzPrepText::compress_regions(int argc, const char *argv[]) const {
+  const char *eyec = "AzPrepText::compress_regions"; 
+  AzPrepText_compress_regions_Param p(argc, argv, out); 
+  const char *inp_fn = p.s_inp_fn.c_str(), *out_fn = p.s_out_fn.c_str(); 
+  bool do_compress = !p.do_decompress; 
+  AzTimeLog::print("Reading ", inp_fn, out); 
+  if (p.s_inp_fn.contains("smatbcvar")) {
+    AzSmatbcVar mv(inp_fn); 
+    AzTimeLog::print("Writing ", out_fn, out); 
+    mv.write(out_fn, do_compress); 
+  }
+  else if (p.s_inp_fn.contains("smatbc")) {
+    AzSmatbc m; m.read(inp_fn); 
+    AzTimeLog::print("Writing ", out_fn, out); 
+    m.write(out_fn, do_compress); 
+  }
+  else {
+    AzX::throw_if(true, AzInputError, eyec, "The input filename must contain \"smatbc\" or \"smatbcvar\": ", inp_fn); 
+  }
+  AzFile inp_file(inp_fn); inp_file.open("rb"); AZint8 inp_sz = inp_file.size(); inp_file.close(); 
+  AzFile out_file(out_fn); out_file.open("rb"); AZint8 out_sz = out_file.size(); out_file.close(); 
+  AzBytArr s("#bytes: "); s << (double)inp_sz << " -> " << (double)out_sz; 
+  AzTimeLog::print(s.c_str(), out); 
+  AzTimeLog::print("Done ... ", out); 
+}
+
+/*-------------------------------------------------------------------------*/
+/*-------------------------------------------------------------------------*/
+class AzPrepText_tokenize_corpus_Param : public virtual AzPrepText_Param_ {
+public:
+  AzBytArr s_inp_fn, s_txt_ext, s_tokc_ext; 
+  bool do_lower, do_utf8dashes, do_char, do_byte; 
+  AzPrepText_tokenize_corpus_Param(int argc, const char *argv[], const AzOut &out) 
+    : s_tokc_ext(".tokc"), do_lower(false), do_utf8dashes(false), do_char(false), do_byte(false) {
+    reset(argc, argv, out); 
+  }
+  void resetParam(const AzOut &out, AzParam &azp) {
+    const char *eyec = "AzPrepText_tokenize_corpus_Param::resetParam"; 
+    AzPrint o(out); 
+    azp.vStr(o, kw_inp_fn, s_inp_fn); 
+    azp.vStr_prt_if_not_empty(o, kw_txt_ext, s_txt_ext); 
+    azp.vStr(o, kw_tokc_ext, s_tokc_ext); 
+    azp.swOn(o, do_lower, kw_do_lower); 
+    azp.swOn(o, do_utf8dashes, kw_do_utf8dashes); 
+    azp.swOn(o, do_char, kw_do_char); 
+    if (!do_char) azp.swOn(o, do_byte, kw_do_byte); 
+    AzXi::throw_if_empty(s_inp_fn, eyec, kw_inp_fn); 
+    AzXi::throw_if_empty(s_tokc_ext, eyec, kw_tokc_ext); 
+    AzX::throw_if(s_tokc_ext.equals(s_txt_ext.c_str()), AzInputError, eyec, kw_txt_ext " and " kw_tokc_ext " must be different."); 
+    o.printEnd(); 
+  }
+  void printHelp(const AzOut &out) const {
+    AzHelp h(out); h.begin("", "", "");  h.nl(); 
+    h.writeln("To tokenize text file(s) once and write token cache file(s), which \"gen_regions\", \"gen_regions_unsup\", and \"gen_regions_parsup\" read instead of the text file(s) with \"token_cache_ext=\".  A token cache keeps the token-id sequences of the documents with the list of all the distinct tokens so that it can be used with any vocabulary file.  The token cache of [input_fn][text_fn_ext] is written to [input_fn][token_cache_ext].\n", 3); 
+    h.item_required(kw_inp_fn, "Path to the input token file or the list of token files.  If the filename ends with \".lst\", the file should be the list of token filenames.  The input token file(s) should contain one document per line, and each document should be tokens delimited by space."); 
+    h.item(kw_txt_ext, "Filename extension of the input token file(s), e.g., \".txt.tok\"."); 
+    h.item(kw_tokc_ext, "Filename extension of the token cache file(s) (output).", ".tokc"); 
+    h.item(kw_do_lower, help_do_lower); 
+    h.item(kw_do_utf8dashes, help_do_utf8dashes); 
+    h.item(kw_do_char, "Use characters as tokens."); 
+    h.item(kw_do_byte, "Use bytes as tokens."); 
+    h.end(); 
+  }
+}; 
+
+/*-------------------------------------------------------------------------*/
+void AzPrepText::tokenize_corpus(int argc, const char *argv[]) const {
+  AzPrepText_tokenize_corpus_Param p(argc, argv, out); 
+  AzStrPool sp_list; 
+  AzTools_text::read_file_list(p.s_inp_fn.c_str(), &sp_list); 
+  for (int fx = 0; fx < sp_list.size(); ++fx) {
+    AzBytArr s_txt_fn(sp_list.c_str(fx), p.s_txt_ext.c_str()), s_tokc_fn(sp_list.c_str(fx), p.s_tokc_ext.c_str()); 
+    AzTimeLog::print(s_txt_fn.c_str(), " -> ", s_tokc_fn.c_str(), out); 
+    AzTokCache::write(s_txt_fn.c_str(), s_tokc_fn.c_str(), p.do_lower, p.do_utf8dashes, p.do_char, p.do_byte, out); 
+  }
+  AzTimeLog::print("Done ... ", out); 
+}
+
+/*-------------------------------------------------------------------------*/
+/*-------------------------------------------------------------------------*/
+class AzPrepText_sort_vocab_Param : public virtual AzPrepText_Param_ {
+public:
+  AzBytArr s_voc_fn, s_out_voc_fn, s_inp_fn, s_txt_ext; 
+  bool do_lower, do_utf8dashes, do_char, do_byte, do_write_count; 
+  int thr_num; 
+  AzPrepText_sort_vocab_Param(int argc, const char *argv[], const AzOut &out) 
+    : do_lower(false), do_utf8dashes(false), do_char(false), do_byte(false), do_write_count(false), thr_num(1) {
+    reset(argc, argv, out); 
+  }
+  #define kw_out_voc_fn "output_vocab_fn="
+  void resetParam(const AzOut &out, AzParam &azp) {
+    const char *eyec = "AzPrepText_sort_vocab_Param::resetParam"; 
+    AzPrint o(out); 
+    azp.vStr(o, kw_voc_fn, s_voc_fn); 
+    azp.vStr(o, kw_out_voc_fn, s_out_voc_fn); 
+    azp.vStr_prt_if_not_empty(o, kw_inp_fn, s_inp_fn); 
+    if (s_inp_fn.length() > 0) {
+      azp.vStr_prt_if_not_empty(o, kw_txt_ext, s_txt_ext); 
+      azp.swOn(o, do_lower, kw_do_lower); 
+      azp.swOn(o, do_utf8dashes, kw_do_utf8dashes); 
+      azp.swOn(o, do_char, kw_do_char); 
+      if (!do_char) azp.swOn(o, do_byte, kw_do_byte); 
+      azp.vInt(o, kw_thr_num, thr_num); 
+    }
+    azp.swOn(o, do_write_count, kw_do_write_count); 
+    AzXi::throw_if_empty(s_voc_fn, eyec, kw_voc_fn); 
+    AzXi::throw_if_empty(s_out_voc_fn, eyec, kw_out_voc_fn); 
+    AzXi::throw_if_nonpositive(thr_num, eyec, kw_thr_num); 
+    o.printEnd(); 
+  }
+  void printHelp(const AzOut &out) const {
+    AzHelp h(out); h.begin("", "", "");  h.nl(); 
+    h.writeln("To write the entries of a vocabulary file in the descending order of their counts (ties in the original order) so that the most frequent words get the smallest ids in the region files generated with it, which keeps the frequently used rows of the first-layer weights together.  The counts are taken from the vocabulary file (written with WriteCount) or, if input_fn is given, from the text.  All the entries are kept so that a model trained with the original vocabulary can be migrated by \"reNet reorder_words\".\n", 3); 
+    h.item_required(kw_voc_fn, "Path to the vocabulary file (input)."); 
+    h.item_required(kw_out_voc_fn, "Path to the sorted vocabulary file (output)."); 
+    h.item(kw_inp_fn, "Path to the token file or the list of token files to count the vocabulary entries in.  If it ends with \".lst\", the file should contain the list of token filenames.", "Counts in the vocabulary file"); 
+    h.item(kw_txt_ext, "Filename extension of the token file(s)."); 
+    h.item(kw_do_lower, help_do_lower); 
+    h.item(kw_do_utf8dashes, help_do_utf8dashes); 
+    h.item(kw_do_char, "Use characters as tokens."); 
+    h.item(kw_do_byte, "Use bytes as tokens."); 
+    h.item(kw_thr_num, "Number of threads.  Each file is split into this many chunks, which are processed in parallel.  The output does not depend on this.", "1"); 
+    h.item(kw_do_write_count, "Write the counts as well as the words to the vocabulary file."); 
+    h.end(); 
+  }
+}; 
+
+/*---  sort_vocab: count the vocabulary entries in the lines starting in [offs0, offs1) of a file  ---*/
+class AzPrepText_sort_vocab_count : public virtual AzThread_ {
+public:
+  AzDvect v_count; /* output */
+protected:
+  const AzPrepText_sort_vocab_Param *p; 
+  const AzDic *dic; 
+  AzIntArr ia_nn; 
+  const char *fn; 
+  AZint8 offs0, offs1; 
+public:
+  AzPrepText_sort_vocab_count() : p(NULL), dic(NULL), fn(NULL), offs0(0), offs1(0) {}
+  void reset(const AzPrepText_sort_vocab_Param *_p, const AzDic *_dic, const AzIntArr &_ia_nn, 
+             const char *_fn, AZint8 _offs0, AZint8 _offs1) {
+    p = _p; dic = _dic; ia_nn.reset(&_ia_nn); fn = _fn; offs0 = _offs0; offs1 = _offs1; 
+  }
+  void run() {
+    v_count.reform(dic->size()); 
+    double *count = v_count.point_u(); 
+    AzTextReader rdr; 
+    rdr.open(fn, offs0, offs1); 
+    for ( ; ; ) {
+      AzByte *buff = NULL; 
+      int len = rdr.next(buff); 
+      if (len <= 0) break; 
+      AzDataArr<AzIntArr> aia_tokno; 
+      AzTools_text::tokenize(buff, len, dic, ia_nn, p->do_lower, p->do_utf8dashes, aia_tokno, p->do_char, p->do_byte); 
+      for (int nx = 0; nx < aia_tokno.size(); ++nx) {
+        const int *tokno = aia_tokno[nx]->point(); 
+        for (int ix = 0; ix < aia_tokno[nx]->size(); ++ix) if (tokno[ix] >= 0) ++count[tokno[ix]]; 
+      }
+    }
+    rdr.close(); 
+  }
+}; 
+
+/*-------------------------------------------------------------------------*/
+void AzPrepText::sort_vocab(int argc, const char *argv[]) const {
+  const char *eyec = "AzPrepText::sort_vocab"; 
+  AzPrepText_sort_vocab_Param p(argc, argv, out); 
+  AzDic dic(p.s_voc_fn.c_str()); 
+  AzX::throw_if(dic.size() <= 0, AzInputError, eyec, "empty dic: ", p.s_voc_fn.c_str()); 
+
+  AzDvect v_count(dic.size()); 
+  if (p.s_inp_fn.length() > 0) { /* count the entries as gen_regions would find them */
+    AzIntArr ia_nn; 
+    int max_nn = dic.get_max_n(); 
+    AzX::no_support((max_nn == 0), eyec, "Empty vocabulary"); 
+    if (max_nn == 1) ia_nn.put(1); 
+    else for (int nn = dic.get_min_n(); nn <= max_nn; ++nn) ia_nn.put(nn); 
+    dic.build_hash(); 
+    AzStrPool sp_list; 
+    AzTools_text::read_file_list(p.s_inp_fn.c_str(), &sp_list); 
+    AzDataArr<AzPrepText_sort_vocab_count> counts(p.thr_num); 
+    for (int fx = 0; fx < sp_list.size(); ++fx) {
+      AzBytArr s_fn(sp_list.c_str(fx), p.s_txt_ext.c_str()); 
+      const char *fn = s_fn.c_str(); 
+      AzTimeLog::print(fn, out); 
+      AzFile file(fn); file.open("rb"); AZint8 fsz = file.size(); file.close(); 
+      for (int tx = 0; tx < p.thr_num; ++tx) counts(tx)->reset(&p, &dic, ia_nn, fn, fsz*tx/p.thr_num, fsz*(tx+1)/p.thr_num); 
+      AzThreads::run(counts); 
+      for (int tx = 0; tx < p.thr_num; ++tx) v_count.add(&counts[tx]->v_count); 
+    }
+  }
+  else {
+    for (int ix = 0; ix < dic.size(); ++ix) v_count.set(ix, (double)dic.count(ix)); 
+    AzX::throw_if((v_count.max() <= 1), AzInputError, eyec, "No counts in the vocabulary file.  Use a vocabulary file with counts (WriteCount) or specify ", kw_inp_fn); 
+  }
+
+  /*---  write_vocab sorts by count (descending) and then by the original order  ---*/
+  AzStrPool sp(dic.size(), 10); 
+  for (int ix = 0; ix < dic.size(); ++ix) {
+    int len; const AzByte *bytes = dic.ref().point(ix, &len); 
+    sp.put(bytes, len, (AZint8)v_count.get(ix)); 
+  }
+  AzTimeLog::print("Writing to ", p.s_out_voc_fn.c_str(), out); 
+  int sz = write_vocab(p.s_out_voc_fn.c_str(), &sp, -1, -1, p.do_write_count); 
+
+  /*---  how concentrated the accesses are  ---*/
+  AzIFarr ifa_count; ifa_count.prepare(v_count.rowNum()); 
+  for (int ix = 0; ix < v_count.rowNum(); ++ix) ifa_count.put(ix, v_count.get(ix)); 
+  ifa_count.sort_Float(false); 
+  double total = v_count.sum(), top = 0; 
+  AzBytArr s("Share of the occurrences: "); 
+  for (int ix = 0, pct = 1; ix < ifa_count.size() && pct <= 10 && total > 0; ++ix) {
+    top += ifa_count.get(ix); 
+    if (ix+1 == MAX(1, ifa_count.size()*pct/100)) {
+      s << "top " << pct << "%: "; s.cn(top/total*100, 3); s << "%  "; 
+      pct = (pct == 1) ? 10 : 100; 
+    }
+  }
+  AzPrint::writeln(out, s); 
+  AzTimeLog::print("Done: size=", sz, out); 
+}
@@ -25,6 +25,7 @@
 #include "AzPrint.hpp"
 #include "AzSmat.hpp"
 #include "AzDic.hpp"
+#include "AzCountMin.hpp"
 
 class AzPrepText {
 public:  
@@ -44,6 +45,9 @@ public:
 
   void adapt_word_vectors(int argc, const char *argv[]) const; 
   void write_wv_word_mapping(int argc, const char *argv[]) const; 
+  void compress_regions(int argc, const char *argv[]) const; 
+  void tokenize_corpus(int argc, const char *argv[]) const; 
+  void sort_vocab(int argc, const char *argv[]) const; 
   
   /*-----*/                            
   void gen_regions_unsup(int argc, const char *argv[]) const; 
@@ -51,58 +55,38 @@ public:
   void show_regions_XY(int argc, const char *argv[]) const;  
  
 protected:                       
-  /*---  for gen_regions  ---*/
-  void gen_nobow_regions(int t_num, const AzDataArr<AzIntArr> &aia_nx_tok, 
-                       int dic_sz, int pch_sz, int pch_step, int padding,  
-                       bool do_allow_zero, int unkw, 
-                       /*---  output  ---*/
-                       Az_bc &bc, 
-                       AzIntArr *ia_pos) /* patch position: may be NULL */ const; 
-  void gen_nobow_regions_pos(int t_num, const AzDataArr<AzIntArr> &aia_tok, 
-                       int dic_sz, int pch_sz, const AzIntArr &ia_tx0, int unkw, 
-                       /*---  output  ---*/
-                       Az_bc &bc, 
-                       AzIntArr *ia_pos) const; 
+  /*---  for gen_vocab with sketch_mb  ---*/
+  void check_vocab_threshold(const AzStrPool &sp, int max_num, int min_count, unsigned int th) const; 
 
-  void gen_bow_regions(int t_num, const AzDataArr<AzIntArr> &aia_tokno, 
-                       const AzIntArr &ia_nn, bool do_contain, 
-                       int pch_sz, int pch_step, int padding,  
-                       bool do_allow_zero, bool do_skip_stopunk, 
-                       /*---  output  ---*/
-                       Az_bc &bc, 
-                       AzIntArr *ia_pos) /* patch position: may be NULL */ const; 
-  void gen_bow_regions_pos(int t_num, const AzDataArr<AzIntArr> &aia_tokno, 
-                       const AzIntArr &ia_nn, bool do_contain, 
-                       int pch_sz, const AzIntArr &ia_tx0, 
-                       /*---  output  ---*/
-                       Az_bc &bc, 
-                       AzIntArr *ia_pos) const;                   
-  
   /*---  for show_regions  ---*/
   void _show_regions(const AzSmatVar *mv, const AzDic *dic, bool do_wordonly) const; 
   
   /*---  for nbw  ---*/
-  static void scale(AzSmat *ms, const AzDvect *v);                          
+  static void scale(AzSmat *ms, const AzDvect *v, int thr_num=1);                          
 
   /*---  ---*/
-  void write_Y(const AzSmat &m_y, const AzBytArr &s_y_fn, const AzBytArr *s_batch_id=NULL) const {
-    write_Y(out, m_y, s_y_fn, s_batch_id); 
+  void write_Y(const AzSmat &m_y, const AzBytArr &s_y_fn, const AzBytArr *s_batch_id=NULL, bool do_compress=false) const {
+    write_Y(out, m_y, s_y_fn, s_batch_id, do_compress); 
   }
-  void write_X(const AzSmat &m_x, const AzBytArr &s_x_fn, const AzBytArr *s_batch_id=NULL) const {
-    write_X(out, m_x, s_x_fn, s_batch_id); 
+  void write_X(const AzSmat &m_x, const AzBytArr &s_x_fn, const AzBytArr *s_batch_id=NULL, bool do_compress=false) const {
+    write_X(out, m_x, s_x_fn, s_batch_id, do_compress); 
   }
   
-  int add_unkw(AzDic &dic) const; 
+  int add_unkw(AzDic &dic) const { return add_unkw(out, dic); }
 
   void union_vocab(const AzStrPool &sp_fns, AzStrPool &out_sp, bool do_1stfirst) const; 
   void join_vocab(const AzStrPool &sp_fns, AzStrPool &out_sp) const; 
+  int stream_merge_vocab(const AzStrPool &sp_fns, const char *voc_fn, bool do_join, 
+                         int max_num, int min_count, bool do_write_count, bool do_sort_word) const; 
 
   /*-----*/
+  friend class AzPrepText_gen_regions_unsup_thread;  /* to call gen_Y etc. on threads */
+  friend class AzPrepText_gen_regions_parsup_thread; 
   void write_regions(const Az_bc &bc, int row_num,
                            const AzIntArr &ia_dcolind, 
                            const AzBytArr &s_batch_id, 
-                           const char *outnm, const char *ext) const {
-    write_regions(out, bc, row_num, ia_dcolind, s_batch_id, outnm, ext); 
+                           const char *outnm, const char *ext, bool do_compress=false) const {
+    write_regions(out, bc, row_num, ia_dcolind, s_batch_id, outnm, ext, do_compress); 
   }                             
              
   void gen_Y(const AzIntArr &ia_tokno, int dic_sz, const AzIntArr &ia_pos, 
@@ -132,6 +116,13 @@ protected:
       count += ifa.size(); 
       sum += ifa.sum(); 
     }
+    void update(const feat_info &inp) { /* e.g., to merge the statistics of threads */
+      if (inp.count <= 0) return; 
+      min_val = MIN(min_val, inp.min_val); 
+      max_val = MAX(max_val, inp.max_val); 
+      count += inp.count; 
+      sum += inp.sum; 
+    }
     void show(AzBytArr &s) const {
       if (count <= 0) s << "No info"; 
       s << "min," << min_val << ",max," << max_val << ",avg," << sum/count << ",count," << count; 
@@ -158,32 +149,63 @@ protected:
                                
 public:
   /*---  for gen_vocab  ---*/
-  static void put_in_voc(int nn, 
-                  AzStrPool &sp_voc, 
+  static const char *gen_voc_item(int nn, 
                   const AzStrPool &sp_words, 
                   int wx, /* position in sp_words */
-                  AZint8 count, 
                   bool do_stop_if_all, 
                   const AzStrPool *sp_stop, 
-                  bool do_remove_number);   
+                  bool do_remove_number, 
+                  AzBytArr &s_work);   
+  static unsigned int raise_vocab_threshold(AzStrPoolh *sp_voc, const AzCountMin &cm, unsigned int th, int max_cand); 
   static AzByte gen_1byte_index(const AzStrPool *sp_words, int wx); 
   static int write_vocab(const char *fn, const AzStrPool *sp, 
-                          int max_num, int min_count, bool do_write_count); 
+                          int max_num, int min_count, bool do_write_count, bool do_sort_word=false); 
   
+  /*---  for gen_regions; also used by AzpData_text to generate regions in memory  ---*/
+  static void gen_nobow_regions(int t_num, const AzDataArr<AzIntArr> &aia_nx_tok, 
+                       int dic_sz, int pch_sz, int pch_step, int padding,  
+                       bool do_allow_zero, int unkw, 
+                       /*---  output  ---*/
+                       Az_bc &bc, 
+                       AzIntArr *ia_pos) /* patch position: may be NULL */; 
+  static void gen_nobow_regions_pos(int t_num, const AzDataArr<AzIntArr> &aia_tok, 
+                       int dic_sz, int pch_sz, const AzIntArr &ia_tx0, int unkw, 
+                       /*---  output  ---*/
+                       Az_bc &bc, 
+                       AzIntArr *ia_pos); 
+
+  static void gen_bow_regions(int t_num, const AzDataArr<AzIntArr> &aia_tokno, 
+                       const AzIntArr &ia_nn, bool do_contain, 
+                       int pch_sz, int pch_step, int padding,  
+                       bool do_allow_zero, bool do_skip_stopunk, 
+                       /*---  output  ---*/
+                       Az_bc &bc, 
+                       AzIntArr *ia_pos) /* patch position: may be NULL */; 
+  static void gen_bow_regions_pos(int t_num, const AzDataArr<AzIntArr> &aia_tokno, 
+                       const AzIntArr &ia_nn, bool do_contain, 
+                       int pch_sz, const AzIntArr &ia_tx0, 
+                       /*---  output  ---*/
+                       Az_bc &bc, 
+                       AzIntArr *ia_pos);
+
   /*-----*/     
   static void gen_nobow_dic(const AzDic &inp_dic, int pch_sz, AzDic &out_dic);  
+  static int add_unkw(const AzOut &out, AzDic &dic); 
   static void check_batch_id(const AzBytArr &s_batch_id);  
   static void check_y_ext(const AzBytArr &s_y_ext, const char *eyec);                                  
   static void write_regions(const AzOut &out, const Az_bc &bc, int row_num,
                            const AzIntArr &ia_dcolind, const AzBytArr &s_batch_id, 
-                           const char *outnm, const char *ext); 
+                           const char *outnm, const char *ext, bool do_compress=false); 
   static void write_dic(const AzDic &dic, int row_num, const char *nm, const char *ext); 
-  static void write_Y(const AzOut &out, const AzSmat &m_y, const AzBytArr &s_y_fn, const AzBytArr *s_batch_id=NULL); 
-  static void write_X(const AzOut &out, const AzSmat &m_x, const AzBytArr &s_x_fn, const AzBytArr *s_batch_id=NULL); 
+  static void write_Y(const AzOut &out, const AzSmat &m_y, const AzBytArr &s_y_fn, const AzBytArr *s_batch_id=NULL, 
+                      bool do_compress=false); 
+  static void write_X(const AzOut &out, const AzSmat &m_x, const AzBytArr &s_x_fn, const AzBytArr *s_batch_id=NULL, 
+                      bool do_compress=false); 
 
   static void check_size(const AzOut &out, const AzSmat &m);   
   
   static void zerovec_to_randvec(double wvec_rand_param, AzDmat &m_wvec); 
-  static void read_word2vec(const char *fn, AzDic &dic, AzDmat &m_wvec, bool do_ignore_dup, bool is_text=false); 
+  static void read_word2vec(const char *fn, AzDic &dic, AzDmat &m_wvec, bool do_ignore_dup, bool is_text=false, int thr_num=1); 
+  static void read_word2vec_text(const char *fn, AzDic &dic, AzDmat &m_wvec, bool do_ignore_dup, int thr_num, const char *errmsg); 
 }; 
 #endif 
\ No newline at end of file
@@ -0,0 +1,322 @@
+/* * * * *
+ *  AzTokCache.hpp
+ *  Copyright (C) 2017 Rie Johnson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * * * * */
+
+#ifndef _AZ_TOK_CACHE_HPP_
+#define _AZ_TOK_CACHE_HPP_
+
+#include "AzUtil.hpp"
+#include "AzTools.hpp"
+#include "AzStrPool.hpp"
+#include "AzDic.hpp"
+#include "AzVarint.hpp"
+#include "AzTextReader.hpp"
+#include "AzTools_text.hpp"
+
+/*---  token cache: the documents of a text file as token-id sequences  ---*/
+/* Written by "prepText tokenize_corpus" and read by gen_regions* instead of   */
+/* the text file so that the text is tokenized only once.  Token ids refer to  */
+/* the word list of the cache, which has all the distinct tokens of the file   */
+/* after normalization (LowerCase, UTF8, Char, and Byte are fixed when it is   */
+/* written).  Therefore, a cache can be used with any vocabulary file, e.g.,   */
+/* vocabularies of different sizes or of n-grams, and the tokens are mapped    */
+/* to the vocabulary exactly as the text would be.                             */
+/* The word list is followed by its checksum, which is verified on reading.    */
+/*                                                                             */
+/* Format: header, flags, #doc, max line length, offset of the word list;      */
+/*   [int #bytes][varint #token][varint id] ... for each document;             */
+/*   word list: #word, #bytes, words terminated by '\0', checksum.              */
+class AzTokCache {
+protected:
+  static const int version = 0;
+  static const int reserved_len = 64;
+  bool do_lower, do_utf8dashes, do_char, do_byte;
+  int data_num, max_len; /* max_len: of the lines of the text file */
+  AZint8 words_offs;
+
+  AzBaseArr<AzByte> a_words; /* words terminated by '\0' */
+  AzIntArr ia_woffs;         /* [id]: offset in a_words; [#word]: the end */
+  AzBaseArr<unsigned long long> a_whash; /* [id]: AzDic::hash_word */
+  unsigned long long checksum;
+
+  AzFile file; /* for reading documents */
+  int doc_no;
+  AzBytArr s_doc;
+
+public:
+  AzTokCache() : do_lower(false), do_utf8dashes(false), do_char(false), do_byte(false),
+                 data_num(0), max_len(0), words_offs(0), checksum(0), doc_no(0) {}
+  int dataNum() const { return data_num; }
+  int maxLen() const { return max_len; }
+  int wordNum() const { return ia_woffs.size()-1; }
+
+  /*---  read the header and the word list; documents are read by next()  ---*/
+  void open(const char *fn) {
+    file.close();
+    file.reset(fn); file.open("rb");
+    read_header();
+    AZint8 docs_offs = file.tell();
+    file.seek(words_offs);
+    read_words();
+    file.seek(docs_offs);
+    doc_no = 0;
+  }
+  void close() { file.close(); }
+  AZint8 tell() const { return file.tell(); } /* offset of the next document */
+
+  /*---  return the length of the encoded document; 0 at the end  ---*/
+  int next(AzByte *&doc) {
+    const char *eyec = "AzTokCache::next";
+    doc = NULL;
+    if (doc_no >= data_num) return 0;
+    int len = file.readInt();
+    AzX::throw_if(len <= 0, AzInputError, eyec, "Corrupted data: ", file.pointFileName());
+    doc = s_doc.reset(len, 0);
+    file.readBytes(doc, len);
+    ++doc_no;
+    return len;
+  }
+
+  /*---  the normalization options must be the ones the cache was written with  ---*/
+  void check_flags(bool _do_lower, bool _do_utf8dashes, bool _do_char, bool _do_byte, const char *eyec) const {
+    if (_do_lower == do_lower && _do_utf8dashes == do_utf8dashes && _do_char == do_char && _do_byte == do_byte) return;
+    AzBytArr s(file.pointFileName()); s << " was tokenized with different options: ";
+    if (do_lower) s << "LowerCase ";
+    if (do_utf8dashes) s << "UTF8 ";
+    if (do_char) s << "Char ";
+    if (do_byte) s << "Byte ";
+    if (!do_lower && !do_utf8dashes && !do_char && !do_byte) s << "(none)";
+    AzX::throw_if(true, AzInputError, eyec, s.c_str());
+  }
+
+  /*---  same output as AzTools_text::tokenize(buff, len, dic, ia_nn, ...) on the text  ---*/
+  int identify(const AzByte *doc, int len, const AzDic *dic, const AzIntArr &ia_nn,
+               AzDataArr<AzIntArr> &aia_tokno) const {
+    AzIntArr ia_id;
+    int t_num = decode(doc, len, ia_id);
+    aia_tokno.reset(ia_nn.size());
+    if (dic != NULL && dic->has_hash() && !do_char && !do_byte) { /* no token strings */
+      AzIntArr ia_span; AzBaseArr<unsigned long long> a_hash;
+      to_spans(ia_id, ia_span, a_hash);
+      for (int ix = 0; ix < ia_nn.size(); ++ix) {
+        AzTools_text::identify_tokens(a_words.point(), ia_span, a_hash.point(), ia_nn[ix], dic, aia_tokno(ix));
+      }
+    }
+    else {
+      AzStrPool sp_tok;
+      to_strpool(ia_id, sp_tok);
+      for (int ix = 0; ix < ia_nn.size(); ++ix) AzTools_text::identify_tokens(&sp_tok, ia_nn[ix], dic, aia_tokno(ix));
+    }
+    return t_num;
+  }
+  void identify(const AzByte *doc, int len, const AzDic *dic, int nn, AzIntArr *ia_tokno) const {
+    AzIntArr ia_nn; ia_nn.put(nn);
+    AzDataArr<AzIntArr> aia_tokno;
+    identify(doc, len, dic, ia_nn, aia_tokno);
+    ia_tokno->reset(aia_tokno[0]);
+  }
+  /*---  same output as AzTools_text::tokenize_hashed on the text  ---*/
+  int identify_hashed(const AzByte *doc, int len, int hash_bits, const AzIntArr &ia_nn,
+                      AzDataArr<AzIntArr> &aia_tokno) const {
+    AzIntArr ia_id;
+    int t_num = decode(doc, len, ia_id);
+    AzBaseArr<unsigned long long> a_hash(MAX(1, t_num));
+    unsigned long long *tok_hash = a_hash.point_u();
+    for (int tx = 0; tx < t_num; ++tx) tok_hash[tx] = a_whash.point()[ia_id[tx]];
+    aia_tokno.reset(ia_nn.size());
+    for (int ix = 0; ix < ia_nn.size(); ++ix) {
+      AzTools_text::identify_tokens_hashed(t_num, tok_hash, ia_nn[ix], hash_bits, aia_tokno(ix));
+    }
+    return t_num;
+  }
+
+  /*---  as AzTools_text::scan_files_in_list; only the headers are read  ---*/
+  static int scan_files_in_list(const char *inp_fn, const char *ext, const AzOut &out,
+                                AzStrPool *out_sp_list, AzIntArr *ia_data_num) {
+    AzStrPool sp_list;
+    AzTools_text::read_file_list(inp_fn, &sp_list);
+    if (ia_data_num != NULL) ia_data_num->reset();
+    int buff_size = 0;
+    for (int fx = 0; fx < sp_list.size(); ++fx) {
+      AzBytArr s(sp_list.c_str(fx)); s.c(ext);
+      AzTimeLog::print("scanning ", s.c_str(), out);
+      AzTokCache tokc;
+      tokc.file.reset(s.c_str()); tokc.file.open("rb");
+      tokc.read_header();
+      tokc.file.close();
+      buff_size = MAX(buff_size, tokc.max_len);
+      if (ia_data_num != NULL) ia_data_num->put(tokc.data_num);
+    }
+    if (out_sp_list != NULL) out_sp_list->reset(&sp_list);
+    return buff_size;
+  }
+
+  /*---  tokenize a text file (one document per line) and write the cache  ---*/
+  static void write(const char *txt_fn, const char *fn,
+                    bool do_lower, bool do_utf8dashes, bool do_char, bool do_byte, const AzOut &out) {
+    const char *eyec = "AzTokCache::write";
+    AzTokCache tokc;
+    tokc.do_lower = do_lower; tokc.do_utf8dashes = do_utf8dashes;
+    tokc.do_char = do_char; tokc.do_byte = do_byte;
+    AzFile ofile(fn); ofile.open("wb");
+    tokc.write_header(&ofile); /* to be overwritten at the end */
+
+    AzStrPoolh sp_words; /* id: the order of first occurrence */
+    AzTextReader rdr; rdr.open(txt_fn);
+    AzIntArr ia_span, ia_id;
+    AzBytArr s_enc;
+    AZint8 tok_num = 0, enc_bytes = 0;
+    for ( ; ; ++tokc.data_num) { /* for each document */
+      AzByte *buff = NULL;
+      int len = rdr.next(buff);
+      if (len <= 0) break;
+      tokc.max_len = MAX(tokc.max_len, len);
+      ia_id.reset();
+      if (!do_char && !do_byte) { /* no token strings */
+        AzTools_text::normalize(buff, len, do_utf8dashes, do_lower, NULL, &ia_span);
+        for (int tx = 0; tx < ia_span.size()/2; ++tx) ia_id.put(sp_words.put(buff+ia_span[tx*2], ia_span[tx*2+1]));
+      }
+      else {
+        AzStrPool sp_tok;
+        AzTools_text::tokenize(buff, len, do_utf8dashes, do_lower, sp_tok, do_char, do_byte);
+        for (int tx = 0; tx < sp_tok.size(); ++tx) {
+          int t_len; const AzByte *tok = sp_tok.point(tx, &t_len);
+          ia_id.put(sp_words.put(tok, t_len));
+        }
+      }
+      int t_num = ia_id.size();
+      int sz = AzVarint::size(t_num);
+      for (int tx = 0; tx < t_num; ++tx) sz += AzVarint::size(ia_id[tx]);
+      AzByte *enc = s_enc.reset(sz, 0), *wp = enc;
+      wp = AzVarint::put(t_num, wp);
+      for (int tx = 0; tx < t_num; ++tx) wp = AzVarint::put(ia_id[tx], wp);
+      ofile.writeInt(sz);
+      ofile.writeBytes(enc, sz);
+      tok_num += t_num; enc_bytes += sz;
+    }
+    rdr.close();
+
+    /*---  word list  ---*/
+    tokc.words_offs = ofile.tell();
+    AZint8 words_len = 0;
+    for (int id = 0; id < sp_words.size(); ++id) {
+      int w_len; sp_words.point(id, &w_len); words_len += w_len+1;
+    }
+    AzX::throw_if(!Az64::can_be_int(words_len), eyec, "Too many distinct tokens: ", txt_fn);
+    ofile.writeInt(sp_words.size());
+    ofile.writeInt((int)words_len);
+    unsigned long long cs = 0;
+    for (int id = 0; id < sp_words.size(); ++id) {
+      int w_len; const AzByte *word = sp_words.point(id, &w_len);
+      ofile.writeBytes(word, w_len+1); /* with '\0' */
+      cs = AzDic::hash_next(cs, AzDic::hash_word(word, w_len));
+    }
+    ofile.writeInt8((AZint8)cs);
+    ofile.seek(0);
+    tokc.write_header(&ofile);
+    ofile.close(true);
+
+    AzBytArr s("#doc="); s << tokc.data_num << " #token=" << (double)tok_num << " #word=" << sp_words.size();
+    s << " #byte=" << (double)enc_bytes;
+    AzPrint::writeln(out, s);
+  }
+
+protected:
+  void write_header(AzFile *ofile) const {
+    AzTools::write_header(ofile, version, reserved_len);
+    ofile->writeBool(do_lower); ofile->writeBool(do_utf8dashes);
+    ofile->writeBool(do_char); ofile->writeBool(do_byte);
+    ofile->writeInt(data_num); ofile->writeInt(max_len);
+    ofile->writeInt8(words_offs);
+  }
+  void read_header() {
+    AzTools::read_header(&file, reserved_len);
+    do_lower = file.readBool(); do_utf8dashes = file.readBool();
+    do_char = file.readBool(); do_byte = file.readBool();
+    data_num = file.readInt(); max_len = file.readInt();
+    words_offs = file.readInt8();
+    AzX::throw_if(data_num < 0 || words_offs <= 0, AzInputError, "AzTokCache::read_header",
+                  "Not a token cache: ", file.pointFileName());
+  }
+  void read_words() {
+    const char *eyec = "AzTokCache::read_words";
+    int num = file.readInt(), len = file.readInt();
+    AzX::throw_if(num < 0 || len < num, AzInputError, eyec, "Corrupted word list: ", file.pointFileName());
+    a_words.free_alloc(MAX(1, len), eyec, "words");
+    file.readBytes(a_words.point_u(), len);
+    unsigned long long stored_cs = (unsigned long long)file.readInt8();
+
+    const AzByte *words = a_words.point();
+    ia_woffs.reset(num+1, 0);
+    a_whash.free_alloc(MAX(1, num), eyec, "whash");
+    int *woffs = ia_woffs.point_u();
+    unsigned long long *whash = a_whash.point_u();
+    checksum = 0;
+    int offs = 0;
+    for (int id = 0; id < num; ++id) {
+      const AzByte *nul = (offs < len) ? (const AzByte *)memchr(words+offs, '\0', len-offs) : NULL;
+      AzX::throw_if(nul == NULL, AzInputError, eyec, "Corrupted word list: ", file.pointFileName());
+      int w_len = Az64::ptr_diff(nul-words) - offs;
+      woffs[id] = offs;
+      whash[id] = AzDic::hash_word(words+offs, w_len);
+      checksum = AzDic::hash_next(checksum, whash[id]);
+      offs += w_len+1;
+    }
+    woffs[num] = offs;
+    AzX::throw_if(offs != len || checksum != stored_cs, AzInputError, eyec,
+                  "Checksum mismatch in the word list: ", file.pointFileName());
+  }
+  int decode(const AzByte *doc, int len, AzIntArr &ia_id) const {
+    const char *eyec = "AzTokCache::decode";
+    const AzByte *end = doc+len;
+    unsigned int t_num;
+    doc = AzVarint::get(doc, end, t_num);
+    AzX::throw_if((AZint8)t_num > len, AzInputError, eyec, "Corrupted data");
+    ia_id.reset((int)t_num, -1);
+    int *id = ia_id.point_u();
+    unsigned int w_num = (unsigned int)wordNum();
+    for (unsigned int tx = 0; tx < t_num; ++tx) {
+      unsigned int val;
+      doc = AzVarint::get(doc, end, val);
+      AzX::throw_if(val >= w_num, AzInputError, eyec, "Corrupted data");
+      id[tx] = (int)val;
+    }
+    return (int)t_num;
+  }
+  void to_spans(const AzIntArr &ia_id, AzIntArr &ia_span, AzBaseArr<unsigned long long> &a_hash) const {
+    int t_num = ia_id.size();
+    ia_span.reset(t_num*2, 0);
+    a_hash.free_alloc(MAX(1, t_num));
+    int *span = ia_span.point_u();
+    unsigned long long *tok_hash = a_hash.point_u();
+    const int *woffs = ia_woffs.point();
+    for (int tx = 0; tx < t_num; ++tx) {
+      int id = ia_id[tx];
+      span[tx*2] = woffs[id]; span[tx*2+1] = woffs[id+1]-woffs[id]-1;
+      tok_hash[tx] = a_whash.point()[id];
+    }
+  }
+  void to_strpool(const AzIntArr &ia_id, AzStrPool &sp_tok) const {
+    sp_tok.reset(ia_id.size(), 2);
+    const int *woffs = ia_woffs.point();
+    for (int tx = 0; tx < ia_id.size(); ++tx) {
+      int id = ia_id[tx];
+      sp_tok.put(a_words.point()+woffs[id], woffs[id+1]-woffs[id]-1);
+    }
+  }
+};
+#endif
@@ -67,25 +67,21 @@ void AzTools_text::tokenize(AzByte *data, int inp_len, /* used as work area */
                             bool do_lower, 
                             AzStrPool &sp_tok, 
                             bool do_char, bool do_byte) {
-  int len = inp_len;  
-  if (do_utf8dashes) len = replace_utf8dashes(data, len); 
-  if (do_lower) {
-    AzBytArr s(data, len); s.lwr(); 
-    memcpy(data, s.point(), len); 
+  if (!do_char && !do_byte) {
+    int wavg_len = 5; 
+    sp_tok.reset(inp_len/wavg_len+512, wavg_len*2);  
+    normalize(data, inp_len, do_utf8dashes, do_lower, &sp_tok); 
+    return; 
   }
+  int len = normalize(data, inp_len, do_utf8dashes, do_lower); 
   if (do_char) {
     sp_tok.reset(len, 2); 
     get_utf8chars(data, len, sp_tok); 
   }
-  else if (do_byte) {
+  else {
     sp_tok.reset(len, 2); 
     get_bytes(data, len, sp_tok); 
   }  
-  else {
-    int wavg_len = 5; 
-    sp_tok.reset(len/wavg_len+512, wavg_len*2);  
-    AzTools::getStrings(data, len, &sp_tok); 
-  }
 } 
 
 /*-------------------------------------------------------------------------*/
@@ -96,6 +92,13 @@ void AzTools_text::tokenize(AzByte *buff, int &len,
                        AzIntArr *ia_tokno, /* output */
                        bool do_char, bool do_byte) {                       
   const char *eyec = "AzTools_text::tokenize"; 
+  if (dic != NULL && ia_tokno != NULL && dic->has_hash() && !do_char && !do_byte) {
+    AzIntArr ia_nn; ia_nn.put(nn); 
+    AzDataArr<AzIntArr> aia_tokno; 
+    tokenize(buff, len, dic, ia_nn, do_lower, do_utf8dashes, aia_tokno); 
+    ia_tokno->reset(aia_tokno[0]); 
+    return; 
+  }
   AzStrPool sp_tok; 
   tokenize(buff, len, do_utf8dashes, do_lower, sp_tok, do_char, do_byte); 
   int t_num = sp_tok.size(); 
@@ -113,6 +116,17 @@ int AzTools_text::tokenize(AzByte *buff, int &len,
                        AzDataArr<AzIntArr> &aia_tokno,  /* output */
                        bool do_char, bool do_byte) {
   const char *eyec = "AzTools_text::tokenize(multi n)"; 
+  if (dic != NULL && dic->has_hash() && !do_char && !do_byte) { /* no token strings */
+    AzIntArr ia_span; 
+    normalize(buff, len, do_utf8dashes, do_lower, NULL, &ia_span); 
+    int t_num = ia_span.size()/2; 
+    AzBaseArr<unsigned long long> a_hash(t_num); 
+    unsigned long long *tok_hash = a_hash.point_u(); 
+    for (int tx = 0; tx < t_num; ++tx) tok_hash[tx] = AzDic::hash_word(buff+ia_span[tx*2], ia_span[tx*2+1]); 
+    aia_tokno.reset(ia_nn.size()); 
+    for (int ix = 0; ix < ia_nn.size(); ++ix) identify_tokens(buff, ia_span, tok_hash, ia_nn[ix], dic, aia_tokno(ix)); 
+    return t_num; 
+  }
   AzStrPool sp_tok; 
   tokenize(buff, len, do_utf8dashes, do_lower, sp_tok, do_char, do_byte); 
   int t_num = sp_tok.size(); 
@@ -124,6 +138,104 @@ int AzTools_text::tokenize(AzByte *buff, int &len,
   return t_num; 
 } 
 
+/*-------------------------------------------------------------------------*/
+/* same as identify_tokens(sp_tok, ...) using the hash table of dic; the    */
+/* n-gram hashes are rolled over the token hashes computed only once.       */
+void AzTools_text::identify_tokens(const AzByte *data, 
+                       const AzIntArr &ia_span, /* offset and length of each token */
+                       const unsigned long long *tok_hash, /* hash of each token */
+                       int nn, 
+                       const AzDic *dic, 
+                       AzIntArr *ia_tokno) { /* output */
+  AzX::throw_if_null(dic, ia_tokno, "AzTools_text::identify_tokens(hash)"); 
+  int t_num = ia_span.size()/2; 
+  ia_tokno->reset(t_num, -1); 
+  if (nn <= 0 || t_num < nn) return; 
+  int *tokno = ia_tokno->point_u(); 
+  const int *span = ia_span.point(); 
+  unsigned long long pow = 1, hash = 0; /* pow: the multiplier of the leftmost word */
+  for (int ix = 0; ix < nn; ++ix) {
+    if (ix > 0) pow *= AzDic::hash_mul; 
+    hash = AzDic::hash_next(hash, tok_hash[ix]); 
+  }
+  for (int wx = 0; ; ++wx) {
+    tokno[wx] = dic->find_ngram(data, span+wx*2, nn, hash); 
+    if (wx+nn >= t_num) break; 
+    hash = AzDic::hash_next(hash - tok_hash[wx]*pow, tok_hash[wx+nn]); 
+  }
+}
+
+/*-------------------------------------------------------------------------*/
+/* Same as tokenize(buff, len, dic, ia_nn, ...) but every token or n-gram   */
+/* is mapped to one of 2^hash_bits ids by hashing instead of a vocabulary. */
+/* N-gram hashes are computed from token hashes as AzDic does.             */
+int AzTools_text::tokenize_hashed(AzByte *buff, int &len, int hash_bits, 
+                       AzIntArr &ia_nn, 
+                       bool do_lower, bool do_utf8dashes,                   
+                       AzDataArr<AzIntArr> &aia_tokno,  /* output */
+                       bool do_char, bool do_byte) {
+  AzBaseArr<unsigned long long> a_hash; 
+  int t_num = 0; 
+  if (!do_char && !do_byte) { /* no token strings */
+    AzIntArr ia_span; 
+    normalize(buff, len, do_utf8dashes, do_lower, NULL, &ia_span); 
+    t_num = ia_span.size()/2; 
+    a_hash.alloc(MAX(1, t_num)); 
+    unsigned long long *tok_hash = a_hash.point_u(); 
+    for (int tx = 0; tx < t_num; ++tx) tok_hash[tx] = AzDic::hash_word(buff+ia_span[tx*2], ia_span[tx*2+1]); 
+  }
+  else {
+    AzStrPool sp_tok; 
+    tokenize(buff, len, do_utf8dashes, do_lower, sp_tok, do_char, do_byte); 
+    t_num = sp_tok.size(); 
+    a_hash.alloc(MAX(1, t_num)); 
+    unsigned long long *tok_hash = a_hash.point_u(); 
+    for (int tx = 0; tx < t_num; ++tx) {
+      int t_len; const AzByte *tok = sp_tok.point(tx, &t_len); 
+      tok_hash[tx] = AzDic::hash_word(tok, t_len); 
+    }
+  }
+  aia_tokno.reset(ia_nn.size()); 
+  for (int ix = 0; ix < ia_nn.size(); ++ix) identify_tokens_hashed(t_num, a_hash.point(), ia_nn[ix], hash_bits, aia_tokno(ix)); 
+  return t_num; 
+} 
+
+/*-------------------------------------------------------------------------*/
+void AzTools_text::identify_tokens_hashed(int t_num, 
+                       const unsigned long long *tok_hash, /* hash of each token */
+                       int nn, int hash_bits, 
+                       AzIntArr *ia_tokno) { /* output */
+  AzX::throw_if_null(ia_tokno, "AzTools_text::identify_tokens_hashed"); 
+  ia_tokno->reset(t_num, -1); 
+  if (nn <= 0 || t_num < nn) return; 
+  int *tokno = ia_tokno->point_u(); 
+  unsigned long long mask = (1ULL << hash_bits) - 1; 
+  unsigned long long pow = 1, hash = 0; /* pow: the multiplier of the leftmost word */
+  for (int ix = 0; ix < nn; ++ix) {
+    if (ix > 0) pow *= AzDic::hash_mul; 
+    hash = AzDic::hash_next(hash, tok_hash[ix]); 
+  }
+  for (int wx = 0; ; ++wx) {
+    unsigned long long h = hash; /* mix the bits so that the low bits depend on all the bits */
+    h ^= (h >> 29); h *= 0xBF58476D1CE4E5B9ULL; h ^= (h >> 32); 
+    tokno[wx] = (int)(h & mask); 
+    if (wx+nn >= t_num) break; 
+    hash = AzDic::hash_next(hash - tok_hash[wx]*pow, tok_hash[wx+nn]); 
+  }
+}
+
+/*-------------------------------------------------------------------------*/
+/* Word-mapping for feature hashing: a one-entry signature that records the */
+/* hashing parameters (see AzDic::is_hash_signature) so that the word-mapping */
+/* check of reNet detects the data generated with different parameters.     */
+void AzTools_text::gen_hash_dic(int hash_bits, const AzIntArr &ia_nn, int pch_sz, AzDic &dic) {
+  AzBytArr s("#hash"); s << hash_bits << "n"; 
+  for (int ix = 0; ix < ia_nn.size(); ++ix) { if (ix > 0) s << "-"; s << ia_nn[ix]; }
+  if (pch_sz > 1) s << "p" << pch_sz; 
+  AzStrPool sp; sp.put(&s); 
+  dic.reset(&sp); 
+}
+
 /*-------------------------------------------------------------------------*/
 void AzTools_text::identify_1gram(const AzStrPool *sp_tok, 
                        const AzDic *dic_word, 
@@ -145,6 +257,81 @@ void AzTools_text::identify_ngram(const AzStrPool *sp_tok,
   for (int ix = 0; ix < sp_tok->size(); ++ix) tokno[ix] = dic_word->find_ngram(sp_tok, ix, nn);  
 } 
     
+/*-------------------------------------------------------------------------*/
+inline static void put_token(const AzByte *data, int tok_beg, int tok_end, 
+                             AzStrPool *sp_tok, AzIntArr *ia_span) {
+  if (sp_tok != NULL) sp_tok->put(data+tok_beg, tok_end-tok_beg); 
+  if (ia_span != NULL) { ia_span->put(tok_beg); ia_span->put(tok_end-tok_beg); }
+}
+inline static void put_normalized(AzByte ch, AzByte *data, int &wx, int &tok_beg, 
+                                  bool &do_lower, AzStrPool *sp_tok, AzIntArr *ia_span) {
+  if (do_lower) {
+    if (ch == '\0')                  do_lower = false; /* as AzBytArr::lwr */
+    else if (ch >= 'A' && ch <= 'Z') ch += 'a' - 'A'; 
+  }
+  data[wx] = ch; 
+  if (sp_tok != NULL || ia_span != NULL) {
+    if (ch <= 0x20) { /* delimiter as in AzTools::getStrings */
+      if (tok_beg >= 0) put_token(data, tok_beg, wx, sp_tok, ia_span); 
+      tok_beg = -1; 
+    }
+    else if (tok_beg < 0) tok_beg = wx; 
+  }
+  ++wx; 
+}
+
+/*-------------------------------------------------------------------------*/
+/* In place and in one pass, the same as replace_utf8dashes (if do_utf8dashes), */
+/* then AzBytArr::lwr (if do_lower), then AzTools::getStrings (if sp_tok!=NULL). */
+/* ia_span receives the offset and length of each token in data.                */
+/* The output is never longer than the input.  Return the output length.        */
+int AzTools_text::normalize(AzByte *data, int len, bool do_utf8dashes, bool do_lower, 
+                            AzStrPool *sp_tok,   /* output: may be NULL */
+                            AzIntArr *ia_span) { /* output: may be NULL */
+  if (ia_span != NULL) ia_span->reset(); 
+  int wx = 0, tok_beg = -1; 
+  AzByte prevch = 0; /* the input byte before rx */
+  for (int rx = 0; rx < len; ) {
+    AzByte ch = data[rx]; 
+    if (ch > 0x20 && (ch != 0xE2 || !do_utf8dashes)) { /* a run of ordinary bytes: most of the data */
+      if (tok_beg < 0) tok_beg = wx; 
+      int lwr = (do_lower) ? 'a'-'A' : 0; 
+      for ( ; ; ) {
+        prevch = ch; 
+        data[wx++] = ((AzByte)(ch-'A') < 26) ? ch+lwr : ch; 
+        if (++rx >= len) break; 
+        ch = data[rx]; 
+        if (ch <= 0x20 || ch == 0xE2) break; 
+      }
+      continue; 
+    }
+    if (ch != 0xE2 || rx+3 > len) {
+      prevch = ch; ++rx; 
+      put_normalized(ch, data, wx, tok_beg, do_lower, sp_tok, ia_span); 
+      continue; 
+    }
+    AzByte ch1 = data[rx+1], ch2 = data[rx+2]; 
+    AzByte nextch = (rx+3 < len) ? data[rx+3] : 0; 
+    const char *rep = NULL; 
+    if (ch1 == 0x80) {
+      if      (ch2 == 0x93) rep = (prevch>='0' && prevch<='9' && nextch>='0' && nextch<='9') ? "-" : " - "; 
+      else if (ch2 == 0x94) rep = " - "; 
+      else if (ch2 == 0x98) rep = " ' "; 
+      else if (ch2 == 0x9c || ch2 == 0x9d) rep = " \" "; 
+      else if (ch2 == 0x99) rep = (rx+5 <= len && data[rx+3] == 's' && data[rx+4] == ' ') ? " '" : " ' "; 
+    }
+    prevch = ch2; rx += 3; /* all the input bytes needed are read before writing */
+    if (rep == NULL) {
+      put_normalized(ch, data, wx, tok_beg, do_lower, sp_tok, ia_span); 
+      put_normalized(ch1, data, wx, tok_beg, do_lower, sp_tok, ia_span); 
+      put_normalized(ch2, data, wx, tok_beg, do_lower, sp_tok, ia_span); 
+    }
+    else for ( ; *rep != '\0'; ++rep) put_normalized((AzByte)*rep, data, wx, tok_beg, do_lower, sp_tok, ia_span); 
+  }
+  if (tok_beg >= 0) put_token(data, tok_beg, wx, sp_tok, ia_span); 
+  return wx; 
+}
+
 /*-------------------------------------------------------------------------*/
 int AzTools_text::replace_utf8dashes(AzByte *data, int len) { /* inout */
   const char *eyec = "AzTools_text:;replace_utf8dashes"; 
@@ -203,6 +390,14 @@ int AzTools_text::replace_utf8dashes(AzByte *data, int len) { /* inout */
   return mydata_len; 
 }
 
+/*-------------------------------------------------------------------------*/
+void AzTools_text::read_file_list(const char *inp_fn, AzStrPool *sp_list) {
+  AzX::throw_if_null(sp_list, "AzTools_text::read_file_list"); 
+  sp_list->reset(); 
+  if (AzBytArr::endsWith(inp_fn, ".lst")) AzTools::readList(inp_fn, sp_list); 
+  else                                    sp_list->put(inp_fn); 
+}
+
 /*-------------------------------------------------------------------------*/
 int AzTools_text::scan_files_in_list(const char *inp_fn, 
                                      const char *ext, 
@@ -211,18 +406,17 @@ int AzTools_text::scan_files_in_list(const char *inp_fn,
                                      AzStrPool *out_sp_list, /* may be NULL */
                                      AzIntArr *ia_data_num) { /* may be NULL; number of docs in each file */
   AzStrPool sp_list; 
-  if (AzBytArr::endsWith(inp_fn, ".lst")) AzTools::readList(inp_fn, &sp_list); 
-  else                                    sp_list.put(inp_fn); 
+  read_file_list(inp_fn, &sp_list); 
   if (ia_data_num != NULL) ia_data_num->reset(); 
   int buff_size = 0; 
   for (int fx = 0; fx < sp_list.size(); ++fx) {
     AzBytArr s(sp_list.c_str(fx)); s.c(ext); 
     const char *fn = s.c_str(); 
     AzTimeLog::print("scanning ", fn, out); 
-    AzIntArr ia_data_len; 
-    AzFile::scan(fn, 1024*1024*100, &ia_data_len); 
-    buff_size = MAX(buff_size, ia_data_len.max()); 
-    if (ia_data_num != NULL) ia_data_num->put(ia_data_len.size()); 
+    int max_len = 0; 
+    int num = AzTextReader::count_lines(fn, &max_len); 
+    buff_size = MAX(buff_size, max_len); 
+    if (ia_data_num != NULL) ia_data_num->put(num); 
   }  
   if (out_sp_list != NULL) out_sp_list->reset(&sp_list); 
   return buff_size; 
@@ -257,6 +451,53 @@ void AzTools_text::feat_to_text(const AzSvect *v_feat,
 
 
 /*-------------------------------------------------------------------------*/
+/*---  count_words_get_cats: count the n-grams of the documents [dx_beg, dx_end) of a batch  ---*/
+/* The counts are written to the columns of m_count given by the data#'s, */
+/* which are different for different threads.                             */
+class AzTools_text_count_thread : public virtual AzThread_ {
+protected:
+  const AzDic *dic; 
+  AzIntArr ia_nn; 
+  bool do_lower, do_utf8dashes; 
+  int unk_idx; 
+  AzSmat *m_count; 
+  AzPrepText_docs *docs; 
+  int dx_beg, dx_end; 
+public:
+  AzTools_text_count_thread() : dic(NULL), do_lower(false), do_utf8dashes(false), unk_idx(-1), m_count(NULL), 
+                                docs(NULL), dx_beg(0), dx_end(0) {}
+  void reset(const AzDic *_dic, int max_nn, bool _do_lower, bool _do_utf8dashes, int _unk_idx, AzSmat *_m_count) {
+    dic = _dic; do_lower = _do_lower; do_utf8dashes = _do_utf8dashes; unk_idx = _unk_idx; m_count = _m_count; 
+    ia_nn.reset(); for (int nn = 1; nn <= max_nn; ++nn) ia_nn.put(nn); 
+  }
+  void reset_docs(AzPrepText_docs *_docs, int _dx_beg, int _dx_end) {
+    docs = _docs; dx_beg = _dx_beg; dx_end = _dx_end; 
+  }
+  void run() {
+    for (int dx = dx_beg; dx < dx_end; ++dx) {
+      int data_no = docs->no(dx), len = 0; 
+      AzByte *buff = docs->point_u(dx, &len); 
+      AzDataArr<AzIntArr> aia_tokno; 
+      int t_num = AzTools_text::tokenize(buff, len, dic, ia_nn, do_lower, do_utf8dashes, aia_tokno); 
+      int unk = 0; 
+      AzIFarr ifa_count; 
+      for (int ix = 0; ix < t_num; ++ix) {
+        for (int nx = 0; nx < ia_nn.size(); ++nx) {
+          int id = (*aia_tokno[nx])[ix], nn = ia_nn[nx]; 
+          if (id >= 0) ifa_count.put(id, 1); 
+          else if (t_num-ix >= nn) ++unk; 
+        }
+      }
+      ifa_count.squeeze_Sum(); 
+      m_count->col_u(data_no)->load(&ifa_count);      
+      if (unk_idx >= 0 && unk != 0) m_count->set(unk_idx, data_no, unk); 
+    }
+  }
+}; 
+
+/*-------------------------------------------------------------------------*/
+/* Documents are read in batches of bounded size and counted in parallel. */
+/* Call dic.build_hash() in advance for speed.                            */
 void AzTools_text::count_words_get_cats(const AzOut &out, bool do_ignore_bad, 
                             bool do_count_unk, 
                             const char *fn, const char *txt_ext, const char *cat_ext, 
@@ -265,27 +506,29 @@ void AzTools_text::count_words_get_cats(const AzOut &out, bool do_ignore_bad,
                             bool do_allow_multi, bool do_allow_nocat, 
                             bool do_lower, bool do_utf8dashes, 
                             AzSmat *m_count, AzSmat *m_cat, 
-                            bool do_no_cat) {                             
+                            bool do_no_cat, int thr_num) {                             
   const char *eyec = "AzTools_text::count_words_get_cats"; 
   AzX::throw_if_null(m_count, m_cat, eyec);   
   if (do_no_cat) {
     AzTimeLog::print("Don't read cats",  out); 
   }
-  /*---  scan training data files to determine buffer size and #data  ---*/
+  /*---  no scan: #data is counted while reading  ---*/
   AzStrPool sp_list; 
-  AzIntArr ia_num; 
-  int buff_size = scan_files_in_list(fn, txt_ext, out, &sp_list, &ia_num); 
-  int data_num = ia_num.sum(); 
+  read_file_list(fn, &sp_list); 
   
   /*---  read training data  ---*/
-  m_cat->reform(dic_cat.size(), data_num);   
+  int ini_num = 1024; /* #column grows as needed */
+  m_cat->reform(dic_cat.size(), ini_num);   
   int unk_idx = (do_count_unk) ? dic.size() : -1; 
-  if (do_count_unk) m_count->reform(dic.size()+1, data_num); 
-  else        m_count->reform(dic.size(), data_num); 
+  if (do_count_unk) m_count->reform(dic.size()+1, ini_num); 
+  else        m_count->reform(dic.size(), ini_num); 
+  
+  thr_num = MAX(1, thr_num); 
+  AzDataArr<AzTools_text_count_thread> thrs(thr_num); 
+  for (int tx = 0; tx < thr_num; ++tx) thrs(tx)->reset(&dic, max_nn, do_lower, do_utf8dashes, unk_idx, m_count); 
+  int batch_size = AzPrepText_docs::batch_size(thr_num); 
+  AzPrepText_docs docs; docs.reset(batch_size); 
   
-  buff_size += 256; 
-  AzBytArr s_buff; 
-  AzByte *buff = s_buff.reset(buff_size, 0); 
   int no_cat = 0, multi_cat = 0; 
   int data_no = 0; 
   for (int fx = 0; fx < sp_list.size(); ++fx) { /* for ecah file */
@@ -298,12 +541,16 @@ void AzTools_text::count_words_get_cats(const AzOut &out, bool do_ignore_bad,
     }
 
     AzTimeLog::print(fn, out);   
-    AzFile file(fn); 
-    file.open("rb"); 
+    AzTextReader rdr; 
+    rdr.open(fn); 
     int num_in_file = 0; 
     for ( ; ; ++num_in_file) {  /* for each document */
-      int len = file.gets(buff, buff_size); 
+      AzByte *buff = NULL; 
+      int len = rdr.next(buff); 
       if (len <= 0) break; 
+      if (data_no >= m_count->colNum()) {
+        m_cat->resize(data_no*2); m_count->resize(data_no*2); 
+      }
 
       /*---  categories  ---*/      
       if (!do_no_cat) {
@@ -321,26 +568,15 @@ void AzTools_text::count_words_get_cats(const AzOut &out, bool do_ignore_bad,
         else  m_cat->col_u(data_no)->load(&ia_cats, 1);                               
       }
            
-      /*---  text  ---*/
-      int unk = 0; 
-      AzStrPool sp_tok;               
-      AzTools_text::tokenize(buff, len, do_utf8dashes, do_lower, sp_tok); 
-      AzIFarr ifa_count;  
-      for (int ix = 0; ix < sp_tok.size(); ++ix) {   
-        for (int nn = 1; nn <= max_nn; ++nn) {
-          int id = dic.find_ngram(&sp_tok, ix, nn);  
-          if (id >= 0) ifa_count.put(id, 1); 
-          else if (sp_tok.size()-ix >= nn) ++unk; 
-        }
-      }
-      ifa_count.squeeze_Sum(); 
-      m_count->col_u(data_no)->load(&ifa_count);      
-      if (unk_idx >= 0 && unk != 0) m_count->set(unk_idx, data_no, unk); 
+      /*---  text: keep it in the batch  ---*/
+      docs.put(buff, len, data_no); 
       ++data_no;
+      if (docs.bytes() >= batch_size) { docs.run(thrs); docs.clear(); }
     } /* for each doc */
     AzX::throw_if (!do_no_cat && num_in_file != sp_cat.size(), 
                    AzInputError, eyec, "#data mismatch2: btw text file and cat file"); 
   } /* for each file */
+  docs.run(thrs); docs.clear(); 
   m_cat->resize(data_no); 
   m_count->resize(data_no); 
 }
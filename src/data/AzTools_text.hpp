@@ -23,6 +23,8 @@
 #include "AzSmat.hpp"
 #include "AzStrPool.hpp" 
 #include "AzDic.hpp"
+#include "AzTextReader.hpp"
+#include "AzThreads.hpp"
 
 #define kw_do_allow_multi "MultiLabel"
 #define kw_do_allow_nocat kw_do_allow_multi 
@@ -33,6 +35,7 @@ public:
                                 /*---  output  ---*/
                                 AzStrPool *out_sp_list, /* may be NULL */
                                 AzIntArr *ia_data_num); /* may be NULL; number of docs in each file */   
+  static void read_file_list(const char *inp_fn, AzStrPool *sp_list); /* no scan */
   static void tokenize(AzByte *data, int inp_len, /* used as work area */
                 bool do_utf8dashes, bool do_lower, 
                 AzStrPool &sp_tok, bool do_char=false, bool do_byte=false); 
@@ -42,7 +45,19 @@ public:
   static int tokenize(AzByte *buff, int &len, const AzDic *dic, AzIntArr &ia_nn, 
                        bool do_lower, bool do_utf8dashes,                   
                        AzDataArr<AzIntArr> &aia_tokno, bool do_char=false, bool do_byte=false); 
+  /*---  feature hashing: token or n-gram id is its hash mod 2^hash_bits; no unknown tokens  ---*/
+  static int tokenize_hashed(AzByte *buff, int &len, int hash_bits, AzIntArr &ia_nn, 
+                       bool do_lower, bool do_utf8dashes,                   
+                       AzDataArr<AzIntArr> &aia_tokno, bool do_char=false, bool do_byte=false); 
+  static void identify_tokens_hashed(int t_num, const unsigned long long *tok_hash, int nn, int hash_bits, 
+                                     AzIntArr *ia_tokno); 
+  static void gen_hash_dic(int hash_bits, const AzIntArr &ia_nn, int pch_sz, AzDic &dic); 
   static int replace_utf8dashes(AzByte *data, int len); 
+  static int normalize(AzByte *data, int len, bool do_utf8dashes, bool do_lower, 
+                       AzStrPool *sp_tok=NULL, AzIntArr *ia_span=NULL); /* may be NULL */
+  static void identify_tokens(const AzByte *data, const AzIntArr &ia_span, 
+                              const unsigned long long *tok_hash, int nn, const AzDic *dic, 
+                              AzIntArr *ia_tokno); 
 
   static void identify_tokens(const AzStrPool *sp_tok, int nn, const AzDic *dic, 
                               AzIntArr *ia_tokno) {
@@ -71,7 +86,7 @@ public:
                             bool do_allow_multi, bool do_allow_nocat, 
                             bool do_lower, bool do_utf8dashes, 
                             AzSmat *m_count, AzSmat *m_cat, 
-                            bool do_no_cat=false); 
+                            bool do_no_cat=false, int thr_num=1); 
   static void parse_cats(const AzBytArr *s_cat, 
                          AzByte dlm,  /* e.g., | for, e.g., GSPO|M11|M12 */
                          bool do_allow_multicat, bool do_allow_nocat, 
@@ -98,4 +113,68 @@ protected:
                           int &multi_cat, /* inout */
                           int &no_cat); /* inout */                            
 }; 
+
+/*-------------------------------------------------------------------------*/
+#define AzPrepText_batch_size (1024*1024*16) /* bytes of text to be processed at once per thread */
+
+/*---  documents kept in one buffer to be processed in parallel  ---*/
+/* Each document is tagged with a number such as the data#.  It is writable in */
+/* place (e.g., by tokenization), and different threads can work on different */
+/* documents.  The memory is kept for reuse when cleared.                      */
+class AzPrepText_docs {
+protected:
+  AzBaseArr<AzByte> a_buff; 
+  int len; 
+  AzIntArr ia_offs, ia_no; 
+public:
+  AzPrepText_docs() : len(0) {}
+  static int batch_size(int thr_num) { /* bytes of a batch; capped so that many threads cannot overflow */
+    return (int)MIN((AZint8)AzPrepText_batch_size*MAX(1, thr_num), (AZint8)AzSigned32Max/4); 
+  }
+  void reset(int buff_size) {
+    a_buff.free_alloc(buff_size, "AzPrepText_docs::reset", "buff"); 
+    clear(); 
+  }
+  void clear() { len = 0; ia_offs.reset(); ia_no.reset(); }
+  void put(const AzByte *doc, int doc_len, int no) {
+    const char *eyec = "AzPrepText_docs::put"; 
+    if ((AZint8)len + doc_len > a_buff.size()) { /* a long document */
+      AzX::throw_if((AZint8)len + doc_len > AzSigned32Max/2, eyec, "Too large a batch"); 
+      a_buff.realloc((int)MIN((AZint8)MAX(a_buff.size()*2, len+doc_len), (AZint8)AzSigned32Max/2), eyec, "buff"); 
+    }
+    memcpy(a_buff.point_u()+len, doc, doc_len); 
+    ia_offs.put(len); ia_no.put(no); 
+    len += doc_len; 
+  }
+  int size() const { return ia_no.size(); }
+  int bytes() const { return len; }
+  int no(int dx) const { return ia_no[dx]; }
+  AzByte *point_u(int dx, int *doc_len) {
+    int offs = ia_offs[dx]; 
+    *doc_len = ((dx+1 < ia_offs.size()) ? ia_offs[dx+1] : len) - offs; 
+    return a_buff.point_u() + offs; 
+  }
+  /*---  split into at most num chunks of about the same size: [ia_beg[tx], ia_beg[tx+1])  ---*/
+  int split(int num, AzIntArr &ia_beg) const {
+    num = MIN(num, size()); 
+    ia_beg.reset(); ia_beg.put(0); 
+    for (int tx = 0, dx = 0; tx < num; ++tx) {
+      AZint8 target = (AZint8)len*(tx+1)/num; 
+      for (++dx; dx < size() && ia_offs[dx] < target; ++dx); 
+      if (tx == num-1) dx = size(); 
+      dx = MIN(dx, size() - (num-1-tx)); /* at least one document for each chunk */
+      ia_beg.put(dx); 
+    }
+    return num; 
+  }
+  /*---  run T::reset_docs(docs, dx_beg, dx_end) and T::run() on the chunks in parallel  ---*/
+  template <class T> /* T: derived from AzThread_ */
+  int run(AzDataArr<T> &thrs) {
+    AzIntArr ia_beg; 
+    int num = split(thrs.size(), ia_beg); 
+    for (int tx = 0; tx < num; ++tx) thrs(tx)->reset_docs(this, ia_beg[tx], ia_beg[tx+1]); 
+    AzThreads::run(thrs, num); 
+    return num; 
+  }
+}; 
 #endif 
@@ -3,7 +3,7 @@
 #include "AzPrepText.hpp"
 
 void help() {
-  cout << "action:  gen_vocab | gen_regions | gen_regions_unsup | gen_regions_parsup | merge_vocab | split_text | adapt_word_vectors | gen_nbw | gen_nbwfeat | gen_b_feat" << endl;
+  cout << "action:  gen_vocab | gen_regions | gen_regions_unsup | gen_regions_parsup | merge_vocab | split_text | adapt_word_vectors | gen_nbw | gen_nbwfeat | gen_b_feat | compress_regions | tokenize_corpus | sort_vocab" << endl;
   cout << endl; 
   cout << "Enter, for example, \"prepText gen_vocab\" to print help for a specific action." << endl; 
 }
@@ -38,6 +38,9 @@ int main(int argc, const char *argv[]) {
     else if (strcmp(action, "merge_vocab") == 0)  prep.merge_vocab(argc-oo, argv+oo);  
     else if (strcmp(action, "adapt_word_vectors") == 0) prep.adapt_word_vectors(argc-oo, argv+oo);     
     else if (strcmp(action, "write_wv_word_mapping") == 0) prep.write_wv_word_mapping(argc-oo, argv+oo);     
+    else if (strcmp(action, "compress_regions") == 0) prep.compress_regions(argc-oo, argv+oo);     
+    else if (strcmp(action, "tokenize_corpus") == 0)  prep.tokenize_corpus(argc-oo, argv+oo);
+    else if (strcmp(action, "sort_vocab") == 0)   prep.sort_vocab(argc-oo, argv+oo);     
     else {
       help(); 
       return -1; 
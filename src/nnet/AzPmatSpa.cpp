@@ -278,6 +278,36 @@ template void AzPmatSpa::set<AzSmatc>(const AzSmatc *, const int *, int, bool);
 template void AzPmatSpa::set<AzSmat>(const AzSmat *, const int *, int, bool); 
 template void AzPmatSpa::set<AzSmatbc>(const AzSmatbc *, const int *, int, bool); 
 
+/*------------------------------------------------*/
+/* set binary columns generated on the fly (e.g., regions) without going through AzSmatbc */
+void AzPmatSpa::set(const Az_bc &bc, 
+                    int r_num, 
+                    bool do_gen_row_index)
+{
+  const char *eyec = "AzPmatSpa::set(bc,#row)"; 
+  reform(r_num, bc.colNum()); 
+  const AzIntArr &ia_ptrs = bc.be(), &ia_rows = bc.valarr(); 
+  int nz_num = ia_rows.size(); 
+  AzX::throw_if((ia_ptrs.size() != col_num+1 || ia_ptrs[col_num] != nz_num), eyec, "inconsistent columns"); 
+  AzFloat *hvals = NULL; 
+  AzBaseArray<AzFloat> _hvals(nz_num, &hvals);   
+  for (int ix = 0; ix < nz_num; ++ix) hvals[ix] = 1; 
+  AzIntArr ia_cols(nz_num, -1); /* for addition and multiplication */
+  
+  bool do_iifa = (do_gen_row_index && !f.do_cu_x); 
+  AzIIFarr iifa; 
+  if (do_iifa) iifa.prepare(nz_num); 
+  const int *ptrs = ia_ptrs.point(), *rows = ia_rows.point(); 
+  int *cols = ia_cols.point_u(); 
+  for (int col = 0; col < col_num; ++col) {
+    for (int ix = ptrs[col]; ix < ptrs[col+1]; ++ix) {
+      cols[ix] = col; 
+      if (do_iifa) iifa.put(rows[ix], col, 1); 
+    }
+  }
+  _set_csc_csr(hvals, nz_num, ia_ptrs, ia_rows, ia_cols, do_gen_row_index, iifa); 
+}
+
 /*------------------------------------------------*/
 void AzPmatSpa::_set_csc_csr(const AzFloat *hvals, int nz_num, 
                               const AzIntArr &ia_ptrs, const AzIntArr &ia_rows, const AzIntArr &ia_cols, 
@@ -466,6 +496,21 @@ template void AzPmatSpaVar::set<AzSmatcVar>(const AzSmatcVar *, const int *, int
 template void AzPmatSpaVar::set<AzSmatVar>(const AzSmatVar *, const int *, int, bool); 
 template void AzPmatSpaVar::set<AzSmatbcVar>(const AzSmatbcVar *, const int *, int, bool); 
 
+/*------------------------------------------------*/
+void AzPmatSpaVar::set(const Az_bc &bc, 
+                       int r_num, 
+                       const AzIntArr &_ia_dcolind, /* column range of data points in bc */
+                       bool do_gen_rowindex)
+{
+  const char *eyec = "AzPmatSpaVar::set(bc,#row,dcolind)"; 
+  AzX::throw_if((_ia_dcolind.size() % 2 != 0), eyec, "#dcolind must be even"); 
+  data_num = _ia_dcolind.size() / 2; 
+  ia_dcolind.reset(&_ia_dcolind); 
+  m.set(bc, r_num, do_gen_rowindex); 
+  pia_dcolind.reset(&ia_dcolind); 
+  if (__doDebug) check_data_consistency(eyec); 
+}
+
 /*------------------------------------------------*/
 void AzPmatSpaVar::check_data_consistency(const char *eyec)
 {
@@ -125,6 +125,7 @@ public:
   void set(const AzDataArr<AzIFarr> &aifa, int r_num, 
            const AzIntArr *ia_row_old2new, /* may be NULL */
            const int *cxs, int cxs_num, bool do_gen_row_index); 
+  void set(const Az_bc &bc, int r_num, bool do_gen_row_index); /* binary; columns generated on the fly */
   
   template <class M> /* M: AzSmatc | AzSmat */
   void set(const M *ms, bool do_gen_row_index) {
@@ -229,6 +230,7 @@ public:
     AzIntArr ia_dxs; ia_dxs.range(0, msv.dataNum()); 
     set(&msv, ia_dxs.point(), ia_dxs.size(), do_gen_rowindex); 
   }  
+  void set(const Az_bc &bc, int r_num, const AzIntArr &_ia_dcolind, bool do_gen_rowindex); /* without copying to AzSmatbcVar */
   void set(const AzPmatSpa &_m) { /* regard one column as one data point */
     m.set(&_m);  
     data_num = m.colNum(); 
@@ -23,6 +23,7 @@
 #include "AzpData_imgbin.hpp"
 #include "AzpData_sparse.hpp"
 #include "AzpData_sparse_multi.hpp"
+#include "AzpData_text.hpp"
 
 class AzpDataSetDflt : public virtual AzpDataSet_ {
 protected: 
@@ -37,12 +38,15 @@ protected:
   AzpData_sparse_multi<AzSmatc,AzSmatbc> sparse_multi_no_bc; 
   AzpData_sparse_multi<AzSmatbc,AzSmatc> sparse_multi_bc_no; 
   AzpData_sparse_multi<AzSmatbc,AzSmatbc> sparse_multi_bc_bc;  
+
+  AzpData_text text; /* raw text for prediction; regions are generated in memory */
 public:   
   virtual void printHelp(AzHelp &h, bool do_train, bool do_test, bool is_there_y) const {
     AzpDataSet_::printHelp(h, do_train, do_test, is_there_y); 
-    h.item_required(kw_datatype, "Dataset type.  \"sparse\" | \"img\" | \"imgbin\". "); 
+    h.item_required(kw_datatype, "Dataset type.  \"sparse\" | \"img\" | \"imgbin\" | \"text\" (prediction only). "); 
     /* img.printHelp(h, do_train, is_there_y); */
     sparse_no_no.printHelp(h, is_there_y); 
+    if (!do_train) text.printHelp_data(h); 
     /* sparse_multi.printHelp(h, do_train, is_there_y); */
   }  
 protected:   
@@ -53,6 +57,7 @@ protected:
     azp.vStr(s_kw.c_str(), &s_dataext, s_kw_old.c_str()); 
     if      (s_typ.compare("image") == 0)    return &img; 
     else if (s_typ.compare("imagebin") == 0) return &imgbin;    
+    else if (s_typ.compare("text") == 0)     return &text; 
     else if (s_typ.compare("sparse_multi") == 0 || s_dataext.length() > 0) {
       if (s_x_ext.contains("bc")) {
         if (s_y_ext.contains("bc")) return &sparse_multi_bc_bc; 
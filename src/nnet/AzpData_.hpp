@@ -230,6 +230,12 @@ public:
   virtual void next_batch() = 0; 
   virtual void release_batch() = 0; 
   virtual int batchNum() const { return batch_num; }
+  /*---  to skip batches without loading them, e.g., to resume prediction  ---*/
+  virtual int batchDataNum(int bx) const { return -1; } /* #data in batch#bx; -1 if unknown */
+  virtual void goto_batch(int bx) { /* make batch#bx current */
+    first_batch(); 
+    for (int ix = 0; ix < bx; ++ix) next_batch(); 
+  }
   virtual int dataNum_total() const = 0; 
   virtual bool is_vg_x() const = 0;
   virtual bool is_vg_y() const { return false; }
@@ -312,6 +318,8 @@ public:
     arr.reset(datasetNum()); 
     for (int dx = 0; dx < arr.size(); ++dx) gen_data(dxs, d_num, arr(dx), dx); 
   }
+  /*---  start generating the data of the next minibatch in the background if supported  ---*/
+  virtual void prefetch(const int *dxs, int d_num) const {}
   virtual void gen_data(const int *dxs, int d_num, AzSmatVar &msv_data, int dsno=0) const {
     AzX::no_support(true, "AzpData_::gen_data(smatvar)", "sparse variable-sized data in host memory");  
   }
@@ -20,6 +20,8 @@
 #define _AZP_DATA_SPARSE_HPP_
 
 #include "AzpData_.hpp"
+#include "AzThreads.hpp"
+#include "AzSmatbcVarz.hpp"
 
 /*---  sparse variable-sized/fixed-sized data  ---*/
 /***
@@ -35,6 +37,8 @@ protected:
 
   AzDicc dic;   
   AzMatVar<Mat> msv_x; 
+  AzSmatbcVarz msvz_x; /* msv_x compressed in memory (msv_x is then empty) */
+  bool do_compress_x; 
   Mat ms_x; 
   AzDmatc md_y; 
   MatY ms_y; 
@@ -44,6 +48,7 @@ protected:
 
   int current_batch, released_batch; 
   int total_data_num; 
+  AzIntArr ia_batch_pop; /* #data in each batch */
   bool is_spa_y, is_var_x, is_var_y; 
   
   AzStrPool sp_x_ext, sp_y_ext; 
@@ -51,8 +56,9 @@ protected:
  
   virtual AzpData_ *clone_nocopy() const { return new AzpData_sparse(); }   
 
-  /*---  For on-the-fly region generation (experimental and slow)  ---*/
-  int psz, pstep, padding; 
+  /*---  For on-the-fly region generation  ---*/
+  int psz, pstep, padding, thr_num; 
+  int voc_sz; /* #rows per position: the word-mapping size, or 2^k with feature hashing */
   AzIntArr _ia_nn, *ia_nn; 
   bool do_nobow; 
   bool do_gen_regions() const { return (psz > 1 || pstep > 1 || padding > 0); }
@@ -61,8 +67,8 @@ protected:
 public:
   AzpData_sparse() : current_batch(-1), data_num(0), rnum(0), cnum(0), total_data_num(0), is_spa_y(false), is_var_x(false), is_var_y(false), 
                      dummy_ydim(-1), min_tar(1e+10), max_tar(-1e+10), dsno(-1),
-                     do_allow_diffidx(false), do_dense_y(false), released_batch(-1), 
-                     ia_nn(NULL), psz(-1), pstep(1), padding(0), do_nobow(false) {                        
+                     do_allow_diffidx(false), do_dense_y(false), released_batch(-1), do_compress_x(false), 
+                     ia_nn(NULL), psz(-1), pstep(1), padding(0), thr_num(1), voc_sz(0), do_nobow(false) {                        
     sp_x_ext.put(AzpData_Ext_xsmatbc, AzpData_Ext_xsmatbcvar, AzpData_Ext_xsmatcvar, AzpData_Ext_x); /* cvar for seq2-bown */
     sp_y_ext.put(AzpData_Ext_ysmatbc, AzpData_Ext_ysmatbcvar, AzpData_Ext_ysmatcvar, AzpData_Ext_y, AzpData_Ext_ysmatc);     
   }
@@ -86,14 +92,17 @@ public:
   } 
   #define kw_do_allow_diffidx "AllowDifferentIndexes"
   #define kw_do_dense_y "DenseY"
+  #define kw_do_compress_x "CompressX"
   #define kw_psz "patch_size="
   #define kw_pstep "patch_stride="
   #define kw_padding "padding="
   #define kw_do_bow "Bow"
   #define kw_do_nobow "Seq"
+  #define kw_gr_thr_num "thread_num="
   virtual void resetParam_data(AzParam &azp) {
     const char *eyec = "AzpData_sparse::resetParam_data"; 
     azp.swOn(&do_allow_diffidx, kw_do_allow_diffidx); 
+    azp.swOn(&do_compress_x, kw_do_compress_x); 
     AzXi::check_input(s_x_ext, &sp_x_ext, eyec, kw_x_ext); 
     if (s_y_ext.length() > 0) AzXi::check_input(s_y_ext, &sp_y_ext, eyec, kw_y_ext);        
     is_var_x = is_var_ext(s_x_ext); 
@@ -113,6 +122,7 @@ public:
     azp.reset_prefix(s_pfx.c_str()); 
     azp.vInt(kw_psz, &psz); azp.vInt(kw_pstep, &pstep); azp.vInt(kw_padding, &padding); 
     azp.swOn(&do_nobow, kw_do_nobow); 
+    azp.vInt(kw_gr_thr_num, &thr_num); 
     azp.reset_prefix();
     if (do_gen_regions()) {
       AzX::throw_if(!msv_x.data()->is_bc(), eyec, 
@@ -120,13 +130,19 @@ public:
       AzXi::throw_if_nonpositive(psz, eyec, kw_psz); 
       AzXi::throw_if_nonpositive(pstep, eyec, kw_pstep);       
       AzXi::throw_if_negative(padding, eyec, kw_padding);       
+      AzXi::throw_if_nonpositive(thr_num, eyec, kw_gr_thr_num); 
     }    
+    if (do_compress_x) {
+      AzX::throw_if(!is_var_x || !msv_x.data()->is_bc(), AzInputError, eyec, kw_do_compress_x, " requires *.xsmatbcvar."); 
+      AzX::no_support(do_gen_regions(), eyec, kw_do_compress_x " with on-the-fly region generation"); 
+    }
   }
   virtual void printParam_data(const AzOut &out, const char *pfx) const {
     AzPrint o(out, pfx); 
     if (dsno <= 0) { /* to avoid printing the same parameters repeatedly. */
       o.printSw(kw_do_allow_diffidx, do_allow_diffidx); 
       o.printSw(kw_do_dense_y, do_dense_y); 
+      o.printSw(kw_do_compress_x, do_compress_x); 
     }
     if (do_gen_regions()) {
       AzBytArr s_pfx; pfx_for_gen_regions(s_pfx); 
@@ -134,6 +150,7 @@ public:
       o.printV(kw_psz, psz); o.printV(kw_pstep, pstep); o.printV(kw_padding, padding); 
       if (do_nobow) o.printSw(kw_do_nobow, do_nobow); 
       else          o.printSw(kw_do_bow, !do_nobow);       
+      o.printV(kw_gr_thr_num, thr_num); 
       o.reset_prefix(); 
     }
     o.printEnd(); 
@@ -143,25 +160,33 @@ public:
   virtual int ydim() const { return (is_var_y) ? msv_y.rowNum() : ((is_spa_y) ? ms_y.rowNum() : md_y.rowNum()); }
   virtual int dataNum_total() const { return total_data_num; }
   virtual void destroy() {
+    cancel_prefetch(); 
     AzpData_::destroy(); 
     msv_x.destroy(); 
+    msvz_x.destroy(); 
     ms_x.destroy(); 
     md_y.destroy(); 
     ms_y.destroy(); 
     msv_y.destroy(); 
     total_data_num = data_num = rnum = cnum = 0; 
+    ia_batch_pop.reset(); 
     current_batch = -1; 
   }
   virtual int dataNum() const { return data_num; }
   virtual int colNum() const { return cnum; }
   virtual int colNum(int dx) const {
     AzX::throw_if(dx < 0 || dx >= dataNum(), "AzpData_sparse::colNum(dx)", "index is out of range"); 
+    if (do_compress_x) return msvz_x.get_end(dx) - msvz_x.get_begin(dx); 
     if (is_var_x) return msv_x.get_end(dx) - msv_x.get_begin(dx); 
     else          return 1;       
   }
   virtual const AzIntArr *dataIndex(int dsno=0) const { 
     const char *eyec = "AzpData_sparse::dataIndex"; 
     AzX::throw_if(dsno != 0, eyec, "Invalid dsno"); 
+    if (do_compress_x) {
+      AzX::throw_if(msvz_x.dataNum() <= 0, eyec, "No data");  
+      return msvz_x.index(); 
+    }
     AzX::throw_if(msv_x.dataNum() <= 0, eyec, "No data");  
     return msv_x.index(); 
   }
@@ -177,8 +202,13 @@ public:
     AzX::throw_if((dsno != 0), eyec, "dsno<>0?!"); 
     AzX::throw_if(!is_vg_x(), eyec, "Not spavar");   
     bool do_gen_rowindex = true;     
-    if (do_gen_regions()) gen_regions(dxs, d_num, *m_data, do_gen_rowindex); 
-    else                  m_data->set(&msv_x, dxs, d_num, do_gen_rowindex);    
+    if      (do_gen_regions()) gen_regions(dxs, d_num, *m_data, do_gen_rowindex); 
+    else if (do_compress_x) {
+      Az_bc bc; AzIntArr ia_dcolind; 
+      msvz_x.decode(dxs, d_num, bc, ia_dcolind); bc.commit(); 
+      m_data->set(bc, msvz_x.rowNum(), ia_dcolind, do_gen_rowindex); 
+    }
+    else                       m_data->set(&msv_x, dxs, d_num, do_gen_rowindex);    
   }
 
   /*---  sparse features  ---*/
@@ -193,8 +223,17 @@ public:
     const char *eyec = "AzpData_sparse::gen_data(dxs,num,spavar)"; 
     AzX::throw_if((dsno != 0), eyec, "dsno<>0?!"); 
     AzX::throw_if(!is_vg_x(), eyec, "Not spavar");    
+    AzSmat ms; 
+    if (do_compress_x) {
+      Az_bc bc; AzIntArr ia_dcolind; 
+      msvz_x.decode(dxs, d_num, bc, ia_dcolind); bc.commit(); 
+      AzSmatbc mbc; mbc.reform(msvz_x.rowNum(), bc.colNum()); mbc.set(bc.valarr(), bc.be()); 
+      mbc.copy_to_smat(&ms); 
+      msv_data.set(&ms, &ia_dcolind); 
+      return; 
+    }
     AzMatVar<Mat> msv; msv.set(&msv_x, dxs, d_num); 
-    AzSmat ms; msv.data()->copy_to_smat(&ms); 
+    msv.data()->copy_to_smat(&ms); 
     msv_data.set(&ms, msv.h_index());     
   } /* used by MLike */
   
@@ -242,6 +281,7 @@ public:
     s_nm.reset(nm); 
     dummy_ydim = _dummy_ydim; 
     total_data_num = 0; 
+    ia_batch_pop.reset(batch_num, 0); 
     if (bi != NULL) bi->reset(batch_num); 
     int x_row = -1, xs_row = -1, y_row = -1, ys_row = -1, ysv_row = -1, x2_row = -1; 
     int bx; 
@@ -249,14 +289,14 @@ public:
       AzBytArr s_batchnm; 
       _reset_data(bx); 
       if (bx == batch_num-1) {
-        x_row = msv_x.rowNum(); 
+        x_row = xv_rowNum(); 
         xs_row = ms_x.rowNum(); 
         y_row = md_y.rowNum(); 
         ys_row = ms_y.rowNum(); 
         ysv_row = msv_y.rowNum(); 
       }
       else {
-        AzX::throw_if((msv_x.rowNum() != x_row || ms_x.rowNum() != xs_row || 
+        AzX::throw_if((xv_rowNum() != x_row || ms_x.rowNum() != xs_row || 
             md_y.rowNum() != y_row || ms_y.rowNum() != ys_row || msv_y.rowNum() != ysv_row), 
             AzInputError, eyec, "Data dimensionality conflict between batches");    
       }
@@ -273,6 +313,7 @@ public:
         max_tar = MAX(max_tar, md_y.max()); 
       }    
       if (bi != NULL) bi->update(bx, data_num); 
+      ia_batch_pop(bx, data_num); 
       total_data_num += data_num; 
       current_batch = bx; 
       AzTimeLog::print("#data = ", data_num, out); 
@@ -302,11 +343,22 @@ public:
     released_batch = -1; 
   }
   
+  /*------------------------------------------*/    
+  virtual int batchDataNum(int bx) const { return (bx >= 0 && bx < ia_batch_pop.size()) ? ia_batch_pop[bx] : -1; }
+  virtual void goto_batch(int bx) { /* only batch#bx is loaded */
+    AzX::throw_if(bx < 0 || bx >= batch_num, "AzpData_sparse::goto_batch", "batch# is out of range"); 
+    released_batch = -1; 
+    if (current_batch == bx) return; 
+    current_batch = bx - 1; 
+    next_batch(); 
+  }
+  
   /*------------------------------------------*/   
   virtual void release_batch() {
+    cancel_prefetch(); 
     released_batch = current_batch; /* suspend the sequence */
     current_batch = -1; 
-    msv_x.reset(); ms_x.reset(); md_y.reset(); ms_y.reset(); msv_y.reset(); 
+    msv_x.reset(); msvz_x.reset(); ms_x.reset(); md_y.reset(); ms_y.reset(); msv_y.reset(); 
     /* data_num = 0; */ 
   }
 
@@ -316,17 +368,23 @@ protected:
   bool is_bc_ext(const AzBytArr &s_ext) const { return s_ext.contains("bc"); }
   virtual void _reset_data(int batch_no, bool do_print=true, bool do_print_stat=true) {  
     const char *eyec = "AzpData_sparse::_reset_data";  
+    cancel_prefetch(); 
     if (do_print) AzTimeLog::print("... ", s_nm.c_str(), " batch#", batch_no+1, out); 
     AzBytArr s_x_fn, s_y_fn; 
     const char *x_fn = gen_batch_fn(batch_no, s_x_ext.c_str(), &s_x_fn);    
 
     msv_x.reset(); 
+    msvz_x.reset(); 
     ms_x.reset(); /* added on 04/07/2015 */
     md_y.reset(); /* replaced pmat on 08/10/2015 */
     ms_y.reset(); 
     msv_y.reset(); 
   
-    if (is_var_ext(s_x_ext)) { 
+    if (is_var_ext(s_x_ext) && do_compress_x) { /* smatbcvar; compressed without an uncompressed copy if possible */
+      msvz_x.read(x_fn); 
+      data_num = msvz_x.dataNum(); cnum = msvz_x.colNum(); rnum = msvz_x.rowNum(); 
+    }
+    else if (is_var_ext(s_x_ext)) { 
       msv_x.read(x_fn); /* Mat is smatvar | smatcvar | smatbcvar */
       data_num = msv_x.dataNum(); cnum = msv_x.colNum(); rnum = msv_x.rowNum(); 
     }
@@ -348,8 +406,8 @@ protected:
     if (dummy_ydim > 0) {
       if (!is_var_y) ms_y.reform(dummy_ydim, data_num);  /* 2/5/2015: so that U can be tested */
       else {
-        MatY ms(dummy_ydim, msv_x.colNum()); 
-        msv_y.reset(&ms, msv_x.index());         
+        MatY ms(dummy_ydim, cnum); 
+        msv_y.reset(&ms, dataIndex());         
       }
     }
     else {
@@ -357,7 +415,7 @@ protected:
       if (is_var_ext(s_y_ext)) {
         msv_y.read(y_fn); 
         AzX::throw_if((msv_y.dataNum() != data_num), AzInputError, eyec, "#data mismatch btw features and targets"); 
-        if (msv_x.index()->compare(msv_y.index()) != 0) {
+        if (dataIndex()->compare(msv_y.index()) != 0) {
           AzX::throw_if(!do_allow_diffidx, AzInputError, eyec, "data index mismatch btw features and targets");  
           AzPrint::writeln(out, "Y's data indexe differs from X's."); 
         }
@@ -384,16 +442,25 @@ protected:
         AzX::throw_if(true, AzInputError, eyec, s.c_str()); 
       }
       AzDic mydic(xtext_fn); mydic.copy_words_only_to(dic);
+      voc_sz = (mydic.is_hash_signature()) ? mydic.hash_signature_dim() : mydic.size(); 
       ia_nn = NULL; 
       if (mydic.get_max_n() > 1) { mydic.get_n(_ia_nn); ia_nn = &_ia_nn; }
     }
         
     if (do_print_stat) show_x_stat(); 
+    if (do_compress_x) {
+      if (do_print_stat) {
+        AzBytArr s("  Compressed in memory: "); s << (double)msvz_x.byteNum()/1024/1024 << " MB"; 
+        AzTimeLog::print(s.c_str(), out); 
+      }
+    }
   }   
+  int xv_rowNum() const { return (do_compress_x) ? msvz_x.rowNum() : msv_x.rowNum(); }
   void show_x_stat() const {
     const Mat *m = (is_vg_x()) ? msv_x.data() : &ms_x; 
-    AzBytArr s("  #row="); s << m->rowNum() << " #col=" << m->colNum(); 
-    s << " nz per col=" << (double)m->elmNum()/(double)m->colNum(); 
+    AzBytArr s("  #row="); s << rnum << " #col=" << cnum; 
+    double elm_num = (do_compress_x) ? (double)msvz_x.elmNum() : (double)m->elmNum(); 
+    s << " nz per col=" << elm_num/(double)cnum; 
     AzTimeLog::print(s.c_str(), out);  
   }   
   /*-------------------------------------------------------------------------*/  
@@ -403,46 +470,151 @@ protected:
   virtual void _gen_data(int, int, AzPmatVar *, int) const { no_support("AzpData_sparse", "_gen_data(dense variable-sized) for test"); }     
 
   /*-------------------------------------------------------------------------*/    
-  /*---       on-the-fly region generation (experimantal & slow)          ---*/  
+  /*---                   on-the-fly region generation                    ---*/  
+  /* Documents are divided among threads by #token; the columns of each      */
+  /* thread are appended in order and sent to AzPmatSpaVar without making an */
+  /* AzSmatbc copy, so the result is the same for any thread_num.  With      */
+  /* prefetch(), the regions of the next minibatch are generated in the      */
+  /* background while the current one is being processed on the GPU.        */
+  class gen_regions_thread : public AzThread_ {
+  public: 
+    const AzpData_sparse *ds; 
+    const int *dxs; 
+    int dnum; 
+    Az_bc bc; 
+    AzIntArr ia_dcolind; 
+    gen_regions_thread() : ds(NULL), dxs(NULL), dnum(0) {}
+    void reset(const AzpData_sparse *_ds, const int *_dxs, int _dnum) { ds = _ds; dxs = _dxs; dnum = _dnum; }
+    void run() { ds->gen_regions(dxs, dnum, bc, ia_dcolind); }
+  }; 
+  class prefetch_thread : public AzThread_ {
+  public: 
+    const AzpData_sparse *ds; 
+    AzIntArr ia_dxs; 
+    Az_bc bc; 
+    AzIntArr ia_dcolind; 
+    prefetch_thread() : ds(NULL) {}
+    void reset(const AzpData_sparse *_ds, const int *dxs, int dnum) { ds = _ds; ia_dxs.reset(dxs, dnum); }
+    void clear() { ia_dxs.reset(); bc.destroy(); ia_dcolind.reset(); }
+    bool is_for(const int *dxs, int dnum) const { 
+      return (dnum > 0 && ia_dxs.size() == dnum && memcmp(ia_dxs.point(), dxs, sizeof(dxs[0])*dnum) == 0); 
+    }
+    void run() { ds->gen_regions_mt(ia_dxs.point(), ia_dxs.size(), bc, ia_dcolind); }
+  }; 
+  mutable prefetch_thread pf; 
+  mutable AzThreadBg pf_bg; /* declared after the data so that it is joined before the data is destroyed */
+  void cancel_prefetch() const { pf_bg.join(false); pf.clear(); }
+public: 
+  virtual void prefetch(const int *dxs, int dnum) const {
+    if (!do_gen_regions() || !is_vg_x() || dnum <= 0) return; 
+    cancel_prefetch(); 
+    pf.reset(this, dxs, dnum); 
+    pf_bg.start(&pf); 
+  }
+protected: 
   void gen_regions(const int *dxs, int dnum, AzPmatSpaVar &mv_out,
                    bool do_rowindex) const {       
-    AzIntArr ia_dcolind; 
-    int chk=dnum/10, ini = chk*500; 
-    Az_bc bc(ini, ini*psz*3);
+    int row_num = (do_nobow) ? voc_sz*psz : voc_sz; 
+    pf_bg.join(); 
+    if (pf.is_for(dxs, dnum)) { /* generated in the background */
+      mv_out.set(pf.bc, row_num, pf.ia_dcolind, do_rowindex); 
+      pf.clear(); 
+      return; 
+    }
+    pf.clear(); 
+    Az_bc bc; AzIntArr ia_dcolind; 
+    gen_regions_mt(dxs, dnum, bc, ia_dcolind); 
+    mv_out.set(bc, row_num, ia_dcolind, do_rowindex); 
+  }
+  /*-------------------------------------------------------------------------*/
+  /* regions of dxs[0::dnum] using thr_num threads; bc is committed */
+  void gen_regions_mt(const int *dxs, int dnum, Az_bc &bc, AzIntArr &ia_dcolind) const {
+    int num = MAX(1, MIN(thr_num, dnum)); 
+    if (num == 1) {
+      gen_regions(dxs, dnum, bc, ia_dcolind); 
+      bc.commit(); 
+      return; 
+    }
+    
+    /*---  divide documents by #token  ---*/
+    AZint8 t_total = 0; 
+    for (int ix = 0; ix < dnum; ++ix) t_total += msv_x.get_end(dxs[ix]) - msv_x.get_begin(dxs[ix]); 
+    AzDataArr<gen_regions_thread> thrs(num); 
+    AZint8 t_sum = 0; 
+    int ix0 = 0, ix = 0; 
+    for (int tx = 0; tx < num; ++tx) {
+      AZint8 t_end = t_total*(tx+1)/num; 
+      for ( ; ix < dnum-(num-tx-1); ++ix) {
+        if (ix > ix0 && t_sum >= t_end) break; 
+        t_sum += msv_x.get_end(dxs[ix]) - msv_x.get_begin(dxs[ix]); 
+      }
+      if (tx == num-1) ix = dnum; 
+      thrs(tx)->reset(this, dxs+ix0, ix-ix0); 
+      ix0 = ix; 
+    }
+    AzThreads::run(thrs); 
+    
+    int c_num = 0, e_num = 0; 
+    for (int tx = 0; tx < num; ++tx) { c_num += thrs[tx]->bc.colNum(); e_num += thrs[tx]->bc.elmNum(); }
+    bc.reset(c_num+1, e_num); 
+    ia_dcolind.reset(); ia_dcolind.prepare(dnum*2); 
+    for (int tx = 0; tx < num; ++tx) {
+      ia_dcolind.concat(&thrs(tx)->ia_dcolind, bc.colNum()); 
+      bc.concat(thrs(tx)->bc); 
+      thrs(tx)->bc.destroy(); 
+    }
+    bc.commit(); 
+  }
+  /*-------------------------------------------------------------------------*/
+  /* regions of dxs[0::dnum] are appended to bc, and their column ranges to ia_dcolind */
+  void gen_regions(const int *dxs, int dnum, Az_bc &bc, AzIntArr &ia_dcolind) const {
+    const char *eyec = "AzpData_sparse::gen_regions(dxs,num,bc)"; 
+    int ovl = DIVUP(psz, pstep); /* # of regions that cover a token */
+    AZint8 c_num = 0, e_num = 0; /* upper bounds */
+    for (int ix = 0; ix < dnum; ++ix) {
+      int col0 = msv_x.get_begin(dxs[ix]), col1 = msv_x.get_end(dxs[ix]); 
+      c_num += MAX(0, DIVUP(col1-col0+padding*2-psz, pstep)) + 1; 
+      for (int col = col0; col < col1; ++col) e_num += msv_x.data()->col_size(col); 
+    }
+    bc.reset((int)MIN(c_num, AzSigned32Max), (int)MIN(e_num*ovl, AzSigned32Max)); 
+    ia_dcolind.reset(); ia_dcolind.prepare(dnum*2); 
+    AzIntArr ia_work; 
     for (int ix = 0; ix < dnum; ++ix) {
-      ia_dcolind.put(bc.colNum());     
       int dx = dxs[ix]; 
-      gen_bow_nobow(dx, bc); 
+      int col0 = msv_x.get_begin(dx), col1 = msv_x.get_end(dx); 
+      int d_elm = 0; 
+      for (int col = col0; col < col1; ++col) d_elm += msv_x.data()->col_size(col); 
+      bc.check_overflow(eyec, (int)MIN((AZint8)d_elm*ovl, AzSigned32Max), dx); 
+      ia_dcolind.put(bc.colNum());     
+      gen_bow_nobow(dx, bc, ia_work); 
       ia_dcolind.put(bc.colNum()); 
-      if (ix+1 == chk) bc.prepmem(ix+1, dnum); 
     }
-    bc.commit(); 
-    int row_num = (do_nobow) ? dic.size()*psz : dic.size(); 
-    AzSmatbc m(row_num, bc.colNum()); 
-    AzSmatbcVar mv; mv.reset(&m, &ia_dcolind); 
-    mv.data_u()->set(bc.valarr(), bc.be()); 
-    mv_out.set(mv, do_rowindex); 
   }
   /*-------------------------------------------------------------------------*/
-  void gen_bow_nobow(int dx, Az_bc &bc) const {
+  void gen_bow_nobow(int dx, Az_bc &bc, AzIntArr &ia) const { /* ia: work area */
     int col0 = msv_x.get_begin(dx), t_num = msv_x.get_end(dx)-col0; 
     int pnum = DIVUP(t_num+padding*2-psz, pstep) + 1; 
     int tx0 = -padding; 
+    int dic_sz = voc_sz; 
+    const int *nn = (ia_nn != NULL) ? ia_nn->point() : NULL; 
     for (int pno = 0; pno < pnum; ++pno) {
       int tx1 = tx0 + psz; 
-      AzIntArr ia; 
+      ia.cut(0); 
+      bool is_sorted = true; /* strictly ascending, i.e., no need for unique() */
+      int last = -1; 
       for (int tx = MAX(0, tx0); tx < MIN(t_num, tx1); ++tx) {
         int num; const int *rows = msv_x.data()->rawcol_int(col0+tx, &num); 
         for (int ix = 0; ix < num; ++ix) {
           int row = rows[ix];  
-          if (do_nobow) ia.put(row+(tx-tx0)*dic.size());            
-          else {
-            if (ia_nn != NULL && tx+(*ia_nn)[row] > tx1) continue; 
-            ia.put(row);       
-          }
+          if (do_nobow) row += (tx-tx0)*dic_sz; 
+          else if (nn != NULL && tx+nn[row] > tx1) continue; 
+          if (row <= last) is_sorted = false; 
+          last = row; 
+          ia.put(row);       
         }
       }
-      bc.unique_put(ia); 
+      if (is_sorted) bc.put(ia); 
+      else           bc.unique_put(ia); 
       if (tx1 >= t_num+padding) break;
       tx0 += pstep;  
     }    
@@ -94,6 +94,9 @@ public:
   virtual void first_batch() { for (int ix = 0; ix < data.size(); ++ix) data(ix)->first_batch(); }
   virtual void next_batch() { for (int ix = 0; ix < data.size(); ++ix) data(ix)->next_batch(); }
   virtual void release_batch() { for (int ix = 0; ix < data.size(); ++ix) data(ix)->release_batch(); }
+  virtual int batchDataNum(int bx) const { return data[0]->batchDataNum(bx); } /* the same for all (check_pop) */
+  virtual void goto_batch(int bx) { for (int ix = 0; ix < data.size(); ++ix) data(ix)->goto_batch(bx); }
+  virtual void prefetch(const int *dxs, int d_num) const { for (int ix = 0; ix < data.size(); ++ix) data[ix]->prefetch(dxs, d_num); }
   virtual int dataNum_total() const { return data[0]->dataNum_total(); }
   virtual bool is_vg_x() const { return data[0]->is_vg_x(); }
   virtual bool is_vg_y() const { return data[0]->is_vg_y(); }  
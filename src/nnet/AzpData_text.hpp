@@ -0,0 +1,245 @@
+/* * * * *
+ *  AzpData_text.hpp
+ *  Copyright (C) 2017 Rie Johnson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * * * * */
+
+#ifndef _AZP_DATA_TEXT_HPP_
+#define _AZP_DATA_TEXT_HPP_
+
+#include "AzpData_sparse.hpp"
+#include "AzTools_text.hpp"
+#include "AzPrepText.hpp"
+
+/*---  raw (tokenized) text; regions are generated in memory  ---*/
+/***
+ *  Reads a text file (one document per line) instead of the region file,
+ *  and generates sparse region vectors in memory with the same code as
+ *  "prepText gen_regions".  Since the output is identical to what is read
+ *  from *.xsmatbcvar, prediction does not require writing region files.
+ *  Parameters take the prefix "text_", e.g., text_vocab_fn=, text_patch_size=.
+ *  x_ext= is the filename extension of the text file.
+ *  For prediction only: targets are not read.
+ *  Each batch is tokenized only when it is loaded; at initialization, the
+ *  other batches are only counted.
+ ***/
+#define AzpData_text_Pfx "text_"
+#define AzpData_text_Ext_dflt ".txt.tok"
+class AzpData_text : public AzpData_sparse<AzSmatbc,AzSmatc> {
+protected:
+  AzBytArr s_voc_fn;
+  bool do_lower, do_utf8dashes, do_char, do_byte, do_bow, do_contain, do_skip_stopunk, do_allow_zero, do_unkw;
+  int pch_sz, pch_step, padding;
+
+  AzDic dic_word; /* vocabulary */
+  AzIntArr ia_xnn; /* n of n-grams in the vocabulary */
+  int unkw_id;
+
+  virtual AzpData_ *clone_nocopy() const { return new AzpData_text(); }
+
+public:
+  AzpData_text() : do_lower(false), do_utf8dashes(false), do_char(false), do_byte(false), do_bow(false), do_contain(false),
+                   do_skip_stopunk(false), do_allow_zero(false), do_unkw(false),
+                   pch_sz(-1), pch_step(1), padding(0), unkw_id(-1) {}
+
+  #define kw_txt_voc_fn "vocab_fn="
+  #define kw_txt_do_lower "LowerCase"
+  #define kw_txt_do_utf8dashes "UTF8"
+  #define kw_txt_do_char "Char"
+  #define kw_txt_do_byte "Byte"
+  #define kw_txt_do_bow "Bow"
+  #define kw_txt_do_contain "Contain"
+  #define kw_txt_do_skip_stopunk "VariableStride"
+  #define kw_txt_do_allow_zero "NoSkip"
+  #define kw_txt_do_unkw "Unkw"
+  #define kw_txt_pch_sz "patch_size="
+  #define kw_txt_pch_step "patch_stride="
+  #define kw_txt_padding "padding="
+  virtual void resetParam_data(AzParam &azp) {
+    const char *eyec = "AzpData_text::resetParam_data";
+    if (s_x_ext.equals(AzpData_Xext_dflt)) s_x_ext.reset(AzpData_text_Ext_dflt);
+    is_var_x = true; is_spa_y = true; is_var_y = false;
+
+    azp.reset_prefix(AzpData_text_Pfx);
+    azp.vStr(kw_txt_voc_fn, &s_voc_fn);
+    azp.swOn(&do_lower, kw_txt_do_lower);
+    azp.swOn(&do_utf8dashes, kw_txt_do_utf8dashes);
+    azp.swOn(&do_char, kw_txt_do_char);
+    if (!do_char) azp.swOn(&do_byte, kw_txt_do_byte);
+    azp.swOn(&do_bow, kw_txt_do_bow);
+    if (do_bow) azp.swOn(&do_contain, kw_txt_do_contain);
+    azp.vInt(kw_txt_pch_sz, &pch_sz);
+    azp.vInt(kw_txt_pch_step, &pch_step);
+    azp.vInt(kw_txt_padding, &padding);
+    azp.swOn(&do_allow_zero, kw_txt_do_allow_zero);
+    azp.swOn(&do_skip_stopunk, kw_txt_do_skip_stopunk);
+    if (!do_bow) azp.swOn(&do_unkw, kw_txt_do_unkw);
+    azp.reset_prefix();
+
+    AzXi::throw_if_empty(s_voc_fn, eyec, AzpData_text_Pfx kw_txt_voc_fn);
+    AzXi::throw_if_nonpositive(pch_sz, eyec, AzpData_text_Pfx kw_txt_pch_sz);
+    AzXi::throw_if_nonpositive(pch_step, eyec, AzpData_text_Pfx kw_txt_pch_step);
+    AzXi::throw_if_negative(padding, eyec, AzpData_text_Pfx kw_txt_padding);
+  }
+  virtual void printParam_data(const AzOut &out, const char *pfx) const {
+    AzPrint o(out, pfx);
+    o.reset_prefix(AzpData_text_Pfx);
+    o.printV(kw_txt_voc_fn, s_voc_fn);
+    o.printSw(kw_txt_do_lower, do_lower);
+    o.printSw(kw_txt_do_utf8dashes, do_utf8dashes);
+    o.printSw(kw_txt_do_char, do_char);
+    o.printSw(kw_txt_do_byte, do_byte);
+    o.printSw(kw_txt_do_bow, do_bow);
+    o.printSw(kw_txt_do_contain, do_contain);
+    o.printV(kw_txt_pch_sz, pch_sz); o.printV(kw_txt_pch_step, pch_step); o.printV(kw_txt_padding, padding);
+    o.printSw(kw_txt_do_allow_zero, do_allow_zero);
+    o.printSw(kw_txt_do_skip_stopunk, do_skip_stopunk);
+    o.printSw(kw_txt_do_unkw, do_unkw);
+    o.reset_prefix();
+    o.printEnd();
+  }
+  virtual void printHelp_data(AzHelp &h) const {
+    h.item_required(AzpData_text_Pfx kw_txt_voc_fn, "datatype=text: Path to the vocabulary file used for \"prepText gen_regions\".");
+    h.item_required(AzpData_text_Pfx kw_txt_pch_sz, "datatype=text: Region size.");
+    h.item(AzpData_text_Pfx kw_txt_pch_step, "datatype=text: Region stride.", "1");
+    h.item(AzpData_text_Pfx kw_txt_padding, "datatype=text: Padding size.", "0");
+    h.item(AzpData_text_Pfx kw_txt_do_bow, "datatype=text: Use bag-of-word representation for sparse region vectors.");
+    h.item(AzpData_text_Pfx kw_txt_do_lower, "datatype=text: Convert upper-case to lower-case characters.");
+    h.item(AzpData_text_Pfx kw_txt_do_utf8dashes, "datatype=text: Convert UTF8 en dash, em dash, single/double quotes to ascii characters.");
+    h.item(AzpData_text_Pfx kw_txt_do_char, "datatype=text: Use characters as tokens.");
+    h.item(AzpData_text_Pfx kw_txt_do_byte, "datatype=text: Use bytes as tokens.");
+  }
+
+  /*------------------------------------------*/
+  /* Same as AzpData_sparse::reset_data except that the batches other than */
+  /* the first one are only counted, so that each is tokenized only once.  */
+  virtual void reset_data(const AzOut &_out, const char *nm, int _dummy_ydim=-1,
+                          AzpData_binfo *bi=NULL) {
+    const char *eyec = "AzpData_text::reset_data";
+    out = _out;
+    s_nm.reset(nm);
+    dummy_ydim = _dummy_ydim;
+    AzX::no_support(dummy_ydim <= 0, eyec, "Targets with datatype=text.  Use it for prediction");
+    total_data_num = 0;
+    ia_batch_pop.reset(batch_num, 0);
+    if (bi != NULL) bi->reset(batch_num);
+    for (int bx = batch_num-1; bx >= 0; --bx) {
+      if (bx == 0) {
+        _reset_data(bx);
+        current_batch = bx;
+      }
+      else {
+        AzBytArr s_txt_fn;
+        const char *txt_fn = gen_batch_fn(bx, s_x_ext.c_str(), &s_txt_fn);
+        data_num = AzTextReader::count_lines(txt_fn); /* only counted; read when needed */
+        AzX::throw_if((data_num == 0), AzInputError, eyec, "no data: ", txt_fn);
+      }
+      if (bi != NULL) bi->update(bx, data_num);
+      ia_batch_pop(bx, data_num);
+      total_data_num += data_num;
+      AzTimeLog::print("#data = ", data_num, out);
+    }
+    min_tar = max_tar = 0; /* dummy targets */
+  }
+
+protected:
+  /*------------------------------------------*/
+  virtual void _reset_data(int batch_no, bool do_print=true, bool do_print_stat=true) {
+    const char *eyec = "AzpData_text::_reset_data";
+    if (do_print) AzTimeLog::print("... ", s_nm.c_str(), " batch#", batch_no+1, out);
+    AzX::no_support(dummy_ydim <= 0, eyec, "Targets with datatype=text.  Use it for prediction");
+    if (dic_word.size() <= 0) reset_vocab();
+
+    AzBytArr s_txt_fn;
+    const char *txt_fn = gen_batch_fn(batch_no, s_x_ext.c_str(), &s_txt_fn);
+    msv_x.reset(); ms_x.reset(); md_y.reset(); ms_y.reset(); msv_y.reset();
+
+    Az_bc bc;
+    AzIntArr ia_dcolind;
+    gen_regions(txt_fn, bc, ia_dcolind);
+    int row_num = (do_bow) ? dic_word.size() : dic_word.size()*pch_sz;
+    AzSmatbc m(row_num, bc.colNum());
+    msv_x.reset(&m, &ia_dcolind);
+    msv_x.data_u()->set(bc.valarr(), bc.be());
+    data_num = msv_x.dataNum(); cnum = msv_x.colNum(); rnum = msv_x.rowNum();
+    AzX::throw_if((data_num == 0), AzInputError, eyec, "no data: ", txt_fn);
+    ms_y.reform(dummy_ydim, data_num);
+
+    if (do_print_stat) show_x_stat();
+  }
+
+  /*------------------------------------------*/
+  /* same as AzPrepText::gen_regions but without targets and positions */
+  void gen_regions(const char *fn, Az_bc &bc, AzIntArr &ia_dcolind) {
+    const char *eyec = "AzpData_text::gen_regions";
+    AzFile file(fn); file.open("rb"); AZint8 bytes_all = file.size(); file.close();
+    AZint8 bytes_done = 0;
+
+    /*---  memory is sized from the first part (1/16 of the bytes) once it is done  ---*/
+    bc.reset(0, 0);
+    ia_dcolind.reset();
+    bool is_prepped = false;
+
+    AzTextReader rdr;
+    rdr.open(fn);
+    for (int data_no = 0; ; ++data_no) {  /* for each document */
+      AzByte *buff = NULL;
+      int len = rdr.next(buff);
+      if (len <= 0) break;
+      AzDataArr<AzIntArr> aia_xtokno;
+      int t_num = AzTools_text::tokenize(buff, len, &dic_word, ia_xnn, do_lower, do_utf8dashes, aia_xtokno, do_char, do_byte);
+      bc.check_overflow(eyec, t_num*pch_sz*ia_xnn.size(), data_no);
+      ia_dcolind.put(bc.colNum());
+      if (do_bow) AzPrepText::gen_bow_regions(t_num, aia_xtokno, ia_xnn, do_contain, pch_sz, pch_step, padding,
+                                              do_allow_zero, do_skip_stopunk, bc, NULL);
+      else        AzPrepText::gen_nobow_regions(t_num, aia_xtokno, dic_word.size(), pch_sz, pch_step, padding,
+                                                do_allow_zero, unkw_id, bc, NULL);
+      ia_dcolind.put(bc.colNum());
+      bytes_done += len;
+      if (!is_prepped && bytes_done > 0 && bytes_done >= bytes_all/16) {
+        bc.prepmem(bytes_done, bytes_all);
+        is_prepped = true;
+      }
+    }
+    rdr.close();
+    bc.commit();
+  }
+
+  /*------------------------------------------*/
+  /* vocabulary and word-mapping as in AzPrepText::gen_regions and write_dic */
+  void reset_vocab() {
+    const char *eyec = "AzpData_text::reset_vocab";
+    AzTimeLog::print("Reading vocabulary: ", s_voc_fn.c_str(), out);
+    dic_word.reset(s_voc_fn.c_str());
+    AzX::throw_if(dic_word.size() <= 0, AzInputError, eyec, "empty dic: ", s_voc_fn.c_str());
+    int max_nn = dic_word.get_max_n(), min_nn = dic_word.get_min_n();
+    AzX::no_support((max_nn == 0), eyec, "Empty vocabulary");
+    AzX::no_support(max_nn>1 && !do_bow, eyec, "n-gram sequential");
+    AzX::no_support(max_nn>1 && do_skip_stopunk, eyec, "n-gram VariableStride");
+    AzX::throw_if(max_nn>1 && do_unkw, AzInputError, eyec, "Unkw cannot be used with n-grams with n>1");
+    ia_xnn.reset();
+    if (max_nn == 1) ia_xnn.put(1);
+    else for (int ix = min_nn; ix <= max_nn; ++ix) ia_xnn.put(ix);
+    unkw_id = -1;
+    if (do_unkw) unkw_id = AzPrepText::add_unkw(out, dic_word);
+    dic_word.build_hash();
+
+    AzDic xdic;
+    if (!do_bow && pch_sz > 1) AzPrepText::gen_nobow_dic(dic_word, pch_sz, xdic);
+    else                       xdic.reset(&dic_word);
+    xdic.copy_words_only_to(dic);
+  }
+};
+#endif
@@ -94,6 +94,8 @@ public:
     return o; 
   }
   virtual bool is_active() const { return (p.dropout > 0); }
+  virtual double test_scale() const { return (p.dropout > 0) ? 1-p.dropout : 1; }
+  virtual void deactivate() { p.dropout = -1; }
   virtual void upward(bool is_test, AzPmat *m) {
     if (p.dropout <= 0) return; 
     if (is_test) {
@@ -35,5 +35,7 @@ public:
   virtual void read(AzFile *file) = 0; 
   virtual void write(AzFile *file) const = 0; 
   virtual AzPrng &ref_rng() = 0;   
+  virtual double test_scale() const { return 1; } /* applied to input at test time */
+  virtual void deactivate() {} /* after test_scale() is folded into weights */
 }; 
 #endif 
\ No newline at end of file
@@ -36,7 +36,7 @@ void AzpEv::opt_th_all(const char *p_fns, const char *y_fns,
   
   AzPmat m_p, m_y; 
   for (int fx = 0; fx < sp_p_fn.size(); ++fx) {
-    AzDmat mp; AzTextMat::readMatrix(sp_p_fn.c_str(fx), &mp); 
+    AzDmat mp; read_pred(sp_p_fn.c_str(fx), &mp); 
     AzDmat my; AzTextMat::readMatrix(sp_y_fn.c_str(fx), &my); 
     if (mp.rowNum() != my.rowNum() || mp.colNum() != my.colNum()) {
       AzBytArr s("Y and P must have the same shape: "); s << sp_p_fn.c_str(fx) << "," << sp_y_fn.c_str(fx); 
@@ -87,7 +87,7 @@ void AzpEv::opt_th_cv(const char *p_fns, const char *y_fns,
   Az_PRF micro_prf_sum, macro_prf_sum; 
   int dnum_sum = 0, count = 0; 
   for (int fx = 0; fx < sp_p_fn.size(); ++fx) {
-    AzDmat mp; AzTextMat::readMatrix(sp_p_fn.c_str(fx), &mp); 
+    AzDmat mp; read_pred(sp_p_fn.c_str(fx), &mp); 
     AzDmat my; AzTextMat::readMatrix(sp_y_fn.c_str(fx), &my); 
     if (mp.rowNum() != my.rowNum() || mp.colNum() != my.colNum()) {
       AzBytArr s("Y and P must have the same shape: "); s.c(sp_p_fn.c_str(fx)); s.c(","); s.c(sp_y_fn.c_str(fx)); 
@@ -122,7 +122,7 @@ void AzpEv::opt_th_cv2(const char *p_fns, const char *y_fns,
   AzX::throw_if((sp_p_fn.size() != sp_y_fn.size()), AzInputError, eyec, "number mismatch: Y and P"); 
   AzPmat m_p, m_y; 
   for (int fx = 0; fx < sp_p_fn.size(); ++fx) {
-    AzDmat mp; AzTextMat::readMatrix(sp_p_fn.c_str(fx), &mp); 
+    AzDmat mp; read_pred(sp_p_fn.c_str(fx), &mp); 
     AzDmat my; AzTextMat::readMatrix(sp_y_fn.c_str(fx), &my); 
     if (mp.rowNum() != my.rowNum() || mp.colNum() != my.colNum()) {
       AzBytArr s("Y and P must have the same shape: "); s.c(sp_p_fn.c_str(fx)); s.c(","); s.c(sp_y_fn.c_str(fx)); 
@@ -432,7 +432,7 @@ void AzpEv::eval_pred(const char *y_fn, const char *p_fn, const char *typ,
   AzDmat md_y, md_p; 
   AzTextMat::readMatrix(y_fn, &md_y); 
   AzPmat m_y(&md_y); md_y.destroy(); 
-  AzTextMat::readMatrix(p_fn, &md_p); 
+  read_pred(p_fn, &md_p); 
   AzPmat m_p(&md_p); md_p.destroy(); 
   int data_num = m_y.colNum(); 
   AzX::throw_if((m_p.colNum() != data_num), AzInputError, eyec, "#data mismatch between truth and prediction"); 
@@ -470,6 +470,53 @@ void AzpEv::eval_pred(const char *y_fn, const char *p_fn, const char *typ,
   AzPrint::writeln(log_out, s); 
 } 
 
+/*------------------------------------------------------------*/
+/* Sparse predictions ("sparse #class" followed by "class:score ..." as written by */
+/* predict with top_k= or prediction_threshold=) list only some of the classes.    */
+/* The classes not listed are regarded as scoring lower than any listed class.     */
+/* The pairs are parsed here since AzTextMat drops zero values, which would turn a */
+/* listed class with score 0 into an unlisted one.                                 */
+void AzpEv::read_pred(const char *fn, AzDmat *md_p) {
+  const char *eyec = "AzpEv::read_pred"; 
+  AzIntArr ia_line_len; 
+  AzFile::scan(fn, 1024*1024, &ia_line_len); 
+  AzX::throw_if(ia_line_len.size() <= 0, AzInputNotValid, eyec, "Empty prediction file: ", fn); 
+  AzBytArr ba_buff; 
+  AzByte *buff = ba_buff.reset(ia_line_len.max()+256, 0); 
+  AzFile file(fn); file.open("rb"); 
+  int len = file.gets(buff, ia_line_len.max()+1); 
+  AzBytArr s_line0(buff, len); 
+  if (!s_line0.beginsWith("sparse ")) {
+    file.close(); 
+    AzTextMat::readMatrix(fn, md_p); 
+    return; 
+  }
+  int row_num = atol(s_line0.c_str()+strlen("sparse ")); 
+  AzX::throw_if(row_num <= 0, AzInputNotValid, eyec, "Invalid #class in the first line of ", fn); 
+  file.seek(0); file.readBytes(buff, ia_line_len.get(0)); 
+  int col_num = ia_line_len.size() - 1; 
+  md_p->reform(row_num, col_num); 
+  md_p->set(AzpEv_Unlisted); 
+  for (int col = 0; col < col_num; ++col) {
+    int len = ia_line_len.get(col+1); 
+    file.readBytes(buff, len); buff[len] = '\0'; 
+    const AzByte *wp = buff, *line_end = buff + len; 
+    for ( ; wp < line_end; ) {
+      AzBytArr s_tok; AzTools::getString(&wp, line_end, s_tok); 
+      if (s_tok.length() <= 0) continue; 
+      const char *tok = s_tok.c_str(), *colon = strchr(tok, ':'); 
+      AzX::throw_if(colon == NULL, AzInputNotValid, eyec, "Expected class:score, but got ", tok); 
+      int row = atol(tok); 
+      if (row < 0 || row >= row_num) {
+        AzBytArr s("Invalid class# in line# "); s << col+2 << " of " << fn << ": " << tok; 
+        AzX::throw_if(true, AzInputNotValid, eyec, s.c_str()); 
+      }
+      md_p->set(row, col, atof(colon+1)); 
+    }
+  }
+  file.close(); 
+}
+
 /*------------------------------------------------------------*/
 void AzpEv::show_prf(const AzOut *eval_out, 
                          const char *str, 
@@ -144,6 +144,8 @@ protected:
   static void opt_th_global(const AzPmat *m_p, const AzPmat *m_y, AzDvect *v_th); 
   static void opt_th_each(const AzPmat *m_p, const AzPmat *m_y, AzDvect *v_th, double fbr=-1); 
                                 
+  #define AzpEv_Unlisted (-1e+10) /* score of the classes not listed in sparse predictions */
+  static void read_pred(const char *fn, AzDmat *md_p); 
   static void show_prf(const AzOut *eval_out, const char *str, const char *typ, int data_num, 
                         const Az_PRF &micro_prf, const Az_PRF &macro_prf, const AzOut &out); 
   static Az_PRF get_f1(int Tp, int P_denomi, int R_denomi);                        
@@ -70,6 +70,42 @@ public:
   const AzPmat *intercepts() const {
     return &v_i; 
   }
+  void multiply_weights(double coeff) { m_w.multiply(coeff); } /* only for m_w */
+  /*---  reorder the input features: row#i <- old row#ia_old[i], e.g., for a new word mapping  ---*/
+  void reorder_rows(const AzIntArr &ia_old) {
+    AzX::throw_if(ia_old.size() != m_w.rowNum(), "AzpLm::reorder_rows", "#rows mismatch"); 
+    AzDmat md; m_w.get(&md); 
+    AzDmat md_new(md.rowNum(), md.colNum()); 
+    const int *old = ia_old.point(); 
+    for (int col = 0; col < md.colNum(); ++col) {
+      const double *w = md.col(col)->point(); 
+      double *w_new = md_new.col_u(col)->point_u(); 
+      for (int row = 0; row < md.rowNum(); ++row) w_new[row] = w[old[row]]; 
+    }
+    m_w.set(&md_new); 
+  }
+  /*---  simulated post-training quantization for prediction; only for m_w  ---*/
+  /* Symmetric with one scale per output node (column).  The weights are rounded */
+  /* to the int8 grid but stay in AzFloat, and the products are computed by the  */
+  /* usual kernels.  This shows the accuracy cost of int8 weights, not speed.    */
+  void quantize_weights(int bits, double &diff2, double &norm2) {
+    AzDmat md; m_w.get(&md); 
+    double qmax = (1 << (bits-1)) - 1; /* 127 for 8 bits */
+    for (int col = 0; col < md.colNum(); ++col) {
+      double *w = md.col_u(col)->point_u(); 
+      double mx = 0; 
+      for (int row = 0; row < md.rowNum(); ++row) mx = MAX(mx, fabs(w[row])); 
+      if (mx <= 0) continue; 
+      double scale = mx / qmax; 
+      for (int row = 0; row < md.rowNum(); ++row) {
+        double q = w[row]/scale; 
+        q = ((q >= 0) ? floor(q+0.5) : -floor(-q+0.5)) * scale; 
+        diff2 += (q-w[row])*(q-w[row]); norm2 += w[row]*w[row]; 
+        w[row] = q; 
+      }
+    }
+    m_w.set(&md); 
+  }
 
   /*--------------------------------*/
 
@@ -16,6 +16,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  * * * * */
 
+#include <algorithm>
 #include "AzpMain_reNet.hpp"
 
 /*---  global (declared in AzPmat)  ---*/
@@ -124,32 +125,206 @@ void AzpMain_reNet::renet(int argc, const char *argv[], const AzBytArr &s_action
 #define kw_pred_fn "prediction_fn="
 #define kw_do_text "WriteText"
 #define kw_do_tok "PerToken"
+#define kw_do_resume "Resume"
+#define kw_do_eval_int8 "EvalInt8"
+#define kw_top_k "top_k="
+#define kw_pred_th "prediction_threshold="
+#define AzpMain_reNet_NoTh (-1e+30) /* prediction_threshold= is not specified */
 /*------------------------------------------------------------*/ 
 class AzpMain_reNet_predict_Param : public virtual AzpMain_reNet_Param_ {
 public:
   AzpDataSetDflt dataset; 
   AzBytArr s_mod_fn, s_pred_fn; 
-  bool do_text, do_tok; 
+  bool do_text, do_tok, do_resume, do_eval_int8; 
+  int top_k; 
+  bool do_pred_th; 
+  double pred_th; 
   /*------------------------------------------------*/
-  AzpMain_reNet_predict_Param(AzParam &p, const AzOut &out, const AzBytArr &s_action) : do_text(false), do_tok(false) {
+  AzpMain_reNet_predict_Param(AzParam &p, const AzOut &out, const AzBytArr &s_action) : do_text(false), do_tok(false), do_resume(false), do_eval_int8(false), top_k(-1), do_pred_th(false), pred_th(AzpMain_reNet_NoTh) {
     reset(p, out, s_action); 
   }
   void resetParam(const AzOut &out, AzParam &p) {
     const char *eyec = "AzpMain_reNet_predict_Param::resetParam";   
     AzPrint o(out);     
     _resetParam(o, p);      
-    bool do_train = false, do_test = true, is_there_y = false; 
+    p.swOn(o, do_eval_int8, kw_do_eval_int8); /* requires targets of the test data */
+    bool do_train = false, do_test = true, is_there_y = do_eval_int8; 
     dataset.resetParam(out, p, do_train, do_test, is_there_y);       
     p.vStr(o, kw_mod_fn, s_mod_fn);  
     p.vStr(o, kw_pred_fn, s_pred_fn);   
     p.swOn(o, do_text, kw_do_text); 
     p.swOn(o, do_tok, kw_do_tok); 
+    p.swOn(o, do_resume, kw_do_resume); 
+    p.vInt(o, kw_top_k, top_k); 
+    p.vFloat(kw_pred_th, &pred_th); 
+    do_pred_th = (pred_th != AzpMain_reNet_NoTh); 
+    if (do_pred_th) o.printV(kw_pred_th, pred_th); 
     AzXi::throw_if_empty(&s_mod_fn, eyec, kw_mod_fn); 
     AzXi::throw_if_empty(&s_pred_fn, eyec, kw_pred_fn); 
+    AzXi::throw_if_both(do_tok && do_resume, eyec, kw_do_tok, kw_do_resume); 
+    AzXi::throw_if_both(do_eval_int8 && do_resume, eyec, kw_do_eval_int8, kw_do_resume); 
+    AzX::throw_if(top_k == 0 || top_k < -1, AzInputError, eyec, kw_top_k, "must be positive."); 
+    AzX::throw_if(do_pred_th && !(pred_th > AzpMain_reNet_NoTh && pred_th < -AzpMain_reNet_NoTh), /* also catches nan */
+                  AzInputError, eyec, kw_pred_th, "must be a finite number."); 
     setupLogDmp(o, p); 
   }
 }; 
 
+/*------------------------------------------------------------*/ 
+/*---  write predictions to a file as they are made  ---*/
+/* dense binary: the AzDmatc format; sparse binary: the AzSmatc format (row# ascending). */
+/* #column in the binary header is updated at each commit.                         */
+/* dense text: one line per column; sparse text: "sparse #class" followed by one    */
+/* line per column of "class:score" in the descending order of scores.              */
+/* Sparse output keeps the top-k classes and/or the classes scoring >= threshold.   */
+/* With Resume, the predictions committed to the existing file are kept, and      */
+/* the number of them is returned by open() as the data point to resume from;    */
+/* anything written after them (e.g., by a longer earlier run) is truncated.      */
+class AzpPredOut_file : public virtual AzpPredOut_ {
+protected:
+  AzFile file; 
+  bool do_text; 
+  int digits, row_num, col_num; 
+  AZint8 org_size; 
+  int top_k;    /* sparse output: keep at most top_k classes if positive */
+  bool do_th;   /* sparse output: keep classes with scores >= th */
+  double th; 
+  static const AZint8 colnum_offs = sizeof(int)*2; /* dense: float size, #row, #column; sparse: marker, float size, #column, #row */
+  AZint8 hdr_size() const { return (do_sparse()) ? sizeof(int)*4 : sizeof(int)*3; }
+public:
+  AzpPredOut_file() : do_text(false), digits(7), row_num(0), col_num(0), org_size(0), top_k(-1), do_th(false), th(0) {}
+  void reset_sparse(int _top_k, bool _do_th, double _th) {
+    top_k = _top_k; do_th = _do_th; th = _th; 
+  }
+  bool do_sparse() const { return (top_k > 0 || do_th); }
+  int open(const char *fn, int _row_num, bool _do_text, int _digits, bool do_resume) {
+    const char *eyec = "AzpPredOut_file::open"; 
+    row_num = _row_num; do_text = _do_text; digits = _digits; col_num = 0; org_size = 0; 
+    file.reset(fn); 
+    if (do_resume && AzFile::isExisting(fn)) {
+      file.open("r+b"); 
+      org_size = file.size(); 
+      if (do_text) col_num = resume_text(); 
+      else         col_num = resume_binary(eyec); 
+    }
+    else {
+      file.open("wb"); 
+      write_header(); 
+    }
+    return col_num; 
+  }
+  void put(const AzDmatc &mc) {
+    AzX::throw_if(mc.rowNum() != row_num, "AzpPredOut_file::put", "#row conflict"); 
+    if (do_sparse()) put_sparse(mc); 
+    else if (do_text) mc.writeText(&file, digits); 
+    else if (mc.colNum() > 0) file.writeBytes(mc.rawcol(0), sizeof(AZ_MTX_FLOAT), mc.size()); 
+    col_num += mc.colNum(); 
+  }
+  void commit() {
+    if (!do_text) {
+      AZint8 offs = file.tell(); 
+      file.seek(colnum_offs); file.writeInt(col_num); file.seek(offs); 
+    }
+    file.flush(); 
+  }
+  void close() {
+    commit(); 
+    file.close(true); 
+  }
+protected:
+  void write_header() {
+    if (do_text) {
+      if (do_sparse()) { AzBytArr s("sparse "); s << row_num; s.nl(); s.writeText(&file); }
+    }
+    else if (do_sparse()) { /* AzSmatc */
+      file.writeInt(-1); file.writeInt(sizeof(AZ_MTX_FLOAT)); file.writeInt(col_num); file.writeInt(row_num); 
+    }
+    else { /* AzDmatc */
+      file.writeInt(sizeof(AZ_MTX_FLOAT)); file.writeInt(row_num); file.writeInt(col_num); 
+    }
+  }
+  /* descending order of scores; ties are broken by row# */
+  static bool is_higher(const AZI_VECT_ELM &e0, const AZI_VECT_ELM &e1) {
+    return (e0.val > e1.val || (e0.val == e1.val && e0.no < e1.no)); 
+  }
+  static bool is_lower_no(const AZI_VECT_ELM &e0, const AZI_VECT_ELM &e1) { return (e0.no < e1.no); }
+  void put_sparse(const AzDmatc &mc) {
+    AzBaseArray<AZI_VECT_ELM> a_elm; AZI_VECT_ELM *elm = NULL; 
+    a_elm.alloc(&elm, row_num, "AzpPredOut_file::put_sparse", "elm"); 
+    for (int col = 0; col < mc.colNum(); ++col) {
+      const AZ_MTX_FLOAT *val = mc.rawcol(col); 
+      int num = 0; 
+      for (int row = 0; row < row_num; ++row) {
+        if (do_th && val[row] < th) continue; 
+        elm[num].no = row; elm[num].val = val[row]; ++num; 
+      }
+      if (top_k > 0 && num > top_k) { /* select the top-k without sorting the rest */
+        std::nth_element(elm, elm+top_k, elm+num, is_higher); 
+        num = top_k; 
+      }
+      if (do_text) {
+        std::sort(elm, elm+num, is_higher); 
+        AzBytArr s; 
+        for (int ix = 0; ix < num; ++ix) {
+          if (ix > 0) s << " "; 
+          s << elm[ix].no << ":"; s.cn(elm[ix].val, digits); 
+        }
+        s.nl(); s.writeText(&file); 
+      }
+      else {
+        std::sort(elm, elm+num, is_lower_no); /* AzSmatc requires row# in the ascending order */
+        file.writeInt(num); 
+        file.writeBytes(elm, sizeof(AZI_VECT_ELM), num); 
+      }
+    }
+  }
+  int resume_binary(const char *eyec) {
+    AzX::throw_if(org_size < hdr_size(), AzInputError, eyec, "Not a prediction file: ", file.pointFileName()); 
+    int marker = (do_sparse()) ? file.readInt() : -1; 
+    int float_sz = file.readInt(), _row_num, _col_num; 
+    if (do_sparse()) { _col_num = file.readInt(); _row_num = file.readInt(); }
+    else             { _row_num = file.readInt(); _col_num = file.readInt(); }
+    AzX::throw_if(marker != -1 || float_sz != sizeof(AZ_MTX_FLOAT) || _row_num != row_num || _col_num < 0, AzInputError, eyec, 
+                  "The existing prediction file does not match: ", file.pointFileName()); 
+    AZint8 data_end = hdr_size(); 
+    if (do_sparse()) {
+      for (int col = 0; col < _col_num; ++col) {
+        AzX::throw_if(data_end + (AZint8)sizeof(int) > org_size, AzInputError, eyec, "The existing prediction file is broken: ", file.pointFileName()); 
+        int num = file.readInt(); 
+        data_end += sizeof(int) + (AZint8)num*(AZint8)sizeof(AZI_VECT_ELM); 
+        if (data_end <= org_size) file.seek(data_end); 
+      }
+    }
+    else data_end += (AZint8)_row_num*(AZint8)_col_num*(AZint8)sizeof(AZ_MTX_FLOAT); 
+    AzX::throw_if(org_size < data_end, AzInputError, eyec, "The existing prediction file is broken: ", file.pointFileName()); 
+    file.truncate(data_end); /* discard uncommitted bytes, if any */
+    org_size = 0; 
+    return _col_num; 
+  }
+  int resume_text() { /* count complete lines */
+    int line_num = 0; 
+    AZint8 line_end = 0; 
+    AzBytArr s_buff; 
+    int buff_size = 1024*1024; 
+    AzByte *buff = s_buff.reset(buff_size, 0); 
+    for (AZint8 offs = 0; offs < org_size; ) {
+      int len = (int)MIN((AZint8)buff_size, org_size - offs); 
+      file.seekReadBytes(offs, len, buff); 
+      for (int ix = 0; ix < len; ++ix) {
+        if (buff[ix] == '\n') { ++line_num; line_end = offs+ix+1; }
+      }
+      offs += len; 
+    }
+    file.truncate(line_end); /* discard an incomplete line, if any */
+    org_size = 0; 
+    if (do_sparse()) {
+      if (line_num == 0) write_header(); 
+      else               --line_num; /* the first line is "sparse #class" */
+    }
+    return line_num; 
+  }
+}; 
+
 /*------------------------------------------------------------*/ 
 void AzpMain_reNet::predict(int argc, const char *argv[], const AzBytArr &s_action) {
   const char *eyec = "AzpMain_reNet::predict"; 
@@ -165,21 +340,19 @@ void AzpMain_reNet::predict(int argc, const char *argv[], const AzBytArr &s_acti
 
   p.dataset.reset_data(log_out, renet->classNum());  
 
+  AzBytArr s("Writing ("); s << ((p.do_text) ? "text" : "binary") << ") " << p.s_pred_fn.c_str(); 
+  AzTimeLog::print(s, log_out); 
+  AzpPredOut_file pout; 
+  pout.reset_sparse(p.top_k, p.do_pred_th, p.pred_th); 
+  int digits = 7; 
+  int dx_resume = pout.open(p.s_pred_fn.c_str(), renet->classNum(), p.do_text, digits, p.do_resume); 
+  if (dx_resume > 0) AzTimeLog::print("Resuming after #data=", dx_resume, log_out); 
+
   AzTimeLog::print("Predicting ... ", log_out); 
-  AzDmatc m_pred; 
   AzClock clk; 
-  renet->predict(azp, p.dataset.tst_data(), m_pred, p.do_tok); 
+  renet->predict(azp, p.dataset.tst_data(), &pout, p.do_tok, dx_resume, p.do_eval_int8); 
+  pout.close(); 
   clk.tick(log_out, "elapsed: "); 
-
-  if (p.do_text) {
-    AzTimeLog::print("Writing (text) ", p.s_pred_fn.c_str(), log_out); 
-    int digits = 7; 
-    m_pred.writeText(p.s_pred_fn.c_str(), digits); 
-  }  
-  else {
-    AzTimeLog::print("Writing (binary) ", p.s_pred_fn.c_str(), log_out); 
-    m_pred.write(p.s_pred_fn.c_str()); 
-  }
   AzTimeLog::print("Done ... ", log_out); 
 }
 
@@ -238,6 +411,61 @@ void AzpMain_reNet::write_word_mapping(int argc, const char *argv[], const AzByt
   AzTimeLog::print("Done ... ", log_out); 
 }
 
+/*------------------------------------------------------------*/ 
+/*------------------------------------------------------------*/ 
+class AzpMain_reNet_reorder_words_Param : public virtual AzpMain_reNet_Param_ {
+public:
+  AzBytArr s_mod_fn, s_wmap_fn, s_new_mod_fn; 
+  int dsno; 
+    
+  /*------------------------------------------------*/
+  AzpMain_reNet_reorder_words_Param(AzParam &azp, const AzOut &out, const AzBytArr &s_action) : dsno(0) {  
+    reset(azp, out, s_action); 
+  }
+  #define kw_new_mod_fn "new_model_fn="
+  void resetParam(const AzOut &out, AzParam &p) {
+    const char *eyec = "AzpMain_reNet_reorder_words::resetParam"; 
+    AzPrint o(out); 
+    _resetParam(o, p);   
+    p.vStr(o, kw_mod_fn, s_mod_fn);  
+    p.vStr(o, kw_wmap_fn, s_wmap_fn); 
+    p.vInt(o, kw_dsno, dsno); 
+    p.vStr(o, kw_new_mod_fn, s_new_mod_fn);  
+    AzXi::throw_if_empty(s_mod_fn, eyec, kw_mod_fn); 
+    AzXi::throw_if_empty(s_wmap_fn, eyec, kw_wmap_fn); 
+    AzXi::throw_if_negative(dsno, eyec, kw_dsno); 
+    AzXi::throw_if_empty(s_new_mod_fn, eyec, kw_new_mod_fn); 
+  }
+  void printHelp(AzHelp &h) const {
+    h.item_required(kw_mod_fn, "Model file to be migrated."); 
+    h.item_required(kw_wmap_fn, "New word mapping: the *.xtext file (or the vocabulary file) of the new region files.  It must have the same words as the one saved with the model in a different order, e.g., made with the vocabulary sorted by \"prepText sort_vocab\"."); 
+    h.item(kw_dsno, "Data# whose word mapping is replaced.", "0"); 
+    h.item_required(kw_new_mod_fn, "Path to the migrated model file (output)."); 
+  }
+}; 
+
+/*------------------------------------------------------------*/ 
+/* The rows of the first-layer weights are reordered for the new word mapping so */
+/* that the model can be used with the region files generated with it.          */
+void AzpMain_reNet::reorder_words(int argc, const char *argv[], const AzBytArr &s_action) {
+  AzParam azp(param_dlm, argc, argv); 
+  AzpMain_reNet_reorder_words_Param p(azp, log_out, s_action); 
+
+  AzObjPtrArr<AzpReNet> opa;  /* so that AzpReNet will be automatically deleted at the end of this function ... */
+  AzpReNet *renet = alloc_renet_for_test(opa, azp); 
+  AzTimeLog::print("Reading: ", p.s_mod_fn.c_str(), log_out); 
+  renet->read(p.s_mod_fn.c_str()); 
+  azp.check(log_out);
+  AzTimeLog::print("Reading: ", p.s_wmap_fn.c_str(), log_out); 
+  AzDic dic(p.s_wmap_fn.c_str()); 
+  AzDicc dicc; dic.copy_words_only_to(dicc); 
+  int num = renet->reorder_words(dicc, p.dsno); 
+  AzPrint::writeln(log_out, "#layers with reordered weights: ", num); 
+  AzTimeLog::print("Writing: ", p.s_new_mod_fn.c_str(), log_out); 
+  renet->write(p.s_new_mod_fn.c_str()); 
+  AzTimeLog::print("Done ... ", log_out); 
+}
+
 /*------------------------------------------------------------*/ 
 /*------------------------------------------------------------*/ 
 class AzpMain_reNet_write_embedded_Param : public virtual AzpMain_reNet_Param_ {
@@ -81,6 +81,7 @@ public:
   void predict(int argc, const char *argv[], const AzBytArr &s_action); 
   void write_word_mapping(int argc, const char *argv[], const AzBytArr &s_action); 
   void write_embedded(int argc, const char *argv[], const AzBytArr &s_action); 
+  void reorder_words(int argc, const char *argv[], const AzBytArr &s_action); 
   
 protected:
   void _write_embedded(AzpReNet *net, AzParam &azp, const AzpData_ *tst, int mb, int feat_top_num, const char *fn); 
@@ -112,6 +112,7 @@ void AzpReLayer_Wei_::init_x_weights() {
 }  
 
 /*------------------------------------------------------------*/      
+#define kw_do_int8 "Int8Weights" /* test only: simulated int8 weights to see the accuracy cost; not faster */
 int AzpReLayer_Wei_::setup(AzParam &azp, const AzpReLayer_Param &pp, const AzPfx &pfx, 
                            bool is_warmstart, bool for_testonly) {
   const char *eyec = "AzpReLayer_Wei_::setup"; 
@@ -122,6 +123,12 @@ int AzpReLayer_Wei_::setup(AzParam &azp, const AzpReLayer_Param &pp, const AzPfx
   AzX::throw_if((nodes <= 0), eyec, "Negative #node?!"); 
   lap.nodes = nodes;   
 
+  if (for_testonly) {
+    for (int px = 0; px < pfx.size(); ++px) {
+      azp.reset_prefix(pfx[px]); azp.swOn(&do_int8, kw_do_int8); azp.reset_prefix(); 
+    }
+    AzPrint o(out, pfx.pfx()); o.printSw(kw_do_int8, do_int8); o.printEnd(); 
+  }
   if (!is_re()) {
     cs.dropout->resetParam(out, azp, pfx, for_testonly); 
     check_dropout(pp, eyec); 
@@ -179,6 +186,56 @@ void AzpReLayer_Wei_::upward(bool is_test, const AzPmatVar &mv_below, AzPmatVar
   }
 }    
 
+/*------------------------------------------------------------*/   
+/* At test time, dropout only scales the input to wei_x, which can be done */
+/* to the weights once instead: W(s*x)+b = (s*W)x+b.                       */
+int AzpReLayer_Wei_::fold_for_test() {
+  if (!cs.dropout->is_active()) return 0; 
+  if (!wei_x->fold_input_scale(cs.dropout->test_scale())) return 0; 
+  cs.dropout->deactivate(); 
+  return 1; 
+}
+
+/*------------------------------------------------------------*/   
+/* Weights are rounded to 8-bit integers times a per-node scale but kept in  */
+/* floating point, so this simulates int8 weights for accuracy evaluation;   */
+/* prediction is not faster.  The relative error of the weights is shown.    */
+int AzpReLayer_Wei_::quantize_for_test() {
+  if (!do_int8) return 0; 
+  int bits = 8; 
+  double diff2 = 0, norm2 = 0; 
+  bool done = false; 
+  for (int ix = 0; ix < wei.size(); ++ix) if (wei(ix)->quantize(bits, diff2, norm2)) done = true; 
+  if (!done) return 0; 
+  AzBytArr s("  "); s << s_nm.c_str() << " layer#" << layer_no << ": int8 weights (simulated), relative error="; 
+  s.cn((norm2 > 0) ? sqrt(diff2/norm2) : 0, 4); 
+  AzPrint::writeln(out, s); 
+  return 1; 
+}
+
+/*------------------------------------------------------------*/   
+/* Migrate the input weights to a new word mapping.  If the input dimensionality */
+/* is a multiple of the vocabulary size, e.g., "Seq" regions of AzpData_sparse   */
+/* (row = word + position*vocabulary size), each block of rows is reordered.     */
+int AzpReLayer_Wei_::reorder_words(int dsno, const AzDicc &old_dicc, const AzDicc &new_dicc, const AzIntArr &ia_old) {
+  const char *eyec = "AzpReLayer_Wei_::reorder_words"; 
+  if (MAX(0, lap.dsno) != dsno) return 0; 
+  AzX::throw_if(dicc.size() > 0 && !dicc.is_same(old_dicc), eyec, 
+                "Word mapping conflict: the one in the layer vs. the one saved with the model"); 
+  int voc_sz = ia_old.size(), dim = wei_x->get_dim(); 
+  if (voc_sz <= 0 || dim % voc_sz != 0) {
+    AzBytArr s(s_nm.c_str()); s << " layer#" << layer_no << ": input dim=" << dim << ", #words=" << voc_sz; 
+    AzX::throw_if(true, AzInputError, eyec, "The input dimensionality is not a multiple of the vocabulary size.  ", s.c_str()); 
+  }
+  AzIntArr ia_rows; ia_rows.prepare(dim); 
+  for (int offs = 0; offs < dim; offs += voc_sz) {
+    for (int ix = 0; ix < voc_sz; ++ix) ia_rows.put(offs + ia_old[ix]); 
+  }
+  if (!wei_x->reorder_input(ia_rows)) return 0; 
+  if (dicc.size() > 0) dicc.reset(new_dicc); 
+  return 1; 
+}
+
 /*------------------------------------------------------------*/   
 void AzpReLayer_Wei_::downward(const AzPmatVar &mv_loss_deriv, bool dont_update, bool dont_release_sv) {
   if (is_re()) {
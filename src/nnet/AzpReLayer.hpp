@@ -190,6 +190,8 @@ public:
   /*========================================*/   
   virtual const AzBytArr &nm() const { return s_nm; }
   virtual bool doing_adv() const { return false; }
+  virtual int fold_for_test() { return 0; } /* fold test-time-only operations into weights; return #folded */
+  virtual int quantize_for_test() { return 0; } /* quantize weights if requested at test time; return #quantized */
   virtual void set_adv() {}
   
   virtual AzpLm *linmod_u() { /* AzpReLayer_Fc should override this.  This is for "do_partial".  Use with caution.  */
@@ -224,6 +226,7 @@ public:
     AzBytArr s("This layer is not associated with word mapping: "); s << s_nm; 
     AzX::throw_if(true, AzInputError, "AzpReLayer_::write_word_mapping", s.c_str()); 
   }
+  virtual int reorder_words(int dsno, const AzDicc &old_dicc, const AzDicc &new_dicc, const AzIntArr &ia_old) { return 0; } /* word#i <- old word#ia_old[i] */
   virtual void release_ld() {} /* override this */
   virtual void release_sv() {} /* override this */  
   
@@ -351,6 +354,7 @@ protected:
   AzPmatVar mv_ld_x; 
 
   AzDicc dicc; /* for word mapping check */
+  bool do_int8; /* test only: simulate 8-bit weights for accuracy evaluation; not saved */
     
   virtual void reset() {
     wei.free(); wei_x = NULL; wei_x2 = NULL; 
@@ -367,7 +371,7 @@ protected:
   static const int reserved_len = 127; /* 1/14/2016: for do_dicc (word mapping) */
  
 public:
-  AzpReLayer_Wei_() : wei_x(NULL), wei_x2(NULL), act_x(NULL) {}
+  AzpReLayer_Wei_() : wei_x(NULL), wei_x2(NULL), act_x(NULL), do_int8(false) {}
   virtual ~AzpReLayer_Wei_() {}
   
   virtual void reset(const AzpCompoSet_ *cset) {
@@ -415,6 +419,8 @@ public:
     for (int i=0;i<wei.size();++i) wei(i)->multiply_to_stepsize(coeff, out); 
   }  
   virtual double regloss(double *out_iniloss=NULL) const { double val=0; for (int i=0;i<wei.size();++i) val+= wei[i]->regloss(out_iniloss); return val;}
+  virtual int fold_for_test(); 
+  virtual int quantize_for_test(); 
   
   virtual void get_ld(int id, AzPmatVar &mv_lossd_a, bool do_x2=false) const; 
 
@@ -426,6 +432,7 @@ public:
   /*--- call this only for a bottom layer ---*/
   virtual void check_word_mapping(const AzpData_tmpl_ *data); 
   virtual void write_word_mapping(const char *fn) const { dicc.writeText(fn); }
+  virtual int reorder_words(int dsno, const AzDicc &old_dicc, const AzDicc &new_dicc, const AzIntArr &ia_old); 
   
   /*---  to save memory  ---*/
   virtual void release_sv() {
@@ -1165,9 +1172,14 @@ public:
   virtual void show_stat(AzBytArr &s) const { s << "conn:"; for (int i=0; i<lp.size(); ++i) lp[i]->show_stat(s); }
   virtual void multiply_to_stepsize(double coeff, const AzOut *out) { for (int i=0; i<lp.size(); ++i) lp[i]->multiply_to_stepsize(coeff, out); }
   virtual double regloss(double *out_iniloss=NULL) const { double val=0; for (int i=0; i<lp.size(); ++i) val += lp[i]->regloss(out_iniloss); return val; }
+  virtual int fold_for_test() { int num=0; for (int i=0; i<lp.size(); ++i) num += lp[i]->fold_for_test(); return num; }
+  virtual int quantize_for_test() { int num=0; for (int i=0; i<lp.size(); ++i) num += lp[i]->quantize_for_test(); return num; }
   virtual void get_ld(int id, AzPmatVar &mv_lossd_a, bool do_x2=false) const; 
   
   virtual void check_word_mapping(const AzpData_tmpl_ *data) { for (int i=0; i<lp.size(); ++i) lp[i]->check_word_mapping(data); }
+  virtual int reorder_words(int dsno, const AzDicc &old_dicc, const AzDicc &new_dicc, const AzIntArr &ia_old) { 
+    int num=0; for (int i=0; i<lp.size(); ++i) num += lp[i]->reorder_words(dsno, old_dicc, new_dicc, ia_old); return num; 
+  }
   virtual bool doing_adv() const { 
     for (int i=0; i<lp.size(); ++i) if (lp[i]->doing_adv()) return true; 
     return false; 
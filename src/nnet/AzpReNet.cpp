@@ -246,7 +246,11 @@ void AzpReNet::sup_training_loop(AzpData_ *trn,  /* not const b/c of first|next_
       }      
       int d_num = MIN(minib, data_size - ix);
       AzIntArr ia_dxs(dxs+ix, d_num); /* mini batch */
-      up_down(trn, ia_dxs, &tr_loss);      
+      AzIntArr ia_next; /* the next mini batch to be prefetched */
+      if (ix+d_num < data_size && (max_data_num <= 0 || ix+d_num < max_data_num)) {
+        ia_next.reset(dxs+ix+d_num, MIN(minib, data_size-ix-d_num)); 
+      }
+      up_down(trn, ia_dxs, &tr_loss, &ia_next);      
       show_progress(ix+d_num, dx_inc, data_size, eval_size, tr_loss); 
       if (dx_inc > 0 && (ix+d_num)%(dx_inc*10) == 0 && ix+minib < data_size) {
         show_layer_stat(); 
@@ -385,17 +389,21 @@ void AzpReNet::show_layer_stat(const char *str) const {
 /*------------------------------------------------------------*/ 
 void AzpReNet::up_down(const AzpData_ *trn, 
                        const AzIntArr &ia_dxs, 
-                       double *out_loss) {
+                       double *out_loss, 
+                       const AzIntArr *ia_next_dxs) {
   const char *eyec = "AzpReNet::up_down"; 
   AzX::no_support(!trn->is_sparse_y(), eyec, "No support for dense Y"); 
 
   _tTr();   
   AzPmatSpa m_spa_y; 
   const AzPmatSpa *mptr_spa_y = for_sparse_y_init(trn, ia_dxs, &m_spa_y);
+  _tTs(t_DataY); 
   
   /*---  upward (fprop)  ---*/  
   AzDataArr<AzpDataVar_X> data; 
-  trn->gen_data(ia_dxs.point(), ia_dxs.size(), data);   _tTs(t_DataY); 
+  trn->gen_data(ia_dxs.point(), ia_dxs.size(), data);   
+  if (ia_next_dxs != NULL) trn->prefetch(ia_next_dxs->point(), ia_next_dxs->size()); /* overlap with up/down */
+  _tTs(t_DataX); 
   bool is_test = false;   
   AzPmatVar mv_out; 
   up(is_test, data, mv_out);
@@ -797,44 +805,134 @@ int AzpReNet::init_test(AzParam &azp, const AzpData_tmpl_ *tst) {
   return outdim; 
 }  
  
+/*------------------------------------------------------------*/ 
+/* Make the network cheaper to apply for prediction; the output doesn't change */
+/* except for rounding errors.  Don't train or save the network afterwards.     */
+int AzpReNet::fold_for_test() {
+  int num = 0; 
+  for (int lx = 0; lx < lays->size(); ++lx) num += (*lays)(lx)->fold_for_test(); 
+  if (has_side()) num += side_lay->fold_for_test(); 
+  return num; 
+}
+
+/*------------------------------------------------------------*/ 
+/* Quantize the weights of the layers with Int8Weights, e.g., top_Int8Weights */
+int AzpReNet::quantize_for_test() {
+  int num = 0; 
+  for (int lx = 0; lx < lays->size(); ++lx) num += (*lays)(lx)->quantize_for_test(); 
+  if (has_side()) num += side_lay->quantize_for_test(); 
+  return num; 
+}
+
+/*------------------------------------------------------------*/ 
+/* Same as above, but also evaluate the test data (which must have targets) before */
+/* and after int8 rounding so that the accuracy cost of the rounding is shown.     */
+int AzpReNet::quantize_for_test(const AzpData_ *tst) {
+  double loss0 = 0, loss1 = 0, dummy = 0; 
+  AzBytArr s_pf0, s_pf1; 
+  double perf0 = test(tst, &loss0, &s_pf0); 
+  int num = quantize_for_test(); 
+  if (num <= 0) return 0; 
+  double perf1 = test(tst, &loss1, &s_pf1); 
+  acc_to_err(s_pf0, perf0, dummy); acc_to_err(s_pf1, perf1, dummy); 
+  AzBytArr s("int8: test-loss,"); s << loss0 << "," << loss1; 
+  if (s_pf0.length() > 0 && !s_pf0.equals(AzpEvalNoSupport)) {
+    s << ", perf:" << s_pf0.c_str() << "," << perf0 << "," << perf1 << ", delta," << perf1-perf0; 
+  }
+  AzTimeLog::print(s, out); 
+  return num; 
+}
+
+/*------------------------------------------------------------*/ 
+/*---  keep all the predictions in memory  ---*/
+class AzpPredOut_mem : public virtual AzpPredOut_ {
+protected:
+  AzValArr<AZ_MTX_FLOAT> av; 
+  int col_num; 
+public:
+  AzpPredOut_mem() : col_num(0) {}
+  void put(const AzDmatc &mc) { 
+    if (mc.colNum() > 0) av.concat(mc.rawcol(0), Az64::to_int(mc.size(), "AzpPredOut_mem::put")); 
+    col_num += mc.colNum(); 
+  }
+  void copy_to(int row_num, AzDmatc &mc_pred) const {
+    mc_pred.reform(row_num, col_num); 
+    if (col_num > 0) mc_pred.rawset(0, av.point(), av.size()); 
+  }
+}; 
+
 /*------------------------------------------------------------*/ 
 void AzpReNet::predict(AzParam &azp, const AzpData_ *tst, AzDmatc &mc_pred, bool do_tok) {
+  AzpPredOut_mem pout; 
+  predict(azp, tst, &pout, do_tok); 
+  pout.copy_to(class_num, mc_pred); 
+}
+
+/*------------------------------------------------------------*/ 
+/* Predictions are passed to pout one mini-batch at a time so that memory  */
+/* consumption is bounded by one batch of data plus one mini-batch of output. */
+void AzpReNet::predict(AzParam &azp, const AzpData_ *tst, AzpPredOut_ *pout, bool do_tok, 
+                       int dx_resume, bool do_eval_int8) {
   const char *eyec = "AzpReNet::predict"; 
+  AzX::throw_if_null(pout, eyec, "output"); 
+  AzX::no_support(do_tok && dx_resume > 0, eyec, "Resuming per-token prediction"); 
   
   init_test(azp, tst); 
+  if (do_fold) {
+    int num = fold_for_test(); 
+    if (num > 0) AzPrint::writeln(out, "#layers with dropout folded into weights: ", num); 
+  }
+  int q_num = (do_eval_int8) ? quantize_for_test(tst) : quantize_for_test(); 
+  if (q_num > 0) AzPrint::writeln(out, "#layers with int8 weights: ", q_num); 
 
-  AzX::no_support(tst->batchNum() > 1, eyec, "Batches"); 
-  
-  int data_num = tst->dataNum();  
-  int cnum = tst->colNum(); 
-  int inc = data_num/50, milestone = inc; 
-  int col = 0; 
-  for (int dx = 0; dx < data_num; dx += tst_minib) {
-    AzTools::check_milestone(milestone, dx, inc); 
-    int d_num = MIN(tst_minib, data_num - dx); 
-    AzPmatVar mv_out; 
-    apply(tst, dx, d_num, mv_out);   
-    if (dx == 0) {
-      if (do_tok) mc_pred.reform(class_num, cnum); 
-      else        mc_pred.reform(class_num, data_num); 
+  int total_num = tst->dataNum_total(); 
+  int inc = total_num/50, milestone = inc; 
+  int dx_offs = 0; /* #data in the preceding batches */
+  int out_num = 0; 
+  int bx0 = 0; /* to resume, skip the batches that end before dx_resume only by their sizes */
+  for ( ; dx_resume > 0 && bx0+1 < tst->batchNum(); ++bx0) {
+    int num = tst->batchDataNum(bx0); 
+    if (num < 0 || dx_offs + num > dx_resume) break; 
+    dx_offs += num; 
+  }
+  (const_cast<AzpData_ *>(tst))->goto_batch(bx0);    
+  for (int bx = bx0; ; ++bx) {
+    int data_num = tst->dataNum();  
+    int dx_begin = MAX(0, dx_resume - dx_offs); 
+    for (int dx = dx_begin; dx < data_num; dx += tst_minib) {
+      if (milestone > 0 && dx_offs+dx >= milestone) pout->commit(); 
+      AzTools::check_milestone(milestone, dx_offs+dx, inc); 
+      int d_num = MIN(tst_minib, data_num - dx); 
+      AzPmatVar mv_out; 
+      apply(tst, dx, d_num, mv_out);   
+      AzX::throw_if(!do_tok && mv_out.colNum() != d_num, eyec, "Conflict in #output.  Expected one output per data point."); 
+      AzDmatc mc(class_num, mv_out.colNum()); 
+      mv_out.data()->copy_to(&mc, 0); 
+      pout->put(mc); 
+      out_num += d_num; 
     }
-    AzX::throw_if(!do_tok && mv_out.colNum() != d_num, eyec, "Conflict in #output.  Expected one output per data point."); 
-    mv_out.data()->copy_to(&mc_pred, col); 
-    col += mv_out.colNum(); 
+    pout->commit(); 
+    dx_offs += data_num; 
+    if (bx+1 >= tst->batchNum()) break; 
+    (const_cast<AzpData_ *>(tst))->next_batch();    
   }
-  AzX::throw_if((col != mc_pred.colNum()), eyec, "Unexpected #output");   
   AzTools::finish_milestone(milestone);  
+  AzX::throw_if((out_num != MAX(0, total_num - dx_resume)), eyec, "Unexpected #output"); 
 }
 
+/*------------------------------------------------------------*/ 
+#define kw_do_fold "FoldDropout"
 /*------------------------------------------------------------*/ 
 void AzpReNet::resetParam_test(AzParam &azp) {
   _resetParam(azp); 
+  azp.swOn(&do_fold, kw_do_fold); 
 }  
 
 /*------------------------------------------------------------*/ 
 void AzpReNet::printParam_test(const AzOut &out) const {
   AzPrint o(out); 
   _printParam(o); 
+  o.printSw(kw_do_fold, do_fold); 
   mc.printParam(out);  /* for multi-connection */ 
   o.ppEnd(); 
 }
@@ -968,6 +1066,38 @@ void AzpReNet::write_word_mapping(const char *fn, int dsno) const {
   ds_dic[dsno]->writeText(fn); 
 }
 
+/*------------------------------------------------------------*/ 
+/* Migrate the model to a new word mapping with the same words in a different */
+/* order, e.g., with the vocabulary sorted by "prepText sort_vocab" so that   */
+/* the frequently used rows of the first-layer weights come first.            */
+/* Return the number of layers whose weights were reordered; throw if none   */
+/* so that neither the word mapping nor the model file is changed.           */
+int AzpReNet::reorder_words(const AzDicc &new_dicc, int dsno) {
+  const char *eyec = "AzpReNet::reorder_words"; 
+  AzX::throw_if(!do_ds_dic, AzInputError, eyec, "No word-mapping info is saved with this model."); 
+  AzX::throw_if((dsno < 0 || dsno >= ds_dic.size()), eyec, "data# is out of range"); 
+  AzStrPool sp_old, sp_new; 
+  ds_dic[dsno]->copy_to(&sp_old, '\n'); 
+  new_dicc.copy_to(&sp_new, '\n'); 
+  AzDic dic_old(&sp_old), dic_new(&sp_new); 
+  AzX::throw_if(dic_old.is_hash_signature(), AzInputError, eyec, 
+                "The model was trained on feature-hashed data (prepText gen_regions hash_bits=), which has no words to reorder."); 
+  AzIntArr ia_old; 
+  int mapped = dic_new.map_to(dic_old, ia_old); 
+  AzX::throw_if((dic_new.size() != dic_old.size() || mapped != dic_old.size()), AzInputError, eyec, 
+                "The new word mapping must consist of the same words as the one saved with the model."); 
+  const AzDicc &old_dicc = *ds_dic[dsno]; 
+  int num = 0; 
+  if (lays->size() > 0) num += (*lays)(0)->reorder_words(dsno, old_dicc, new_dicc, ia_old); 
+  if (has_side()) num += side_lay->reorder_words(dsno, old_dicc, new_dicc, ia_old); 
+  if (num == 0) { /* e.g., no weights or fixed weights at the bottom, or another data# */
+    AzBytArr s("No layer has input weights to be reordered for data#"); s << dsno << ".  The model is not migrated."; 
+    AzX::throw_if(true, AzInputError, eyec, s.c_str()); 
+  }
+  ds_dic(dsno)->reset(new_dicc); 
+  return num; 
+}
+
 /*------------------------------------------------------------*/ 
 /*------------------------------------------------------------*/
 void AzpReNet::timer_init() { 
@@ -111,6 +111,15 @@ public:
   }
 };
 
+/*------------------------------------------------------------*/
+/*---  receives predictions one mini-batch at a time so that they can be written incrementally  ---*/
+class AzpPredOut_ {
+public:
+  virtual ~AzpPredOut_() {}
+  virtual void put(const AzDmatc &mc) = 0; /* one column per data point (or per token) */
+  virtual void commit() {} /* called at the end of each batch and at each milestone */
+};
+
 /*------------------------------------------------------------*/
 class AzpReNet {
 protected:
@@ -175,6 +184,7 @@ protected:
   AzpTimer_CNN my_timer, *timer; /* changed from global 3/3/2017 */
 
   bool do_read_old_ext; 
+  bool do_fold; /* for test: fold test-time dropout scaling into weights */
   
 /*  static const int version=0;  */
 /*  static const int version=1;   5/28/2017: for mc */
@@ -190,7 +200,7 @@ public:
              hid_num(0), class_num(1), test_interval(-1), out(log_out), \
              ite_num(0), minib(100), tst_minib(100), rseed(1), init_ite(0), do_test_first(false), do_save_mem(false), \
              do_exact_trnloss(false), do_show_iniloss(false), do_less_verbose(true), do_ds_dic(false), \
-             do_topthru(false), timer(NULL), save_after(-1), do_read_old_ext(false)
+             do_topthru(false), timer(NULL), save_after(-1), do_read_old_ext(false), do_fold(false)
              
   AzpReNet(const AzpCompoSet_ *_cs) : AzpReNet_VarInit {
     reset(_cs);     
@@ -230,6 +240,9 @@ public:
   }
   virtual void training(AzParam &azp, AzpData_ *trn, const AzpData_ *tst, const AzpData_ *tst2); 
   virtual void predict(AzParam &azp, const AzpData_ *tst, AzDmatc &mc_pred, bool do_tok); 
+  virtual void predict(AzParam &azp, const AzpData_ *tst, AzpPredOut_ *pout, bool do_tok, 
+                       int dx_resume=0, /* skip the first dx_resume data points */
+                       bool do_eval_int8=false); /* show test performance with and without int8 weights */
   
   /*---  read/write  ---*/
   virtual void write(const char *fn) const { AzFile::write(fn, this); }
@@ -277,6 +290,7 @@ public:
   
   virtual void write_word_mapping_in_lay(const AzBytArr &s_lay_type, const char *lay_fn, const char *dic_fn) const; 
   virtual void write_word_mapping(const char *fn, int dsno) const; 
+  virtual int reorder_words(const AzDicc &new_dicc, int dsno); 
 
   /*---  ---*/
   virtual int init(AzParam &azp, const AzpData_tmpl_ *trn, const AzpData_tmpl_ *tst=NULL, const AzpData_tmpl_ *tst2=NULL, 
@@ -324,7 +338,8 @@ protected:
     if (mc.is_multi_conn()) return setup_mc(trn, azp, true, for_testonly); 
     else                    return setup_nomc(trn, azp, true, for_testonly); 
   }
-  virtual void up_down(const AzpData_ *trn, const AzIntArr &ia_dxs, double *out_loss=NULL); 
+  virtual void up_down(const AzpData_ *trn, const AzIntArr &ia_dxs, double *out_loss=NULL, 
+                       const AzIntArr *ia_next_dxs=NULL); /* ia_next_dxs: to be prefetched */
   
   virtual int setup_mc(const AzpData_tmpl_ *trn, AzParam &azp, bool is_warmstart, bool for_testonly);   
   virtual void _for_bottom(int lno, const AzpData_tmpl_ *trn, AzParam &azp, AzpReLayer_Param &pp) const;   
@@ -348,6 +363,9 @@ protected:
   static void printParam_lays(const char *kw, AzPrint &o, const char *pfx, const char *dlm, const AzIntArr &ia);  
       
   virtual void resetParam_test(AzParam &azp); 
+  virtual int fold_for_test(); 
+  virtual int quantize_for_test(); 
+  virtual int quantize_for_test(const AzpData_ *tst); 
   virtual void printParam_test(const AzOut &out) const; 
   
   virtual void _resetParam(AzParam &azp); 
@@ -108,6 +108,21 @@ public:
   virtual void check_for_reg_L2init() const {
     for (int lx = 0; lx < lms.size(); ++lx) lms[lx]->check_for_reg_L2init(p); 
   }    
+  virtual bool fold_input_scale(double coeff) {
+    if (do_thru) return false; 
+    for (int lx = 0; lx < lms.size(); ++lx) lms[lx]->multiply_weights(coeff); 
+    return true; 
+  }
+  virtual bool quantize(int bits, double &diff2, double &norm2) {
+    if (do_thru) return false; 
+    for (int lx = 0; lx < lms.size(); ++lx) lms[lx]->quantize_weights(bits, diff2, norm2); 
+    return true; 
+  }
+  virtual bool reorder_input(const AzIntArr &ia_old) {
+    if (do_thru) return false; 
+    for (int lx = 0; lx < lms.size(); ++lx) lms[lx]->reorder_rows(ia_old); 
+    return true; 
+  }
   virtual AzpWeight_ *clone() const {
     AzpWeightDflt *o = new AzpWeightDflt();    
     o->lmods_sgd.reset(&lmods_sgd); 
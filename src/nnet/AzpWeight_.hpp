@@ -68,6 +68,9 @@ public:
   virtual void reset_monitor() {}
   virtual int num_weights() const = 0; 
   virtual void show_stat(AzBytArr &s) const {}
+  virtual bool fold_input_scale(double coeff) { return false; } /* for test: W(coeff*x)+b = (coeff*W)x+b */
+  virtual bool quantize(int bits, double &diff2, double &norm2) { return false; } /* for test */
+  virtual bool reorder_input(const AzIntArr &ia_old) { return false; } /* input#i <- old input#ia_old[i] */
 }; 
 
 #endif 
\ No newline at end of file
@@ -12,7 +12,7 @@ void help()
 #else
   cout << "Arguments:  _  action  parameters" <<endl; 
 #endif 
-  cout << "   action: train | predict | write_word_mapping | write_embedded"<<endl; 
+  cout << "   action: train | predict | write_word_mapping | write_embedded | reorder_words"<<endl; 
 }
 
 /*******************************************************************/
@@ -52,6 +52,7 @@ int main(int argc, const char *argv[])
     else if (s_action.equals("predict"))            driver.predict(argc-2, argv+2, s_action);     
     else if (s_action.equals("write_word_mapping")) driver.write_word_mapping(argc-2, argv+2, s_action);      
     else if (s_action.equals("write_embedded"))     driver.write_embedded(argc-2, argv+2, s_action);      
+    else if (s_action.equals("reorder_words"))      driver.reorder_words(argc-2, argv+2, s_action);      
     else {
       help(); 
       ret = -1; 
@@ -0,0 +1,31 @@
+#!/bin/bash
+  #---  gen_vocab with sketch_mb= over several files must give the exact counts.
+  #---  Run from the top directory after "make bin/prepText" (or by "make test").
+  prep_exe=bin/prepText
+  tmpdir=test/temp
+  if [ ! -e $tmpdir ]; then mkdir $tmpdir; fi
+  shnm=$(basename $0)
+
+  lst=${tmpdir}/sketch.lst
+  echo examples/data/s-dp-td.1of2.txt.tok  > $lst
+  echo examples/data/s-dp-td.2of2.txt.tok >> $lst
+  echo examples/data/s-dp-dv.txt.tok      >> $lst
+
+  options="LowerCase WriteCount thread_num=2"
+  for opt in "" "min_word_count=3" "max_vocab_size=5000"; do
+    $prep_exe gen_vocab $options $opt input_fn=$lst vocab_fn=${tmpdir}/exact.voc > ${tmpdir}/exact.log 2>&1
+    if [ $? != 0 ]; then echo $shnm: gen_vocab failed.; exit 1; fi
+    $prep_exe gen_vocab $options $opt input_fn=$lst vocab_fn=${tmpdir}/sketch.voc sketch_mb=1 > ${tmpdir}/sketch.log 2>&1
+    if [ $? != 0 ]; then echo $shnm: gen_vocab with sketch_mb failed.; exit 1; fi
+
+    #---  the sketch must have seen each word occurrence once
+    total=$(awk -F'\t' '{ s += $2 } END { print s }' ${tmpdir}/exact.voc)
+    if [ "$opt" = "" ] && ! grep -q "#word=$total;" ${tmpdir}/sketch.log; then
+      echo $shnm: the sketch total differs from $total.; grep "#word=" ${tmpdir}/sketch.log; exit 1
+    fi
+    if grep -q "WARNING" ${tmpdir}/sketch.log; then echo $shnm: unexpected warning with \"$opt\".; exit 1; fi
+    if ! cmp -s ${tmpdir}/exact.voc ${tmpdir}/sketch.voc; then
+      echo $shnm: the vocabulary differs from the exact one with \"$opt\".; exit 1
+    fi
+  done
+  echo $shnm: passed.
@@ -0,0 +1,29 @@
+#!/bin/bash
+  #---  merge_vocab with Streaming must give the same output as without it,
+  #---  including the order of the words with the same count.
+  #---  Run from the top directory after "make bin/prepText" (or by "make test").
+  prep_exe=bin/prepText
+  tmpdir=test/temp
+  if [ ! -e $tmpdir ]; then mkdir $tmpdir; fi
+  shnm=$(basename $0)
+
+  #---  input: in the byte order of the words (SortByWord), of different sizes
+  inp=
+  for nm in s-dp-td.1of2 s-dp-td.2of2 s-dp-dv; do
+    $prep_exe gen_vocab LowerCase WriteCount SortByWord n=2 input_fn=examples/data/${nm}.txt.tok vocab_fn=${tmpdir}/${nm}.voc > ${tmpdir}/gen_vocab.log 2>&1
+    if [ $? != 0 ]; then echo $shnm: gen_vocab failed.; exit 1; fi
+    if [ "$inp" = "" ]; then inp=${tmpdir}/${nm}.voc; else inp=${tmpdir}/${nm}.voc+$inp; fi
+  done
+
+  for mode in Join ""; do  # "": union
+    for opt in "" "WriteCount" "max_vocab_size=3000" "min_word_count=3 WriteCount" "SortByWord WriteCount"; do
+      $prep_exe merge_vocab $mode $opt input_fns=$inp vocab_fn=${tmpdir}/inmem.voc > ${tmpdir}/inmem.log 2>&1
+      if [ $? != 0 ]; then echo $shnm: merge_vocab failed.; exit 1; fi
+      $prep_exe merge_vocab $mode Streaming $opt input_fns=$inp vocab_fn=${tmpdir}/stream.voc > ${tmpdir}/stream.log 2>&1
+      if [ $? != 0 ]; then echo $shnm: merge_vocab with Streaming failed.; exit 1; fi
+      if ! cmp -s ${tmpdir}/inmem.voc ${tmpdir}/stream.voc; then
+        echo $shnm: the output differs with \"$mode $opt\".; exit 1
+      fi
+    done
+  done
+  echo $shnm: passed.
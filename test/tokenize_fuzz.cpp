@@ -0,0 +1,111 @@
+/* * * * *
+ *  tokenize_fuzz.cpp
+ *  Compare AzTools_text::tokenize (one fused in-place pass) with the
+ *  step-by-step reference: replace_utf8dashes, then AzBytArr::lwr, then
+ *  AzTools::getStrings | get_utf8chars | get_bytes.
+ *
+ *  Usage: tokenize_fuzz [#trials [seed]]
+ * * * * */
+
+#define _AZ_MAIN_
+#include "AzUtil.hpp"
+#include "AzTools.hpp"
+#include "AzTools_text.hpp"
+
+/*-------------------------------------------------------------------------*/
+/* the tokenizer before the fused pass */
+static void ref_tokenize(AzByte *data, int inp_len, bool do_utf8dashes, bool do_lower,
+                         AzStrPool &sp_tok, bool do_char, bool do_byte) {
+  int len = inp_len;
+  if (do_utf8dashes) len = AzTools_text::replace_utf8dashes(data, len);
+  if (do_lower) {
+    AzBytArr s(data, len); s.lwr();
+    memcpy(data, s.point(), len);
+  }
+  sp_tok.reset();
+  if      (do_char) AzTools_text::get_utf8chars(data, len, sp_tok);
+  else if (do_byte) AzTools_text::get_bytes(data, len, sp_tok);
+  else              AzTools::getStrings(data, len, &sp_tok);
+}
+
+/*-------------------------------------------------------------------------*/
+/* random bytes mixed with the UTF-8 dashes/quotes, digits, upper case, and delimiters */
+static void gen_input(AzBytArr &s) {
+  static const char *pieces[] = {
+    "\xE2\x80\x93", "\xE2\x80\x94", "\xE2\x80\x98", "\xE2\x80\x99", "\xE2\x80\x9C", "\xE2\x80\x9D",
+    "\xE2\x80\x99s ", "\xE2\x80", "\xE2", "\xC3\xA9", "\xE3\x81\x82", "\xF0\x9F\x98\x80",
+    "1", "9", "A", "Z", "a", "z", "@", "[", "`", "{", " ", "\t", "\n", "\r",
+  };
+  int p_num = sizeof(pieces)/sizeof(pieces[0]);
+  s.reset();
+  int len = rand() % 40;
+  for (int ix = 0; ix < len; ++ix) {
+    int r = rand() % 4;
+    if      (r == 0) s.concat((AzByte)(rand() % 256));
+    else if (r == 1) s.concat((AzByte)0);
+    else             s.concat(pieces[rand() % p_num]);
+  }
+}
+
+/*-------------------------------------------------------------------------*/
+static bool is_same_tokens(const AzStrPool &sp0, const AzStrPool &sp1) {
+  if (sp0.size() != sp1.size()) return false;
+  for (int ix = 0; ix < sp0.size(); ++ix) {
+    int len0, len1;
+    const AzByte *p0 = sp0.point(ix, &len0), *p1 = sp1.point(ix, &len1);
+    if (len0 != len1 || memcmp(p0, p1, len0) != 0) return false;
+  }
+  return true;
+}
+
+/*-------------------------------------------------------------------------*/
+static void show(const char *title, const AzBytArr &s) {
+  AzBytArr s_hex(title);
+  for (int ix = 0; ix < s.length(); ++ix) { char buf[8]; sprintf(buf, " %02x", s.point()[ix]); s_hex.c(buf); }
+  cout << s_hex.c_str() << endl;
+}
+
+/*-------------------------------------------------------------------------*/
+int main(int argc, const char *argv[]) {
+  int trials = (argc > 1) ? atol(argv[1]) : 100000;
+  int seed = (argc > 2) ? atol(argv[2]) : 1;
+  srand(seed);
+  int failed = 0;
+  try {
+    for (int tx = 0; tx < trials && failed < 10; ++tx) {
+      AzBytArr s_inp; gen_input(s_inp);
+      for (int opt = 0; opt < 16; ++opt) {
+        bool do_utf8dashes = ((opt & 1) != 0), do_lower = ((opt & 2) != 0);
+        bool do_char = ((opt & 4) != 0), do_byte = ((opt & 8) != 0);
+        if (do_char && do_byte) continue;
+        AzBytArr s0(&s_inp), s1(&s_inp);
+        AzStrPool sp0, sp1;
+        ref_tokenize(s0.point_u(), s0.length(), do_utf8dashes, do_lower, sp0, do_char, do_byte);
+        AzTools_text::tokenize(s1.point_u(), s1.length(), do_utf8dashes, do_lower, sp1, do_char, do_byte);
+        bool ok = is_same_tokens(sp0, sp1);
+
+        /*---  the spans must point at the same tokens  ---*/
+        if (ok && !do_char && !do_byte) {
+          AzBytArr s2(&s_inp); AzIntArr ia_span;
+          AzTools_text::normalize(s2.point_u(), s2.length(), do_utf8dashes, do_lower, NULL, &ia_span);
+          AzStrPool sp2;
+          for (int ix = 0; ix+1 < ia_span.size(); ix += 2) sp2.put(s2.point()+ia_span[ix], ia_span[ix+1]);
+          ok = is_same_tokens(sp0, sp2);
+        }
+        if (!ok) {
+          ++failed;
+          cout << "Mismatch: trial#" << tx << " UTF8=" << do_utf8dashes << " LowerCase=" << do_lower
+               << " Char=" << do_char << " Byte=" << do_byte << endl;
+          show("  input:", s_inp);
+        }
+      }
+    }
+  }
+  catch (AzException *e) {
+    cout << e->getMessage() << endl;
+    return -1;
+  }
+  if (failed > 0) { cout << "tokenize_fuzz: failed." << endl; return -1; }
+  cout << "tokenize_fuzz: passed (" << trials << " inputs)." << endl;
+  return 0;
+}